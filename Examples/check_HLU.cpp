@@ -0,0 +1,184 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+// Checks the task parallel factorizations HLU_omp/HCholesky_omp with and
+// without accumulated updates against the sequential HLU/HCholesky.
+// example: ./check_HLU 2048
+// The points lie on four separated segments of a line, so that the blocks
+// coupling two segments are low-rank leaves. In the second matrix only the
+// first segment is coupled with the others (by rank one). The coupling of
+// the third and the fourth segment is zero in A, but it receives fill of
+// rank one from the first segment during the factorization, which remains
+// pending if updates are accumulated (it must not be skipped as zero).
+
+#include <iostream>
+#include <cmath>
+#include <stdlib.h>
+#include "basmod.h"
+#include "bemcluster.h"
+#include "bemblcluster.h"
+#include "matgen_sqntl.h"
+#include "H.h"
+#include "blas.h"
+
+struct point {
+  double x[3];
+  double getcenter(unsigned i) const { return x[i]; }
+  double getradius2() const { return 0.0; }
+};
+
+// smooth kernel on four segments; if coupled0 is set, only the first
+// segment is coupled with the other segments
+struct MatGenLine {
+  point* P;
+  unsigned* op_perm;
+  unsigned N;
+  bool coupled0;
+
+  MatGenLine(point* p, unsigned* op, unsigned n, bool c)
+    : P(p), op_perm(op), N(n), coupled0(c) { }
+
+  double kernel(unsigned i, unsigned j) const {
+    const double a = P[op_perm[i]].x[0], b = P[op_perm[j]].x[0];
+    const double d = (i==j) ? 4.0 : 0.0;
+    if (!coupled0 || floor(a/3.0)==floor(b/3.0))
+      return d + 1.0/(N*(1.0+fabs(a-b)));
+    if (a<3.0 || b<3.0) return 1.0/(N*(1.0+a)*(1.0+b));
+    return 0.0;
+  }
+  void cmpbl(unsigned b1, unsigned n1, unsigned b2, unsigned n2,
+             double* data) const {
+    for (unsigned j=0; j<n2; ++j)
+      for (unsigned i=0; i<n1; ++i) data[i+j*n1] = kernel(b1+i, b2+j);
+  }
+  void cmpblsym(unsigned b1, unsigned n1, double* data) const {
+    for (unsigned j=0; j<n1; ++j)
+      for (unsigned i=0; i<=j; ++i) *data++ = kernel(b1+i, b1+j);
+  }
+  double scale(unsigned, unsigned, unsigned, unsigned) const { return 1.0; }
+};
+
+// relative error of the solution of A x = b computed from the factors
+static double solveErr(unsigned N, blcluster* bl, mblock<double>** A,
+                       mblock<double>** L, mblock<double>** U, bool herm)
+{
+  double *x = new double[N], *b = new double[N];
+  srand(1);
+  for (unsigned i=0; i<N; ++i) x[i] = rand()/(double) RAND_MAX - 0.5;
+  blas::setzero(N, b);
+  if (herm) mltaHeHVec(1.0, bl, A, x, b);
+  else mltaGeHVec(1.0, bl, A, x, b);
+
+  if (herm) HCholesky_solve(bl, U, b);
+  else HLU_solve(bl, L, U, b);
+  blas::axpy(N, -1.0, x, b);
+  const double err = blas::nrm2(N, b)/blas::nrm2(N, x);
+
+  delete [] b;
+  delete [] x;
+  return err;
+}
+
+// returns false if the factorization with acc fails or is inaccurate
+static bool check(unsigned N, MatGenLine& MatGen,
+                  bemblcluster<point,point>* bl, bool herm, bool omp,
+                  unsigned acc)
+{
+  const double eps = 1e-12;
+  const unsigned rankmax = 1000;
+
+  mblock<double>** A;
+  allocmbls(bl, A);
+  if (herm) matgenHeH_sqntl(MatGen, bl, bl, false, eps, rankmax, A);
+  else matgenGeH_sqntl(MatGen, bl, bl, false, eps, rankmax, A);
+
+  mblock<double> **B, **L = NULL, **U;
+  allocmbls(bl, B);
+  copyH(bl, A, B);
+
+  bool ok;
+  if (herm) {
+    U = B;
+    ok = omp ? HCholesky_omp(bl, U, eps, rankmax, NULL, acc)
+      : HCholesky(bl, U, eps, rankmax, NULL, acc);
+  } else {
+    initLtH_0(bl, L);
+    initUtH_0(bl, U);
+    ok = omp ? HLU_omp(bl, B, L, U, eps, rankmax, NULL, acc)
+      : HLU(bl, B, L, U, eps, rankmax, NULL, acc);
+  }
+
+  double err = 1.0;
+  if (ok) err = solveErr(N, bl, A, L, U, herm);
+  std::cout << (herm ? "HCholesky" : "HLU") << (omp ? "_omp" : "")
+            << ", acc=" << acc << ": relative error " << err << std::endl;
+
+  if (!herm) {
+    freembls(bl, L);
+    freembls(bl, U);
+  }
+  freembls(bl, B);
+  freembls(bl, A);
+  return ok && err<1e-8;
+}
+
+int main(int argc, char* argv[])
+{
+  const unsigned N = (argc>1) ? atoi(argv[1]) : 2048;
+  const unsigned bmin = 20;
+  const double eta = 0.8;
+
+  // four segments of length 1 at 0, 3, 6 and 9
+  point* P = new point[N];
+  unsigned *op_perm = new unsigned[N], *po_perm = new unsigned[N];
+  for (unsigned i=0; i<N; ++i) {
+    const unsigned s = 4*i/N;
+    P[i].x[0] = 3.0*s + (4.0*i/N - s);
+    P[i].x[1] = P[i].x[2] = 0.0;
+    op_perm[i] = po_perm[i] = i;
+  }
+
+  bemcluster<point>* cl = new bemcluster<point>(P, op_perm, 0, N);
+  cl->createClusterTree(bmin, op_perm, po_perm);
+
+  unsigned nblcks;
+  bemblcluster<point,point>* bl = new bemblcluster<point,point>(0, 0, N, N);
+  bl->subdivide(cl, cl, eta*eta, nblcks);
+
+  bool ok = true;
+  for (unsigned z=0; z<2; ++z) {
+    MatGenLine MatGen(P, op_perm, N, z==1);
+    for (unsigned acc=0; acc<3; ++acc) {
+      ok = check(N, MatGen, bl, false, false, acc) && ok;
+      ok = check(N, MatGen, bl, false, true, acc) && ok;
+    }
+  }
+  delete bl;
+
+  bl = new bemblcluster<point,point>(0, 0, N, N);
+  bl->subdivide_sym(cl, eta*eta, nblcks);
+  for (unsigned z=0; z<2; ++z) {
+    MatGenLine MatGen(P, op_perm, N, z==1);
+    for (unsigned acc=0; acc<3; ++acc) {
+      ok = check(N, MatGen, bl, true, false, acc) && ok;
+      ok = check(N, MatGen, bl, true, true, acc) && ok;
+    }
+  }
+  delete bl;
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+
+  delete cl;
+  delete [] po_perm;
+  delete [] op_perm;
+  delete [] P;
+  return ok ? 0 : 1;
+}
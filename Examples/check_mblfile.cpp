@@ -0,0 +1,215 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+// Checks the binary container of H-matrices and the out-of-core routines.
+// example: ./check_mblfile 2000
+// An H-matrix and its HLU factors are saved with savembls_bin and mapped
+// with mapmbls. Products with the mapped matrix (in memory and out of core
+// with a small budget) and the solution with the mapped factors have to
+// coincide with the results of the original blocks, also if the leaves are
+// stored in reduced precision. Finally the blocks are detached from the
+// mapping.
+
+#include <iostream>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include "basmod.h"
+#include "bemcluster.h"
+#include "bemblcluster.h"
+#include "matgen_sqntl.h"
+#include "mblfile.h"
+#include "H.h"
+#include "blas.h"
+
+struct point {
+  double x[3];
+  double getcenter(unsigned i) const { return x[i]; }
+  double getradius2() const { return 0.0; }
+};
+
+// smooth nonsymmetric kernel on [0,1]
+struct MatGenLine {
+  point* P;
+  unsigned* op_perm;
+  unsigned N;
+
+  MatGenLine(point* p, unsigned* op, unsigned n) : P(p), op_perm(op), N(n) { }
+
+  double kernel(unsigned i, unsigned j) const {
+    const double a = P[op_perm[i]].x[0], b = P[op_perm[j]].x[0];
+    return (i==j ? 2.0 : 0.0) + (1.0+a)/(N*(0.1+fabs(a-b)));
+  }
+  void cmpbl(unsigned b1, unsigned n1, unsigned b2, unsigned n2,
+             double* data) const {
+    for (unsigned j=0; j<n2; ++j)
+      for (unsigned i=0; i<n1; ++i) data[i+j*n1] = kernel(b1+i, b2+j);
+  }
+  void cmpblsym(unsigned b1, unsigned n1, double* data) const {
+    for (unsigned j=0; j<n1; ++j)
+      for (unsigned i=0; i<=j; ++i) *data++ = kernel(b1+i, b1+j);
+  }
+  double scale(unsigned, unsigned, unsigned, unsigned) const { return 1.0; }
+};
+
+static double relerr(unsigned N, double* x, double* y)
+{
+  double* z = new double[N];
+  blas::copy(N, y, z);
+  blas::axpy(N, -1.0, x, z);
+  const double err = blas::nrm2(N, z)/blas::nrm2(N, x);
+  delete [] z;
+  return err;
+}
+
+static bool report(const char* name, double err)
+{
+  std::cout << name << ": relative error " << err << std::endl;
+  return err<1e-14;
+}
+
+// products of A and A^H with the mapped blocks M
+static bool checkProd(unsigned N, blcluster* bl, mblock<double>** A,
+                      mblock<double>** M, double* x)
+{
+  const unsigned long budget = 1<<16;
+  double *y = new double[N], *z = new double[N];
+  bool ok = true;
+
+  blas::setzero(N, y);
+  mltaGeHVec(1.0, bl, A, x, y);
+  blas::setzero(N, z);
+  mltaGeHVec(1.0, bl, M, x, z);
+  ok = report("mapped A x", relerr(N, y, z)) && ok;
+  blas::setzero(N, z);
+  ok = mltaGeHVec_ooc(1.0, bl, M, x, z, budget) && ok;
+  ok = report("out-of-core A x", relerr(N, y, z)) && ok;
+
+  blas::setzero(N, y);
+  mltaGeHhVec(1.0, bl, A, x, y);
+  blas::setzero(N, z);
+  ok = mltaGeHhVec_ooc(1.0, bl, M, x, z, budget) && ok;
+  ok = report("out-of-core A^H x", relerr(N, y, z)) && ok;
+
+  delete [] z;
+  delete [] y;
+  return ok;
+}
+
+int main(int argc, char* argv[])
+{
+  const unsigned N = (argc>1) ? atoi(argv[1]) : 2000;
+  const unsigned bmin = 20, rankmax = 1000;
+  const double eta = 0.8, eps = 1e-10;
+  const char *fA = "check_mblfile_A.bin", *fL = "check_mblfile_L.bin",
+    *fU = "check_mblfile_U.bin";
+
+  point* P = new point[N];
+  unsigned *op_perm = new unsigned[N], *po_perm = new unsigned[N];
+  for (unsigned i=0; i<N; ++i) {
+    P[i].x[0] = (double) i/N;
+    P[i].x[1] = P[i].x[2] = 0.0;
+    op_perm[i] = po_perm[i] = i;
+  }
+
+  bemcluster<point>* cl = new bemcluster<point>(P, op_perm, 0, N);
+  cl->createClusterTree(bmin, op_perm, po_perm);
+  unsigned nblcks;
+  bemblcluster<point,point>* bl = new bemblcluster<point,point>(0, 0, N, N);
+  bl->subdivide(cl, cl, eta*eta, nblcks);
+  MatGenLine MatGen(P, op_perm, N);
+
+  mblock<double>** A;
+  allocmbls(bl, A);
+  matgenGeH_sqntl(MatGen, bl, bl, false, eps, rankmax, A);
+
+  double *x = new double[N], *y = new double[N], *z = new double[N];
+  srand(1);
+  for (unsigned i=0; i<N; ++i) x[i] = rand()/(double) RAND_MAX - 0.5;
+
+  bool ok = true;
+  for (unsigned lp=0; lp<2; ++lp) {
+    if (lp) {
+      std::cout << "reduced precision:" << std::endl;
+      setPrecH(bl, A, 1e-4);
+    }
+    savembls_bin(eta, bmin, bl, A, fA);
+    mblFile f;
+    double eta2;
+    unsigned bmin2;
+    mblock<double>** M;
+    if (!f.open(fA)) {
+      std::cout << "cannot map " << fA << std::endl;
+      return 1;
+    }
+    mapmbls(f, eta2, bmin2, M);
+    ok = (eta2==eta && bmin2==bmin) && ok;
+    ok = checkProd(N, bl, A, M, x) && ok;
+
+    // the detached blocks remain valid after the file is closed
+    detachmbls(bl->nleaves(), M);
+    f.close();
+    ok = checkProd(N, bl, A, M, x) && ok;
+    freembls(bl, M);
+  }
+  setPrecH(bl, A, 0.0);
+
+  // solve with the mapped factors
+  mblock<double> **L, **U;
+  initLtH_0(bl, L);
+  initUtH_0(bl, U);
+  if (!HLU(bl, A, L, U, eps, rankmax)) {
+    std::cout << "HLU failed" << std::endl;
+    return 1;
+  }
+  savembls_bin(eta, bmin, bl, L, fL);
+  savembls_bin(eta, bmin, bl, U, fU);
+
+  blas::copy(N, x, y);
+  HLU_solve(bl, L, U, y);
+
+  {
+    mblFile f1, f2;
+    double eta2;
+    unsigned bmin2;
+    mblock<double> **ML, **MU;
+    if (!f1.open(fL) || !f2.open(fU)) {
+      std::cout << "cannot map the factors" << std::endl;
+      return 1;
+    }
+    mapmbls(f1, eta2, bmin2, ML);
+    mapmbls(f2, eta2, bmin2, MU);
+    blas::copy(N, x, z);
+    HLU_solve(bl, ML, MU, z, 1<<16);
+    ok = report("out-of-core HLU_solve", relerr(N, y, z)) && ok;
+    freembls(bl, MU);
+    freembls(bl, ML);
+  }
+
+  remove(fA);
+  remove(fL);
+  remove(fU);
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+
+  delete [] z;
+  delete [] y;
+  delete [] x;
+  freembls(bl, U);
+  freembls(bl, L);
+  freembls(bl, A);
+  delete bl;
+  delete cl;
+  delete [] po_perm;
+  delete [] op_perm;
+  delete [] P;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+// Checks the convergence of the block, pipelined and recycling Krylov
+// solvers (BlockCG, BlockGMRes, PipeCG, PipeGMRes, sGMRes, GCRODR) for
+// small dense real and complex systems with a diagonal preconditioner.
+// example: ./check_solvers 200
+// The residuals are recomputed from the returned solutions.
+
+#include <iostream>
+#include <cmath>
+#include <stdlib.h>
+#include "solvers.h"
+#include "blas.h"
+
+template<class T> struct DenseMatrix : public Matrix<T> {
+  T *A, *dinv;
+
+  DenseMatrix(unsigned n) : Matrix<T>(n, n) {
+    A = new T[n*n];
+    dinv = new T[n];
+  }
+  ~DenseMatrix() {
+    delete [] dinv;
+    delete [] A;
+  }
+  void amux(T d, T* x, T* y) const {
+    blas::gemva(this->m, this->n, d, A, x, y);
+  }
+  void precond_apply(T* x) const {
+    for (unsigned i=0; i<this->n; ++i) x[i] *= dinv[i];
+  }
+};
+
+static void rnd(double& a) { a = rand()/(double) RAND_MAX - 0.5; }
+static void rnd(dcomp& a)
+{
+  double re, im;
+  rnd(re);
+  rnd(im);
+  a = dcomp(re, im);
+}
+
+// A = D + E/sqrt(n) with a diagonal D of moderate condition; A is
+// hermitian positive definite if herm is set
+template<class T> static void gen(DenseMatrix<T>& A, bool herm)
+{
+  const unsigned n = A.n;
+  for (unsigned j=0; j<n; ++j)
+    for (unsigned i=0; i<n; ++i) {
+      rnd(A.A[i+j*n]);
+      A.A[i+j*n] *= (T) (0.5/sqrt((double) n));
+    }
+  if (herm)
+    for (unsigned j=0; j<n; ++j) {
+      A.A[j+j*n] = (T) 0.0;
+      for (unsigned i=0; i<j; ++i) A.A[j+i*n] = conj(A.A[i+j*n]);
+    }
+
+  for (unsigned i=0; i<n; ++i) {
+    A.A[i+i*n] += (T) (0.2+i%7);
+    A.dinv[i] = (T) 1.0 / A.A[i+i*n];
+  }
+}
+
+// relative residual of the p columns of X
+template<class T> static
+double resid(const DenseMatrix<T>& A, unsigned p, T* B, T* X)
+{
+  const unsigned n = A.n;
+  T* R = new T[n];
+  double res = 0.0;
+  for (unsigned j=0; j<p; ++j) {
+    blas::copy(n, B+j*n, R);
+    A.amux((T) -1.0, X+j*n, R);
+    res = MAX(res, blas::nrm2(n, R)/blas::nrm2(n, B+j*n));
+  }
+  delete [] R;
+  return res;
+}
+
+static bool report(const char* name, unsigned ret, unsigned steps,
+                   double res)
+{
+  const bool ok = (ret==0 && res<1e-8);
+  std::cout << name << ": " << steps << " steps, relative residual " << res
+            << (ok ? "" : " FAILED") << std::endl;
+  return ok;
+}
+
+template<class T> static bool check(unsigned n)
+{
+  const unsigned p = 3, m = 8, nmax = 1000;
+  const double tol = 1e-10;
+  bool ok = true;
+
+  DenseMatrix<T> A(n), S(n);
+  gen(A, false);
+  gen(S, true);
+
+  T *B = new T[n*p], *X = new T[n*p];
+  for (unsigned i=0; i<n*p; ++i) rnd(B[i]);
+
+  double eps;
+  unsigned steps, ret;
+
+  // several right-hand sides
+  eps = tol;
+  steps = nmax;
+  blas::setzero(n*p, X);
+  ret = BlockGMRes(A, p, B, X, eps, m, steps);
+  ok = report("BlockGMRes", ret, steps, resid(A, p, B, X)) && ok;
+
+  eps = tol;
+  steps = nmax;
+  blas::setzero(n*p, X);
+  ret = BlockCG(S, p, B, X, eps, steps);
+  ok = report("BlockCG", ret, steps, resid(S, p, B, X)) && ok;
+
+  // overlapped reductions
+  eps = tol;
+  steps = nmax;
+  blas::setzero(n, X);
+  ret = PipeCG(S, B, X, eps, steps);
+  ok = report("PipeCG", ret, steps, resid(S, 1, B, X)) && ok;
+
+  eps = tol;
+  steps = nmax;
+  blas::setzero(n, X);
+  ret = PipeGMRes(A, B, X, eps, m, steps);
+  ok = report("PipeGMRes", ret, steps, resid(A, 1, B, X)) && ok;
+
+  eps = tol;
+  steps = nmax;
+  blas::setzero(n, X);
+  ret = sGMRes(A, B, X, eps, m, 4, steps);
+  ok = report("sGMRes", ret, steps, resid(A, 1, B, X)) && ok;
+
+  // consecutive solves with the same recycled space
+  RecycleSpace<T> Y;
+  for (unsigned j=0; j<p; ++j) {
+    eps = tol;
+    steps = nmax;
+    blas::setzero(n, X+j*n);
+    ret = GCRODR(A, B+j*n, X+j*n, eps, m, 5, steps, Y);
+    ok = report("GCRODR", ret, steps, resid(A, 1, B+j*n, X+j*n)) && ok;
+  }
+
+  delete [] X;
+  delete [] B;
+  return ok;
+}
+
+int main(int argc, char* argv[])
+{
+  const unsigned n = (argc>1) ? atoi(argv[1]) : 200;
+  srand(1);
+
+  std::cout << "real:" << std::endl;
+  bool ok = check<double>(n);
+  std::cout << "complex:" << std::endl;
+  ok = check<dcomp>(n) && ok;
+
+  std::cout << (ok ? "passed" : "FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
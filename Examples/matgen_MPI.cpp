@@ -0,0 +1,206 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+// Checks the distributed assembly matgenGeH_mpi/matgenHeH_mpi against the
+// sequential matgenGeH_sqntl/matgenHeH_sqntl.
+// example: mpirun -np 4 ./matgen_MPI 20000
+// Each processor generates the points and the block cluster tree and
+// assembles its blocks only. For the comparison processor 0 additionally
+// assembles the whole matrix sequentially (so keep N moderate); the
+// products with a random vector and the storage have to coincide.
+// Afterwards the blocks are redistributed by rebalanceH_MPI with a large
+// tolerance; each processor has to keep blocks and the product must not
+// change.
+
+#include <iostream>
+#include <cmath>
+#include <stdlib.h>
+#include "basmod.h"
+#include "bemcluster.h"
+#include "bemblcluster.h"
+#include "matgen_sqntl.h"
+#include "matgen_mpi.h"
+#include "H.h"
+#include "blas.h"
+
+struct point {
+  double x[3];
+  double getcenter(unsigned i) const { return x[i]; }
+  double getradius2() const { return 0.0; }
+};
+
+// regularized single layer kernel on the unit sphere
+struct MatGenSphere {
+  point* P;
+  unsigned* op_perm;
+
+  MatGenSphere(point* p, unsigned* op) : P(p), op_perm(op) { }
+
+  double kernel(unsigned i, unsigned j) const {
+    const point &a = P[op_perm[i]], &b = P[op_perm[j]];
+    double d = 0.0;
+    for (unsigned l=0; l<3; ++l) d += (a.x[l]-b.x[l])*(a.x[l]-b.x[l]);
+    return 1.0/(0.1+sqrt(d));
+  }
+  void cmpbl(unsigned b1, unsigned n1, unsigned b2, unsigned n2,
+             double* data) const {
+    for (unsigned j=0; j<n2; ++j)
+      for (unsigned i=0; i<n1; ++i) data[i+j*n1] = kernel(b1+i, b2+j);
+  }
+  void cmpblsym(unsigned b1, unsigned n1, double* data) const {
+    for (unsigned j=0; j<n1; ++j)
+      for (unsigned i=0; i<=j; ++i) *data++ = kernel(b1+i, b1+j);
+  }
+  double scale(unsigned, unsigned, unsigned, unsigned) const { return 1.0; }
+};
+
+static unsigned long nvals(unsigned n, mblock<double>** A)
+{
+  unsigned long s = 0;
+  for (unsigned i=0; i<n; ++i) s += A[i]->nvals();
+  return s;
+}
+
+// returns false if the distributed and the sequential assembly differ
+static bool check(unsigned N, MatGenSphere& MatGen,
+                  bemblcluster<point,point>* bl, bool herm, double eps,
+                  unsigned rankmax)
+{
+  const unsigned rank = COMM_AHMED.Get_rank(),
+    nproc = COMM_AHMED.Get_size();
+
+  // distributed
+  blcluster** blList;
+  unsigned* seq_part;
+  mblock<double>** A;
+  if (herm) matgenHeH_mpi(MatGen, bl, eps, rankmax, blList, seq_part, A);
+  else matgenGeH_mpi(MatGen, bl, eps, rankmax, blList, seq_part, A);
+  const unsigned nloc = seq_part[rank+1]-seq_part[rank];
+
+  unsigned long sz = nvals(nloc, A), szA = 0;
+  COMM_AHMED.Reduce(&sz, &szA, 1, MPI::UNSIGNED_LONG, MPI::SUM, 0);
+
+  double *x = new double[N], *y = new double[N];
+  srand(1);
+  for (unsigned i=0; i<N; ++i) x[i] = rand()/(double) RAND_MAX - 0.5;
+  blas::setzero(N, y);
+  if (herm) mltaHeHVec_MPI(1.0, A, x, y, nproc, seq_part, blList);
+  else mltaGeHVec_MPI(1.0, A, x, y, nproc, seq_part, blList);
+
+  bool ok = true;
+  if (rank==0) {
+    // sequential
+    mblock<double>** B;
+    allocmbls(bl, B);
+    if (herm) matgenHeH_sqntl(MatGen, bl, bl, false, eps, rankmax, B);
+    else matgenGeH_sqntl(MatGen, bl, bl, false, eps, rankmax, B);
+    const unsigned long szB = nvals(bl->nleaves(), B);
+
+    double* z = new double[N];
+    blas::setzero(N, z);
+    if (herm) mltaHeHVec(1.0, bl, B, x, z);
+    else mltaGeHVec(1.0, bl, B, x, z);
+    const double nrm = blas::nrm2(N, z);
+    blas::axpy(N, -1.0, y, z);
+    const double err = blas::nrm2(N, z)/nrm;
+
+    std::cout << std::endl << (herm ? "HeH" : "GeH") << ": storage "
+              << szA << " (sequential " << szB << "), relative error of"
+              << " the product " << err << std::endl;
+    ok = (szA==szB && err<1e-12);
+
+    delete [] z;
+    freembls(bl, B);
+  }
+  COMM_AHMED.Bcast(&ok, sizeof(bool), MPI::BYTE, 0);
+
+  // redistribute and multiply again
+  rebalanceH_MPI(blList, seq_part, A, herm, 0.5);
+  const unsigned nloc2 = seq_part[rank+1]-seq_part[rank];
+  sz = nvals(nloc2, A);
+  unsigned long szA2 = 0;
+  COMM_AHMED.Reduce(&sz, &szA2, 1, MPI::UNSIGNED_LONG, MPI::SUM, 0);
+  unsigned nempty = 0;
+  for (unsigned q=0; q<nproc; ++q)
+    if (seq_part[q]==seq_part[q+1]) ++nempty;
+
+  double* y2 = new double[N];
+  blas::setzero(N, y2);
+  if (herm) mltaHeHVec_MPI(1.0, A, x, y2, nproc, seq_part, blList);
+  else mltaGeHVec_MPI(1.0, A, x, y2, nproc, seq_part, blList);
+
+  if (rank==0) {
+    const double nrm = blas::nrm2(N, y);
+    blas::axpy(N, -1.0, y, y2);
+    const double err = blas::nrm2(N, y2)/nrm;
+    std::cout << "rebalanced: storage " << szA2 << ", " << nempty
+              << " empty parts, relative change of the product " << err
+              << std::endl;
+    ok = ok && szA2==szA && nempty==0 && err<1e-12;
+  }
+  COMM_AHMED.Bcast(&ok, sizeof(bool), MPI::BYTE, 0);
+
+  delete [] y2;
+  delete [] y;
+  delete [] x;
+  freembls(nloc2, A);
+  delete [] seq_part;
+  delete [] blList;
+  return ok;
+}
+
+int main(int argc, char* argv[])
+{
+  MPI::Init(argc, argv);
+  initAHMED(MPI::COMM_WORLD);
+
+  const unsigned N = (argc>1) ? atoi(argv[1]) : 10000;
+  const unsigned bmin = 20, rankmax = 100;
+  const double eta = 0.8, eps = 1e-6;
+
+  // random points on the unit sphere, the same on each processor
+  point* P = new point[N];
+  unsigned *op_perm = new unsigned[N], *po_perm = new unsigned[N];
+  srand(1);
+  for (unsigned i=0; i<N; ++i) {
+    const double u = 2.0*rand()/RAND_MAX-1.0, t = 2.0*M_PI*rand()/RAND_MAX;
+    const double r = sqrt(1.0-u*u);
+    P[i].x[0] = r*cos(t);
+    P[i].x[1] = r*sin(t);
+    P[i].x[2] = u;
+    op_perm[i] = po_perm[i] = i;
+  }
+
+  bemcluster<point>* cl = new bemcluster<point>(P, op_perm, 0, N);
+  cl->createClusterTree(bmin, op_perm, po_perm);
+  MatGenSphere MatGen(P, op_perm);
+
+  unsigned nblcks;
+  bemblcluster<point,point>* bl = new bemblcluster<point,point>(0, 0, N, N);
+  bl->subdivide(cl, cl, eta*eta, nblcks);
+  bool ok = check(N, MatGen, bl, false, eps, rankmax);
+  delete bl;
+
+  bl = new bemblcluster<point,point>(0, 0, N, N);
+  bl->subdivide_sym(cl, eta*eta, nblcks);
+  ok = check(N, MatGen, bl, true, eps, rankmax) && ok;
+  delete bl;
+
+  COUT((ok ? "passed" : "FAILED") << std::endl);
+
+  delete cl;
+  delete [] po_perm;
+  delete [] op_perm;
+  delete [] P;
+
+  MPI::Finalize();
+  return ok ? 0 : 1;
+}
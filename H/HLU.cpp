@@ -11,15 +11,18 @@
 
 #include "blcluster.h"
 #include "H.h"
+#include "workspace.h"
 
 // truncated A=LU decomposition of an H-matrix A, A is destroyed
 // L and U have to be initialized with initLtH_0() and initUtH_0(), resp.
+// if acc>0, the updates of the blocks of A are accumulated also across the
+// levels and are truncated once before the block is used (see initAccH)
 // returns true if successful, otherwise false
 
 template<class T> static
 bool HLU_(blcluster* const bl, mblock<T>** const A, mblock<T>** const L,
           mblock<T>** const U, const double eps, const unsigned rankmax,
-	  contBasis<T>* haar=NULL)
+	  contBasis<T>* haar=NULL, const unsigned acc=0)
 {
   if (bl->isleaf()) {
     unsigned idx = bl->getidx();
@@ -29,36 +32,42 @@ bool HLU_(blcluster* const bl, mblock<T>** const A, mblock<T>** const L,
     assert(bl->getnrs()==bl->getncs());
     unsigned i, j, k, ns = bl->getnrs();
     contBasis<T>* haarSon=NULL;
+    const bool lazy = (acc>0 && haar==NULL);
 
     for (i=0; i<ns; ++i) {
       blcluster *son = bl->getson(i, i);
       if(haar) haarSon = haar->son(i,i);
 
+      if (lazy && i>0) initAccH(son, A, acc==2);
       for (k=0; k<i; ++k) {
         blcluster *son1 = bl->getson(i, k), *son2 = bl->getson(k, i);
         mltaGeHGeH((T) -1.0, son1, L, son2, U, son, A, eps, rankmax, haarSon);
       }
-      if (!HLU_(son, A, L, U, eps, rankmax, haarSon)) return false;
+      if (!HLU_(son, A, L, U, eps, rankmax, haarSon, acc)) return false;
       delete haarSon;
 
       for (j=i+1; j<ns; ++j) {
         blcluster* sonU = bl->getson(i, j);
 	if(haar) haarSon = haar->son(i,j);
+        if (lazy && i>0) initAccH(sonU, A, acc==2);
         for (k=0; k<i; ++k) {
           blcluster *son1 = bl->getson(i, k), *son2 = bl->getson(k, j);
           mltaGeHGeH((T) -1.0, son1, L, son2, U, sonU, A, eps, rankmax,
 		  haarSon);
         }
+        if (lazy) flushAccH(sonU, A);
         LtHGeH_solve(son, L, sonU, A, U, eps, rankmax, haarSon);
 	delete haarSon;
 
         blcluster* sonL = bl->getson(j, i);
 	if(haar) haarSon = haar->son(j,i);
+        if (lazy && i>0) initAccH(sonL, A, acc==2);
         for (k=0; k<i; ++k) {
           blcluster *son1 = bl->getson(j, k), *son2 = bl->getson(k, i);
           mltaGeHGeH((T) -1.0, son1, L, son2, U, sonL, A, eps, rankmax,
 		  haarSon);
         }
+        if (lazy) flushAccH(sonL, A);
         GeHUtH_solve(son, U, sonL, A, L, eps, rankmax, haarSon);
 	delete haarSon;
       }
@@ -109,11 +118,12 @@ bool HUhDU_(blcluster* const bl, mblock<T>** const A, int* const piv,
 
 // truncated Cholesky A=U^HU decomp. of a symm. H-matrix A
 // upon completion A contains the upper triangular factor
+// if acc>0, the updates are accumulated as in HLU_
 // returns true if successful, otherwise false
 template<class T> static
 bool HCholesky_(blcluster* const bl, mblock<T>** const A,
                 const double eps, const unsigned rankmax,
-                contBasis<T>* haar=NULL)
+                contBasis<T>* haar=NULL, const unsigned acc=0)
 {
   if (bl->isleaf()) {
     if (A[bl->getidx()]->decomp_Cholesky())
@@ -121,29 +131,33 @@ bool HCholesky_(blcluster* const bl, mblock<T>** const A,
   } else {
     assert(bl->getnrs()==bl->getncs());
     unsigned i, j, k, ns = bl->getnrs();
+    const bool lazy = (acc>0 && haar==NULL);
 
     contBasis<T>* haarSon=NULL;
     for (i=0; i<ns; ++i) {
       if(haar) haarSon = haar->son(i,i);
 
       blcluster *son = bl->getson(i, i);
+      if (lazy && i>0) initAccH(son, A, acc==2);
       for (k=0; k<i; ++k) {
 	blcluster *son1 = bl->getson(k, i);
 	mltaGeHhGeH_toHeH((T) -1.0, son1, A, son1, A, son, A, eps, rankmax,
 			  haarSon);
       }
-      if (!HCholesky_(son, A, eps, rankmax, haarSon)) return false;
+      if (!HCholesky_(son, A, eps, rankmax, haarSon, acc)) return false;
       delete haarSon;
 
       for (j=i+1; j<ns; ++j) {
 	blcluster* sonU = bl->getson(i, j);
 	if(haar) haarSon = haar->son(i,j);
 
+	if (lazy && i>0) initAccH(sonU, A, acc==2);
 	for (k=0; k<i; ++k) {
 	  blcluster *son1 = bl->getson(k, i), *son2 = bl->getson(k, j);
 	  mltaGeHhGeH((T) -1.0, son1, A, son2, A, sonU, A, eps, rankmax, 
 		      haarSon);
 	}
+	if (lazy) flushAccH(sonU, A);
 	UtHhGeH_solve(son, A, sonU, A, eps, rankmax, haarSon);
 	delete haarSon;
       }
@@ -381,6 +395,234 @@ bool genCholprecond(blcluster* bl, mblock<float>** A, double delta,
 }
 
 
+// Task parallel versions of HLU_ and HCholesky_ for shared memory.
+// On each level the block operations are generated in right-looking order
+// as OpenMP tasks whose dependencies are the sons (i,j) they read or
+// modify. The updates of a son are applied in the same order as in the
+// sequential version. Blocks with less than HTASK_MIN rows are
+// factorized sequentially.
+// Operations with sons which are zero and stay zero are not generated.
+// For matrices in nested dissection ordering the sons (0,1) and (1,0) of
+// the domains are zero, so that the two domains are factorized
+// concurrently and the separator is processed after both of them, as in
+// HLU_ND without MPI.
+
+#define HTASK_MIN 256
+
+// is the son bl a zero leaf (e.g. the coupling of two domains)? A leaf
+// with pending accumulated updates (fill from the father) is not zero
+template<class T> static bool isZero_(blcluster* bl, mblock<T>** A)
+{
+  if (bl->isnleaf()) return false;
+  mblock<T>* mbl = A[bl->getidx()];
+  return mbl->isLrM() && mbl->rank()==0 && !mbl->isAcc();
+}
+
+// the flag ok is written by other tasks
+static bool isOk_(bool* ok)
+{
+  bool b;
+#pragma omp atomic read
+  b = *ok;
+  return b;
+}
+
+// if acc>0, the sons which are updated accumulate their updates as in HLU_;
+// they are initialized before the tasks are generated and flushed by the
+// task which uses them first
+template<class T> static
+void HLU_tsk_(blcluster* const bl, mblock<T>** const A, mblock<T>** const L,
+              mblock<T>** const U, const double eps, const unsigned rankmax,
+              contBasis<T>* haar, const unsigned acc, bool* ok)
+{
+  if (bl->isleaf() || bl->getn1()<HTASK_MIN) {
+    if (!HLU_(bl, A, L, U, eps, rankmax, haar, acc)) {
+#pragma omp atomic write
+      *ok = false;
+    }
+    return;
+  }
+
+  assert(bl->getnrs()==bl->getncs());
+  const unsigned ns = bl->getnrs();
+  char* tok = new char[ns*ns];                // dependency tokens of the sons
+  bool* zero = new bool[ns*ns];               // sons which remain zero
+  for (unsigned i=0; i<ns; ++i)
+    for (unsigned j=0; j<ns; ++j)
+      zero[i*ns+j] = (i!=j && isZero_(bl->getson(i, j), A));
+
+  const bool lazy = (acc>0 && haar==NULL);
+  if (lazy)
+    for (unsigned i=1; i<ns; ++i)
+      for (unsigned j=1; j<ns; ++j) initAccH(bl->getson(i, j), A, acc==2);
+
+  for (unsigned i=0; i<ns; ++i) {
+    blcluster* son = bl->getson(i, i);
+    contBasis<T>* hs = haar ? haar->son(i, i) : NULL;
+
+#pragma omp task depend(inout: tok[i*ns+i])
+    {
+      if (isOk_(ok)) HLU_tsk_(son, A, L, U, eps, rankmax, hs, acc, ok);
+      delete hs;
+    }
+
+    for (unsigned j=i+1; j<ns; ++j) {
+      blcluster *sonU = bl->getson(i, j), *sonL = bl->getson(j, i);
+
+      if (!zero[i*ns+j]) {
+        contBasis<T>* hsU = haar ? haar->son(i, j) : NULL;
+#pragma omp task depend(in: tok[i*ns+i]) depend(inout: tok[i*ns+j])
+        {
+          if (lazy) flushAccH(sonU, A);
+          if (isOk_(ok)) LtHGeH_solve(son, L, sonU, A, U, eps, rankmax, hsU);
+          delete hsU;
+        }
+      }
+
+      if (!zero[j*ns+i]) {
+        contBasis<T>* hsL = haar ? haar->son(j, i) : NULL;
+#pragma omp task depend(in: tok[i*ns+i]) depend(inout: tok[j*ns+i])
+        {
+          if (lazy) flushAccH(sonL, A);
+          if (isOk_(ok)) GeHUtH_solve(son, U, sonL, A, L, eps, rankmax, hsL);
+          delete hsL;
+        }
+      }
+    }
+
+    for (unsigned j=i+1; j<ns; ++j)
+      for (unsigned k=i+1; k<ns; ++k) {
+        if (zero[j*ns+i] || zero[i*ns+k]) continue;
+        zero[j*ns+k] = false;
+        blcluster *son1 = bl->getson(j, i), *son2 = bl->getson(i, k),
+          *son3 = bl->getson(j, k);
+        contBasis<T>* hs3 = haar ? haar->son(j, k) : NULL;
+
+#pragma omp task depend(in: tok[j*ns+i], tok[i*ns+k]) depend(inout: tok[j*ns+k])
+        {
+          if (isOk_(ok)) mltaGeHGeH((T) -1.0, son1, L, son2, U, son3, A, eps,
+                                    rankmax, hs3);
+          delete hs3;
+        }
+      }
+  }
+
+#pragma omp taskwait
+  if (lazy) flushAccH(bl, A);       // sons which have not been used
+  delete [] zero;
+  delete [] tok;
+}
+
+template<class T> static
+bool HLU_omp_(blcluster* const bl, mblock<T>** const A, mblock<T>** const L,
+              mblock<T>** const U, const double eps, const unsigned rankmax,
+              contBasis<T>* haar, const unsigned acc)
+{
+  bool ok = true;
+#pragma omp parallel
+  {
+#pragma omp single
+    HLU_tsk_(bl, A, L, U, eps, rankmax, haar, acc, &ok);
+    releaseWork();                  // the tasks are finished after single
+  }
+  return ok;
+}
+
+template<class T> static
+void HCholesky_tsk_(blcluster* const bl, mblock<T>** const A,
+                    const double eps, const unsigned rankmax,
+                    contBasis<T>* haar, const unsigned acc, bool* ok)
+{
+  if (bl->isleaf() || bl->getn1()<HTASK_MIN) {
+    if (!HCholesky_(bl, A, eps, rankmax, haar, acc)) {
+#pragma omp atomic write
+      *ok = false;
+    }
+    return;
+  }
+
+  assert(bl->getnrs()==bl->getncs());
+  const unsigned ns = bl->getnrs();
+  char* tok = new char[ns*ns];                // dependency tokens of the sons
+  bool* zero = new bool[ns*ns];               // sons which remain zero
+  for (unsigned i=0; i<ns; ++i)
+    for (unsigned j=i; j<ns; ++j)
+      zero[i*ns+j] = (i!=j && isZero_(bl->getson(i, j), A));
+
+  const bool lazy = (acc>0 && haar==NULL);
+  if (lazy)
+    for (unsigned i=1; i<ns; ++i)
+      for (unsigned j=i; j<ns; ++j) initAccH(bl->getson(i, j), A, acc==2);
+
+  for (unsigned i=0; i<ns; ++i) {
+    blcluster* son = bl->getson(i, i);
+    contBasis<T>* hs = haar ? haar->son(i, i) : NULL;
+
+#pragma omp task depend(inout: tok[i*ns+i])
+    {
+      if (isOk_(ok)) HCholesky_tsk_(son, A, eps, rankmax, hs, acc, ok);
+      delete hs;
+    }
+
+    for (unsigned j=i+1; j<ns; ++j) {
+      if (zero[i*ns+j]) continue;
+      blcluster* sonU = bl->getson(i, j);
+      contBasis<T>* hsU = haar ? haar->son(i, j) : NULL;
+
+#pragma omp task depend(in: tok[i*ns+i]) depend(inout: tok[i*ns+j])
+      {
+        if (lazy) flushAccH(sonU, A);
+        if (isOk_(ok)) UtHhGeH_solve(son, A, sonU, A, eps, rankmax, hsU);
+        delete hsU;
+      }
+    }
+
+    // update of the upper part of the trailing sons
+    for (unsigned j=i+1; j<ns; ++j)
+      for (unsigned k=j; k<ns; ++k) {
+        if (zero[i*ns+j] || zero[i*ns+k]) continue;
+        zero[j*ns+k] = false;
+        blcluster *son1 = bl->getson(i, j), *son2 = bl->getson(i, k),
+          *son3 = bl->getson(j, k);
+        contBasis<T>* hs3 = haar ? haar->son(j, k) : NULL;
+
+#pragma omp task depend(in: tok[i*ns+j], tok[i*ns+k]) depend(inout: tok[j*ns+k])
+        {
+          if (isOk_(ok)) {
+            if (j==k)
+              mltaGeHhGeH_toHeH((T) -1.0, son1, A, son1, A, son3, A, eps,
+                                rankmax, hs3);
+            else
+              mltaGeHhGeH((T) -1.0, son1, A, son2, A, son3, A, eps,
+                          rankmax, hs3);
+          }
+          delete hs3;
+        }
+      }
+  }
+
+#pragma omp taskwait
+  if (lazy) flushAccH(bl, A);       // sons which have not been used
+  delete [] zero;
+  delete [] tok;
+}
+
+template<class T> static
+bool HCholesky_omp_(blcluster* const bl, mblock<T>** const A,
+                    const double eps, const unsigned rankmax,
+                    contBasis<T>* haar, const unsigned acc)
+{
+  bool ok = true;
+#pragma omp parallel
+  {
+#pragma omp single
+    HCholesky_tsk_(bl, A, eps, rankmax, haar, acc, &ok);
+    releaseWork();                  // the tasks are finished after single
+  }
+  return ok;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Instanzen
 //
@@ -389,66 +631,66 @@ bool genCholprecond(blcluster* bl, mblock<float>** A, double delta,
 bool HLU(blcluster* const bl, mblock<double>** const A,
          mblock<double>** const L, mblock<double>** const U,
          const double eps, const unsigned rankmax,
-	 contBasis<double>* haar)
+	 contBasis<double>* haar, unsigned acc)
 {
-  return HLU_(bl, A, L, U, eps, rankmax, haar);
+  return HLU_(bl, A, L, U, eps, rankmax, haar, acc);
 }
 
 
 bool HLU(blcluster* const bl, mblock<float>** const A,
          mblock<float>** const L, mblock<float>** const U,
          const double eps, const unsigned rankmax, 
-	 contBasis<float>* haar)
+	 contBasis<float>* haar, unsigned acc)
 {
-  return HLU_(bl, A, L, U, eps, rankmax, haar);
+  return HLU_(bl, A, L, U, eps, rankmax, haar, acc);
 }
 
 
 bool HLU(blcluster* const bl, mblock<dcomp>** const A,
          mblock<dcomp>** const L, mblock<dcomp>** const U,
          const double eps, const unsigned rankmax,
-	 contBasis<dcomp>* haar)
+	 contBasis<dcomp>* haar, unsigned acc)
 {
-  return HLU_(bl, A, L, U, eps, rankmax, haar);
+  return HLU_(bl, A, L, U, eps, rankmax, haar, acc);
 }
 
 
 bool HLU(blcluster* const bl, mblock<scomp>** const A,
          mblock<scomp>** const L, mblock<scomp>** const U,
          const double eps, const unsigned rankmax,
-	 contBasis<scomp>* haar)
+	 contBasis<scomp>* haar, unsigned acc)
 {
-  return HLU_(bl, A, L, U, eps, rankmax, haar);
+  return HLU_(bl, A, L, U, eps, rankmax, haar, acc);
 }
 
 
 
 bool HCholesky(blcluster* const bl, mblock<double>** const A,
                const double eps, const unsigned rankmax, 
-               contBasis<double>* haar)
+               contBasis<double>* haar, unsigned acc)
 {
-  return HCholesky_(bl, A, eps, rankmax, haar);
+  return HCholesky_(bl, A, eps, rankmax, haar, acc);
 }
 
 bool HCholesky(blcluster* const bl, mblock<float>** const A,
                const double eps, const unsigned rankmax, 
-               contBasis<float>* haar)
+               contBasis<float>* haar, unsigned acc)
 {
-  return HCholesky_(bl, A, eps, rankmax, haar);
+  return HCholesky_(bl, A, eps, rankmax, haar, acc);
 }
 
 bool HCholesky(blcluster* const bl, mblock<dcomp>** const A,
                const double eps, const unsigned rankmax, 
-               contBasis<dcomp>* haar)
+               contBasis<dcomp>* haar, unsigned acc)
 {
-  return HCholesky_(bl, A, eps, rankmax, haar);
+  return HCholesky_(bl, A, eps, rankmax, haar, acc);
 }
 
 bool HCholesky(blcluster* const bl, mblock<scomp>** const A,
                const double eps, const unsigned rankmax, 
-               contBasis<scomp>* haar)
+               contBasis<scomp>* haar, unsigned acc)
 {
-  return HCholesky_(bl, A, eps, rankmax, haar);
+  return HCholesky_(bl, A, eps, rankmax, haar, acc);
 }
 
 
@@ -467,3 +709,64 @@ bool HUhDU(blcluster* const bl, mblock<dcomp>** const A, int* const piv,
 bool HUhDU(blcluster* const bl, mblock<scomp>** const A, int* const piv,
 	   const double eps, const unsigned rankmax)
 { return HUhDU_(bl, A, piv, eps, rankmax); }
+
+
+bool HLU_omp(blcluster* const bl, mblock<double>** const A,
+             mblock<double>** const L, mblock<double>** const U,
+             const double eps, const unsigned rankmax,
+             contBasis<double>* haar, unsigned acc)
+{
+  return HLU_omp_(bl, A, L, U, eps, rankmax, haar, acc);
+}
+
+bool HLU_omp(blcluster* const bl, mblock<float>** const A,
+             mblock<float>** const L, mblock<float>** const U,
+             const double eps, const unsigned rankmax,
+             contBasis<float>* haar, unsigned acc)
+{
+  return HLU_omp_(bl, A, L, U, eps, rankmax, haar, acc);
+}
+
+bool HLU_omp(blcluster* const bl, mblock<dcomp>** const A,
+             mblock<dcomp>** const L, mblock<dcomp>** const U,
+             const double eps, const unsigned rankmax,
+             contBasis<dcomp>* haar, unsigned acc)
+{
+  return HLU_omp_(bl, A, L, U, eps, rankmax, haar, acc);
+}
+
+bool HLU_omp(blcluster* const bl, mblock<scomp>** const A,
+             mblock<scomp>** const L, mblock<scomp>** const U,
+             const double eps, const unsigned rankmax,
+             contBasis<scomp>* haar, unsigned acc)
+{
+  return HLU_omp_(bl, A, L, U, eps, rankmax, haar, acc);
+}
+
+bool HCholesky_omp(blcluster* const bl, mblock<double>** const A,
+                   const double eps, const unsigned rankmax,
+                   contBasis<double>* haar, unsigned acc)
+{
+  return HCholesky_omp_(bl, A, eps, rankmax, haar, acc);
+}
+
+bool HCholesky_omp(blcluster* const bl, mblock<float>** const A,
+                   const double eps, const unsigned rankmax,
+                   contBasis<float>* haar, unsigned acc)
+{
+  return HCholesky_omp_(bl, A, eps, rankmax, haar, acc);
+}
+
+bool HCholesky_omp(blcluster* const bl, mblock<dcomp>** const A,
+                   const double eps, const unsigned rankmax,
+                   contBasis<dcomp>* haar, unsigned acc)
+{
+  return HCholesky_omp_(bl, A, eps, rankmax, haar, acc);
+}
+
+bool HCholesky_omp(blcluster* const bl, mblock<scomp>** const A,
+                   const double eps, const unsigned rankmax,
+                   contBasis<scomp>* haar, unsigned acc)
+{
+  return HCholesky_omp_(bl, A, eps, rankmax, haar, acc);
+}
@@ -0,0 +1,340 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#include <assert.h>
+#include "lrmvec.h"
+
+// Low-rank leaves are small (n<=512) and of small rank (k<=16). For these
+// the overhead of two BLAS-2 calls dominates. The kernels below are
+// instantiated for each rank such that all loops over the rank are unrolled
+// by the compiler and the k partial sums of V^H x are kept in registers.
+// Compiled by gcc, the kernels use its vector extensions; complex numbers
+// are treated as pairs of reals. Other compilers (clang, icc and MSVC lack
+// __builtin_shuffle) use plain loops.
+//
+// With gcc, each kernel is compiled for the default instruction set and, on
+// x86, for AVX2 and AVX-512. The variant is chosen at runtime depending on
+// the processor.
+
+#ifdef __GNUC__
+#define LRMVEC_INLINE inline __attribute__((always_inline))
+#else
+#define LRMVEC_INLINE inline
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__INTEL_COMPILER) \
+  && __GNUC__>=5
+#define LRMVEC_SIMD
+#endif
+
+#if defined(LRMVEC_SIMD) && (defined(__x86_64__) || defined(__i386__))
+#define LRMVEC_X86
+#endif
+
+// the loops over the rank are unrolled also without -O3
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__>=8
+#define LRMVEC_UNROLL _Pragma("GCC unroll 16")
+#else
+#define LRMVEC_UNROLL
+#endif
+
+#ifdef LRMVEC_SIMD
+
+template<class R> struct lrmvec_int;
+template<> struct lrmvec_int<double> { typedef long long type; };
+template<> struct lrmvec_int<float> { typedef int type; };
+
+// vectors of VB bytes
+template<class R, unsigned VB> struct lrmvec_vec {
+  typedef R type __attribute__((vector_size(VB)));
+  typedef typename lrmvec_int<R>::type itype __attribute__((vector_size(VB)));
+};
+
+
+// y += d U V^H x; if C, the arrays contain complex numbers and d[0], d[1]
+// are the real and imaginary part of d
+template<class R, bool C, unsigned K, unsigned VB> static LRMVEC_INLINE
+void lrmvec_(unsigned n1, unsigned n2, const R* d, const R* U, const R* V,
+             const R* x, R* y)
+{
+  typedef typename lrmvec_vec<R,VB>::type vec;
+  typedef typename lrmvec_vec<R,VB>::itype ivec;
+  const unsigned W = VB/sizeof(R);
+  vec zero, A[K], B[K];
+  R tr[K], ti[K];
+  unsigned i, j, l;
+
+  __builtin_memset(&zero, 0, VB);
+  LRMVEC_UNROLL
+  for (l=0; l<K; ++l) A[l] = B[l] = zero;
+
+  if (C) {
+    // exchanges real and imaginary parts
+    ivec swp;
+    for (j=0; j<W; ++j) swp[j] = j^1;
+
+    // t = d V^H x
+    const unsigned m2 = 2*n2;
+    for (i=0; i+W<=m2; i+=W) {
+      vec xv, xs, v;
+      __builtin_memcpy(&xv, x+i, VB);
+      xs = __builtin_shuffle(xv, swp);
+      LRMVEC_UNROLL
+      for (l=0; l<K; ++l) {
+        __builtin_memcpy(&v, V+l*m2+i, VB);
+        A[l] += v*xv;
+        B[l] += v*xs;
+      }
+    }
+
+    LRMVEC_UNROLL
+
+    for (l=0; l<K; ++l) {
+      R sr = (R) 0.0, si = (R) 0.0;
+      for (j=0; j<W; j+=2) {
+        sr += A[l][j] + A[l][j+1];
+        si += B[l][j] - B[l][j+1];
+      }
+      for (j=i; j<m2; j+=2) {
+        const R *v = V+l*m2+j;
+        sr += v[0]*x[j] + v[1]*x[j+1];
+        si += v[0]*x[j+1] - v[1]*x[j];
+      }
+      tr[l] = d[0]*sr - d[1]*si;
+      ti[l] = d[0]*si + d[1]*sr;
+    }
+
+    // y += U t
+    const unsigned m1 = 2*n1;
+    LRMVEC_UNROLL
+    for (l=0; l<K; ++l) {
+      A[l] = zero + tr[l];
+      for (j=0; j<W; j+=2) {
+        B[l][j] = -ti[l];
+        B[l][j+1] = ti[l];
+      }
+    }
+    for (i=0; i+W<=m1; i+=W) {
+      vec yv, u;
+      __builtin_memcpy(&yv, y+i, VB);
+      LRMVEC_UNROLL
+      for (l=0; l<K; ++l) {
+        __builtin_memcpy(&u, U+l*m1+i, VB);
+        yv += u*A[l] + __builtin_shuffle(u, swp)*B[l];
+      }
+      __builtin_memcpy(y+i, &yv, VB);
+    }
+    for (; i<m1; i+=2)
+      LRMVEC_UNROLL
+      for (l=0; l<K; ++l) {
+        const R *u = U+l*m1+i;
+        y[i] += u[0]*tr[l] - u[1]*ti[l];
+        y[i+1] += u[0]*ti[l] + u[1]*tr[l];
+      }
+
+  } else {
+    for (i=0; i+W<=n2; i+=W) {
+      vec xv, v;
+      __builtin_memcpy(&xv, x+i, VB);
+      LRMVEC_UNROLL
+      for (l=0; l<K; ++l) {
+        __builtin_memcpy(&v, V+l*n2+i, VB);
+        A[l] += v*xv;
+      }
+    }
+
+    LRMVEC_UNROLL
+
+    for (l=0; l<K; ++l) {
+      R s = (R) 0.0;
+      for (j=0; j<W; ++j) s += A[l][j];
+      for (j=i; j<n2; ++j) s += V[l*n2+j]*x[j];
+      tr[l] = d[0]*s;
+      A[l] = zero + tr[l];
+    }
+
+    for (i=0; i+W<=n1; i+=W) {
+      vec yv, u;
+      __builtin_memcpy(&yv, y+i, VB);
+      LRMVEC_UNROLL
+      for (l=0; l<K; ++l) {
+        __builtin_memcpy(&u, U+l*n1+i, VB);
+        yv += u*A[l];
+      }
+      __builtin_memcpy(y+i, &yv, VB);
+    }
+    for (; i<n1; ++i)
+      LRMVEC_UNROLL
+      for (l=0; l<K; ++l) y[i] += U[l*n1+i]*tr[l];
+  }
+}
+
+#else
+
+// portable version; VB is not used
+template<class R, bool C, unsigned K, unsigned VB> static LRMVEC_INLINE
+void lrmvec_(unsigned n1, unsigned n2, const R* d, const R* U, const R* V,
+             const R* x, R* y)
+{
+  R tr[K], ti[K];
+  unsigned i, l;
+
+  if (C) {
+    // t = d V^H x
+    const unsigned m2 = 2*n2;
+    LRMVEC_UNROLL
+    for (l=0; l<K; ++l) {
+      R sr = (R) 0.0, si = (R) 0.0;
+      for (i=0; i<m2; i+=2) {
+        const R *v = V+l*m2+i;
+        sr += v[0]*x[i] + v[1]*x[i+1];
+        si += v[0]*x[i+1] - v[1]*x[i];
+      }
+      tr[l] = d[0]*sr - d[1]*si;
+      ti[l] = d[0]*si + d[1]*sr;
+    }
+
+    // y += U t
+    const unsigned m1 = 2*n1;
+    for (i=0; i<m1; i+=2)
+      LRMVEC_UNROLL
+      for (l=0; l<K; ++l) {
+        const R *u = U+l*m1+i;
+        y[i] += u[0]*tr[l] - u[1]*ti[l];
+        y[i+1] += u[0]*ti[l] + u[1]*tr[l];
+      }
+
+  } else {
+    LRMVEC_UNROLL
+    for (l=0; l<K; ++l) tr[l] = (R) 0.0;
+    for (i=0; i<n2; ++i)
+      LRMVEC_UNROLL
+      for (l=0; l<K; ++l) tr[l] += V[l*n2+i]*x[i];
+
+    LRMVEC_UNROLL
+    for (l=0; l<K; ++l) tr[l] *= d[0];
+
+    for (i=0; i<n1; ++i)
+      LRMVEC_UNROLL
+      for (l=0; l<K; ++l) y[i] += U[l*n1+i]*tr[l];
+  }
+}
+
+#endif
+
+#define LRMVEC_CASE(K)                                                  \
+  case K: lrmvec_<R,C,K,VB>(n1, n2, d, U, V, x, y); break;
+
+template<class R, bool C, unsigned VB> static LRMVEC_INLINE
+void lrmvec_sw_(unsigned n1, unsigned n2, unsigned k, const R* d, const R* U,
+                const R* V, const R* x, R* y)
+{
+  switch (k) {
+    LRMVEC_CASE(1)  LRMVEC_CASE(2)  LRMVEC_CASE(3)  LRMVEC_CASE(4)
+    LRMVEC_CASE(5)  LRMVEC_CASE(6)  LRMVEC_CASE(7)  LRMVEC_CASE(8)
+    LRMVEC_CASE(9)  LRMVEC_CASE(10) LRMVEC_CASE(11) LRMVEC_CASE(12)
+    LRMVEC_CASE(13) LRMVEC_CASE(14) LRMVEC_CASE(15) LRMVEC_CASE(16)
+  default:
+    break;
+  }
+}
+
+#undef LRMVEC_CASE
+
+template<class R, bool C> static
+void lrmvec_dflt_(unsigned n1, unsigned n2, unsigned k, const R* d,
+                  const R* U, const R* V, const R* x, R* y)
+{
+  lrmvec_sw_<R,C,16>(n1, n2, k, d, U, V, x, y);
+}
+
+#ifdef LRMVEC_X86
+
+template<class R, bool C> static __attribute__((target("avx2,fma")))
+void lrmvec_avx2_(unsigned n1, unsigned n2, unsigned k, const R* d,
+                  const R* U, const R* V, const R* x, R* y)
+{
+  lrmvec_sw_<R,C,32>(n1, n2, k, d, U, V, x, y);
+}
+
+template<class R, bool C> static __attribute__((target("avx512f,avx2,fma")))
+void lrmvec_avx512_(unsigned n1, unsigned n2, unsigned k, const R* d,
+                    const R* U, const R* V, const R* x, R* y)
+{
+  lrmvec_sw_<R,C,64>(n1, n2, k, d, U, V, x, y);
+}
+
+#endif
+
+
+// 0: default, 1: AVX2, 2: AVX-512
+static int lrmvec_getisa_()
+{
+#ifdef LRMVEC_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return 2;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return 1;
+#endif
+  return 0;
+}
+
+static const int lrmvec_isa = lrmvec_getisa_();
+
+template<class R, bool C> static
+void lrmvec_disp_(unsigned n1, unsigned n2, unsigned k, const R* d,
+                  const R* U, const R* V, const R* x, R* y)
+{
+  assert(k>0 && k<=LRMVEC_KMAX);
+#ifdef LRMVEC_X86
+  if (lrmvec_isa==2) lrmvec_avx512_<R,C>(n1, n2, k, d, U, V, x, y);
+  else if (lrmvec_isa==1) lrmvec_avx2_<R,C>(n1, n2, k, d, U, V, x, y);
+  else
+#endif
+    lrmvec_dflt_<R,C>(n1, n2, k, d, U, V, x, y);
+}
+
+
+// Instanzen
+
+void mltaLrMVec_k(unsigned n1, unsigned n2, unsigned k, double d,
+                  const double* U, const double* V, const double* x,
+                  double* y)
+{
+  lrmvec_disp_<double,false>(n1, n2, k, &d, U, V, x, y);
+}
+
+void mltaLrMVec_k(unsigned n1, unsigned n2, unsigned k, float d,
+                  const float* U, const float* V, const float* x, float* y)
+{
+  lrmvec_disp_<float,false>(n1, n2, k, &d, U, V, x, y);
+}
+
+void mltaLrMVec_k(unsigned n1, unsigned n2, unsigned k, dcomp d,
+                  const dcomp* U, const dcomp* V, const dcomp* x, dcomp* y)
+{
+  lrmvec_disp_<double,true>(n1, n2, k, (const double*) &d, (const double*) U,
+                            (const double*) V, (const double*) x, (double*) y);
+}
+
+void mltaLrMVec_k(unsigned n1, unsigned n2, unsigned k, scomp d,
+                  const scomp* U, const scomp* V, const scomp* x, scomp* y)
+{
+  lrmvec_disp_<float,true>(n1, n2, k, (const float*) &d, (const float*) U,
+                           (const float*) V, (const float*) x, (float*) y);
+}
+
+const char* mltaLrMVec_isa()
+{
+  if (lrmvec_isa==2) return "AVX-512";
+  if (lrmvec_isa==1) return "AVX2";
+  return "default";
+}
@@ -0,0 +1,68 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#include <fstream>
+#include "mblfile.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+bool mblFile::open(const char* fname)
+{
+  close();
+
+#ifndef WIN32
+  const int fd = ::open(fname, O_RDONLY);
+  if (fd<0) return false;
+  struct stat st;
+  if (fstat(fd, &st)!=0 || st.st_size==0) {
+    ::close(fd);
+    return false;
+  }
+  len = st.st_size;
+  // read-only, the pages may be returned to the system (see oocRelease_)
+  void* p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p==MAP_FAILED) return false;
+  base = (char*) p;
+  mapped = true;
+  return true;
+#else
+  // read the whole file instead
+  std::ifstream is(fname, std::ios::binary);
+  if (!is) return false;
+  is.seekg(0, std::ios::end);
+  len = is.tellg();
+  is.seekg(0, std::ios::beg);
+  base = new char[len];
+  assert(base!=NULL);
+  is.read(base, len);
+  mapped = false;
+  return (bool) is;
+#endif
+}
+
+void mblFile::close()
+{
+  if (base==NULL) return;
+#ifndef WIN32
+  if (mapped) munmap(base, len);
+  else
+#endif
+    delete [] base;
+  base = NULL;
+  len = 0;
+  mapped = false;
+}
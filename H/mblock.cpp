@@ -10,6 +10,11 @@
 
 
 #include "mblock.h"
+#include "lrmvec.h"
+#include "workspace.h"
+#include "ACA.h"
+
+#define EPS0 1e-64
 
 /* solves X (PL)^H = X L^H P^{-1} = B for X
 // L is unit lower triangular, X is stored in B
@@ -129,10 +134,12 @@ bool mblock<T>::mltaLrMVec_(T d, T* x, T* y) const
   assert(isLrM());
   const unsigned k = rank();
   if (k>0) {
-    for (unsigned l=0; l<k; ++l) {
-      const T e = d * blas::scpr(n2, data+k*n1+l*n2, x);
-      blas::axpy(n1, e, data+l*n1, y);
-    }
+    if (k<=LRMVEC_KMAX) mltaLrMVec_k(n1, n2, k, d, data, data+k*n1, x, y);
+    else
+      for (unsigned l=0; l<k; ++l) {
+        const T e = d * blas::scpr(n2, data+k*n1+l*n2, x);
+        blas::axpy(n1, e, data+l*n1, y);
+      }
     return true;
   } else return false;
 }
@@ -161,10 +168,12 @@ bool mblock<T>::mltaLrMhVec_(T d, T* x, T* y) const
   assert(isLrM());
   const unsigned k = rank();
   if (k>0) {
-    for (unsigned l=0; l<k; ++l) {
-      const T e = d * blas::scpr(n1, data+l*n1, x);
-      blas::axpy(n2, e, data+k*n1+l*n2, y);
-    }
+    if (k<=LRMVEC_KMAX) mltaLrMVec_k(n2, n1, k, d, data+k*n1, data, x, y);
+    else
+      for (unsigned l=0; l<k; ++l) {
+        const T e = d * blas::scpr(n1, data+l*n1, x);
+        blas::axpy(n2, e, data+k*n1+l*n2, y);
+      }
     return true;
   } else return false;
 }
@@ -218,6 +227,7 @@ bool mblock<T>::mltaLrMtGeM_(T d, unsigned p, T* X, unsigned ldX, T* Y,
 template<class T>
 bool mblock<T>::mltaVec_(T d, T* x, T* y) const
 {
+  if (info.prec) return mltaLp_('n', d, 1, x, 0, y, 0);
   if (isLrM()) return mltaLrMVec_(d, x, y);
   else {
     if (isHeM()) mltaHeMVec(d, x, y);    
@@ -234,6 +244,7 @@ template<class T>
 bool mblock<T>::mltaGeM_(T d, unsigned p, T* X, unsigned ldX,
 			   T* Y, unsigned ldY) const
 {
+  if (info.prec) return mltaLp_('N', d, p, X, ldX, Y, ldY);
   if (isLrM()) return mltaLrMGeM_(d, p, X, ldX, Y, ldY);
   else {
     if (isHeM()) mltaHeMGeM(d, p, X, ldX, Y, ldY);
@@ -249,6 +260,7 @@ bool mblock<T>::mltaGeM_(T d, unsigned p, T* X, unsigned ldX,
 template<class T>
 bool mblock<T>::mltahVec_(T d, T* x, T* y) const
 {
+  if (info.prec) return mltaLp_('h', d, 1, x, 0, y, 0);
   if (isLrM()) return mltaLrMhVec_(d, x, y);
   else {
     if (isHeM()) mltaHeMVec(d, x, y);
@@ -265,6 +277,7 @@ template<class T>
 bool mblock<T>::mltahGeM_(T d, unsigned p, T* X, unsigned ldX,
 			  T* Y, unsigned ldY) const
 {
+  if (info.prec) return mltaLp_('H', d, p, X, ldX, Y, ldY);
   if (isLrM()) return mltaLrMhGeM_(d, p, X, ldX, Y, ldY);
   else {
     if (isHeM()) mltaHeMGeM(d, p, X, ldX, Y, ldY);
@@ -279,6 +292,7 @@ bool mblock<T>::mltahGeM_(T d, unsigned p, T* X, unsigned ldX,
 template<class T>
 bool mblock<T>::mltatVec_(T d, T* x, T* y) const
 {
+  if (info.prec) return mltaLp_('t', d, 1, x, 0, y, 0);
   if (isLrM()) return mltaLrMtVec_(d, x, y);
   else {
     if (isHeM()) mltaHeMtVec(d, x, y);
@@ -294,6 +308,7 @@ template<class T>
 bool mblock<T>::mltatGeM_(T d, unsigned p, T* X, unsigned ldX,
 			  T* Y, unsigned ldY) const
 {
+  if (info.prec) return mltaLp_('T', d, p, X, ldX, Y, ldY);
   if (isLrM()) return mltaLrMtGeM_(d, p, X, ldX, Y, ldY);
   else {
     if (isHeM()) mltaHeMtGeM(d, p, X, ldX, Y, ldY);
@@ -305,6 +320,274 @@ bool mblock<T>::mltatGeM_(T d, unsigned p, T* X, unsigned ldX,
   }
 }
 
+// float <-> bfloat16 with rounding to nearest
+static inline unsigned short mblock_tobf16_(float x)
+{
+  unsigned u;
+  memcpy(&u, &x, sizeof(unsigned));
+  u += 0x7fff + ((u>>16)&1);
+  return (unsigned short) (u>>16);
+}
+
+static inline float mblock_frombf16_(unsigned short h)
+{
+  const unsigned u = ((unsigned) h)<<16;
+  float x;
+  memcpy(&x, &u, sizeof(float));
+  return x;
+}
+
+template<class T>
+void mblock<T>::setPrec_(unsigned p)
+{
+  typedef typename num_traits<T>::abs_type R;
+  assert(p<=2 && (p!=1 || sizeof(R)==sizeof(double)));
+  if (p==info.prec) return;
+
+  const unsigned long n = nvals();
+  if (info.prec) {                         // back to T first
+    T* const A = alloc_(n);
+    expandLp_(A);
+    freeLp_();
+    data = A;
+  }
+  if (p==0 || n==0) return;
+
+  const unsigned long nr = n*(sizeof(T)/sizeof(R));
+  const R* const x = (const R*) data;
+  if (p==1) {
+    float* const s = new float[nr];
+    assert(s!=NULL);
+    for (unsigned long i=0; i<nr; ++i) s[i] = (float) x[i];
+    free_(data);
+    lpdata.s = s;
+  } else {
+    unsigned short* const b = new unsigned short[nr];
+    assert(b!=NULL);
+    for (unsigned long i=0; i<nr; ++i) b[i] = mblock_tobf16_((float) x[i]);
+    free_(data);
+    lpdata.b = b;
+  }
+  data = NULL;
+  info.prec = p;
+}
+
+// the entries in precision T
+template<class T>
+void mblock<T>::expandLp_(T* A) const
+{
+  typedef typename num_traits<T>::abs_type R;
+  const unsigned long nr = nvals()*(sizeof(T)/sizeof(R));
+  R* const x = (R*) A;
+  if (info.prec==1)
+    for (unsigned long i=0; i<nr; ++i) x[i] = (R) lpdata.s[i];
+  else
+    for (unsigned long i=0; i<nr; ++i)
+      x[i] = (R) mblock_frombf16_(lpdata.b[i]);
+}
+
+// the entries are expanded to a temporary block; op is 'n', 'h', 't' for
+// vectors and 'N', 'H', 'T' for matrices
+template<class T>
+bool mblock<T>::mltaLp_(char op, T d, unsigned p, T* X, unsigned ldX,
+                        T* Y, unsigned ldY) const
+{
+  assert(info.prec);
+  mblockWork<T> wsp(nvals());
+  mblock<T> B(n1, n2);
+  B.info = info;
+  B.info.prec = 0;
+  B.bl_rank = bl_rank;
+  B.data = wsp.ptr();
+  expandLp_(B.data);
+
+  bool succ;
+  switch (op) {
+  case 'n': succ = B.mltaVec_(d, X, Y); break;
+  case 'N': succ = B.mltaGeM_(d, p, X, ldX, Y, ldY); break;
+  case 'h': succ = B.mltahVec_(d, X, Y); break;
+  case 'H': succ = B.mltahGeM_(d, p, X, ldX, Y, ldY); break;
+  case 't': succ = B.mltatVec_(d, X, Y); break;
+  default: succ = B.mltatGeM_(d, p, X, ldX, Y, ldY);
+  }
+
+  B.data = NULL;
+  return succ;
+}
+
+
+// A is unpacked to the scratch array of the thread
+template<class T>
+void mblock<T>::mltaPckGeM_(char op, char trans, T d, unsigned p,
+                            T* X, unsigned ldX, T* Y, unsigned ldY) const
+{
+  mblockWork<T> wsp((unsigned long) n1*n1);
+  T* const A = wsp.ptr();
+  unpack_(op, A);
+  if (trans=='N') blas::gemma(n1, n1, p, d, A, n1, X, ldX, Y, ldY);
+  else if (trans=='H') blas::gemhma(n1, n1, p, d, A, n1, X, ldX, Y, ldY);
+  else blas::gemtma(n1, n1, p, d, A, n1, X, ldX, Y, ldY);
+}
+
+
+// add U V^H to the pending updates
+template<class T>
+void mblock<T>::addAcc_(unsigned k, T* U, unsigned ldU, T* V, unsigned ldV,
+                        double eps, unsigned kgoal)
+{
+  assert(isLrM() && acc!=NULL);
+  mblockAcc<T>* const a = acc;
+
+  // small blocks become dense anyway, nothing is gained by collecting
+  if ((unsigned long) (bl_rank+k)*(n1+n2)>=(unsigned long) n1*n2) {
+    truncAcc_();
+    acc = NULL;
+    addLrM(k, U, ldU, V, ldV, eps, kgoal);
+    acc = a;
+    return;
+  }
+
+  if (a->k+k>a->cap) {
+    const unsigned cap = MAX(a->k+k, 2*a->cap);
+    T *U1 = new T[cap*n1], *V1 = new T[cap*n2];
+    assert(U1!=NULL && V1!=NULL);
+    if (a->k>0) {
+      blas::copy(a->k*n1, a->U, U1);
+      blas::copy(a->k*n2, a->V, V1);
+    }
+    delete [] a->U;
+    delete [] a->V;
+    a->U = U1;
+    a->V = V1;
+    a->cap = cap;
+  }
+
+  for (unsigned l=0; l<k; ++l) {
+    blas::copy(n1, U+l*ldU, a->U+(a->k+l)*n1);
+    blas::copy(n2, V+l*ldV, a->V+(a->k+l)*n2);
+  }
+  a->k += k;
+  a->kmax = MAX(a->kmax, k);
+  a->eps = eps;
+  a->kgoal = kgoal;
+
+  // The QR based truncation of rank r+p costs O((r+p)^2), so collecting
+  // pays off only as long as p stays below r. The randomized SVD is
+  // linear in p and collects four times as many updates.
+  const unsigned r = MAX(bl_rank, a->kmax);
+  if (a->k>=(a->rsvd ? 4*r : r) ||
+      (unsigned long) (bl_rank+a->k)*(n1+n2)>=(unsigned long) n1*n2)
+    truncAcc_();
+}
+
+
+// add the pending updates to this block with a single truncation
+template<class T>
+void mblock<T>::truncAcc_()
+{
+  mblockAcc<T>* const a = acc;
+  if (a==NULL || a->k==0) return;
+
+  acc = NULL;          // the following additions are not accumulated
+  if (isLrM() && a->rsvd &&
+      addtrll_rsvd_(a->k, a->U, n1, a->V, n2, a->eps, a->kgoal,
+                    MAX(bl_rank, a->kmax)+8)) {
+    if (bl_rank*(n1+n2)>n1*n2) convLrM_toGeM();
+  } else
+    addLrM(a->k, a->U, n1, a->V, n2, a->eps, a->kgoal);
+
+  a->k = 0;
+  acc = a;
+}
+
+
+// adds U V^H to this low-rank matrix and truncates the sum W Z^H by a
+// randomized SVD (N. Halko, P.G. Martinsson, J.A. Tropp, SIAM Rev. 53, 2011):
+// Q is an orthonormal basis of W Z^H Om with a random n2 x l matrix Om, and
+// the SVD of Z W^H Q gives the truncation. The cost is O((n1+n2) ksum l)
+// instead of O((n1+n2) ksum^2) for the QR decompositions of W and Z. The
+// number of samples l is doubled until the l-th singular value is below
+// delta; returns false if the sampling does not pay off or LAPACK fails,
+// the block is not changed in this case
+template<class T>
+bool mblock<T>::addtrll_rsvd_(unsigned k, T* U, unsigned ldU, T* V,
+                              unsigned ldV, double delta, unsigned kgoal,
+                              unsigned l)
+{
+  typedef typename num_traits<T>::abs_type abs_T;
+  assert(isLrM());
+
+  const unsigned ksum = bl_rank + k, lmax = MIN(MIN(n1, n2), ksum);
+  l = MIN(l, lmax);
+  if (2*l>=ksum) return false;
+
+  // W = (U1, U), Z = (V1, V)
+  mblockWork<T> wsp(ksum*(n1+n2));
+  T *W = wsp.ptr(), *Z = W + ksum*n1;
+  blas::copy(bl_rank*n1, data, W);
+  blas::copy(bl_rank*n2, data+bl_rank*n1, Z);
+  for (unsigned j=0; j<k; ++j) {
+    blas::copy(n1, U+j*ldU, W+(bl_rank+j)*n1);
+    blas::copy(n2, V+j*ldV, Z+(bl_rank+j)*n2);
+  }
+
+  unsigned long seed = 1;
+  for (;;) {
+    const unsigned LWORK = 5*(n1+n2+l);
+    T* const Q = new T[(n1+2*n2+ksum+l+1)*l+LWORK];
+    assert(Q!=NULL);
+    T* const B = Q + n1*l;                   // n2*l
+    T* const Om = B + n2*l;                  // n2*l
+    T* const G = Om + n2*l;                  // ksum*l
+    T* const VT = G + ksum*l;                // l*l
+    T* const tau = VT + l*l;                 // l
+    T* const WORK = tau + l;                 // LWORK
+    abs_T* const S = new abs_T[l];
+
+    // Q = orth(W Z^H Om)
+    for (unsigned i=0; i<n2*l; ++i) Om[i] = (T) ACA_randn(seed);
+    blas::gemhm(n2, ksum, l, (T) 1.0, Z, n2, Om, n2, G, ksum);
+    blas::gemm(n1, ksum, l, (T) 1.0, W, n1, G, ksum, Q, n1);
+    bool ok = blas::geqrf(n1, l, Q, tau, LWORK, WORK)==0
+      && blas::orgqr(n1, l, Q, tau, LWORK, WORK)==0;
+
+    // B = Z W^H Q = P S R^H, hence W Z^H = Q B^H = (Q R) S P^H
+    if (ok) {
+      blas::gemhm(n1, ksum, l, (T) 1.0, W, n1, Q, n1, G, ksum);
+      blas::gemm(n2, ksum, l, (T) 1.0, Z, n2, G, ksum, B, n2);
+      ok = blas::gesvd(n2, l, B, S, VT, l, LWORK, WORK)==0;
+    }
+
+    if (!ok) {                                  // LAPACK failed
+      delete [] S;
+      delete [] Q;
+      return false;
+    }
+
+    if (l<lmax && S[l-1]>delta*S[0]) {          // more samples are needed
+      delete [] S;
+      delete [] Q;
+      l = MIN(2*l, lmax);
+      if (2*l>=ksum) return false;
+      continue;
+    }
+
+    unsigned kt = MIN(l, kgoal);
+    while (kt>0 && (S[kt-1]<=delta*S[0] || S[kt-1]<EPS0)) --kt;
+
+    setrank(kt);
+    if (kt>0) {
+      blas::gemmh(n1, l, kt, (T) 1.0, Q, n1, VT, l, data, n1);
+      for (unsigned j=0; j<kt; ++j) blas::scal(n1, (T) S[j], data+j*n1);
+      blas::copy(kt*n2, B, data+kt*n1);
+    }
+
+    delete [] S;
+    delete [] Q;
+    return true;
+  }
+}
+
 
 
 // Instanzen
@@ -430,6 +713,38 @@ bool mblock<scomp>::mltatGeM(scomp d, unsigned p, scomp* X, unsigned ldX,
 { return mltatGeM_(d, p, X, ldX, Y, ldY); }
 
 
+template void mblock<double>::addAcc_(unsigned, double*, unsigned, double*,
+                                     unsigned, double, unsigned);
+template void mblock<float>::addAcc_(unsigned, float*, unsigned, float*,
+                                    unsigned, double, unsigned);
+template void mblock<dcomp>::addAcc_(unsigned, dcomp*, unsigned, dcomp*,
+                                    unsigned, double, unsigned);
+template void mblock<scomp>::addAcc_(unsigned, scomp*, unsigned, scomp*,
+                                    unsigned, double, unsigned);
+
+template void mblock<double>::truncAcc_();
+template void mblock<float>::truncAcc_();
+template void mblock<dcomp>::truncAcc_();
+template void mblock<scomp>::truncAcc_();
+
+template void mblock<double>::mltaPckGeM_(char, char, double, unsigned,
+                                         double*, unsigned, double*,
+                                         unsigned) const;
+template void mblock<float>::mltaPckGeM_(char, char, float, unsigned,
+                                        float*, unsigned, float*,
+                                        unsigned) const;
+template void mblock<dcomp>::mltaPckGeM_(char, char, dcomp, unsigned,
+                                        dcomp*, unsigned, dcomp*,
+                                        unsigned) const;
+template void mblock<scomp>::mltaPckGeM_(char, char, scomp, unsigned,
+                                        scomp*, unsigned, scomp*,
+                                        unsigned) const;
+
+template<> void mblock<double>::setPrec(unsigned p) { setPrec_(p); }
+template<> void mblock<float>::setPrec(unsigned p) { setPrec_(p); }
+template<> void mblock<dcomp>::setPrec(unsigned p) { setPrec_(p); }
+template<> void mblock<scomp>::setPrec(unsigned p) { setPrec_(p); }
+
 template<> double mblock<double>::nrmF2() const { return nrmF2_(); }
 template<> double mblock<float>::nrmF2() const { return nrmF2_(); }
 template<> double mblock<dcomp>::nrmF2() const { return nrmF2_(); }
@@ -12,6 +12,7 @@
 #include <cmath>
 #include "mblock.h"
 #include "basmod.h"
+#include "workspace.h"
 
 #define EPS0 1e-32
 
@@ -24,7 +25,8 @@ void mblock<scomp>::get_svals_LrM(float* sigma) const
   const unsigned LWORK = 10*k;
   const unsigned size = k*(n1+n2+k+2)+LWORK;
 
-  scomp* const tmp1 = new scomp[size];
+  mblockWork<scomp> wsp(size);
+  scomp* const tmp1 = wsp.ptr();
   assert(tmp1!=NULL);
 
   // copy data to tmp1
@@ -51,8 +53,6 @@ void mblock<scomp>::get_svals_LrM(float* sigma) const
   // SVD von R1*R2^H
   INFO = blas::svals(k, k, R, sigma, LWORK, WORK);
   assert(INFO==0);
-
-  delete [] tmp1;
 }
 
 template<>
@@ -72,13 +72,13 @@ void mblock<scomp>::convLrM_toGeM()
   assert(isLrM());
 
   if (bl_rank>0) {
-    scomp* const new_data = new scomp[n1*n2];
+    scomp* const new_data = alloc_(n1*n2);
     assert(new_data!=NULL);
 
     blas::gemmh(n1, bl_rank, n2, C_ONE, data, n1, data+bl_rank*n1, n2,
                 new_data, n1);
 
-    delete [] data;
+    free_(data);
     data = new_data;
     info.is_LrM = info.is_UtM = info.is_LtM = info.is_HeM = info.is_SyM = 0;
   } else init0_GeM(n1, n2);
@@ -105,9 +105,11 @@ void mblock<scomp>::convGeM_toLrM(double eps)
 
   unsigned nmin = MIN(n1, n2), LWORK = 5*(n1+n2);
   int INFO;
-  scomp *tmp = new scomp[(n1+nmin)*n2+LWORK];
+  mblockWork<scomp> wsp((n1+nmin)*n2+LWORK);
+  scomp *tmp = wsp.ptr();
   scomp *VT = tmp + n1*n2, *WORK = VT + nmin*n2;
-  float *S = new float[nmin];
+  mblockWork<float> wspS(nmin);
+  float *S = wspS.ptr();
 
   blas::copy(n1*n2, data, tmp);
 
@@ -123,9 +125,6 @@ void mblock<scomp>::convGeM_toLrM(double eps)
   for (unsigned l=0; l<kt; ++l)
     for (unsigned j=0; j<n2; ++j)
       data[j+n2*l+kt*n1] = S[l] * conj(VT[nmin*j+l]);
-
-  delete [] S;
-  delete [] tmp;
 }
 
 
@@ -181,14 +180,14 @@ void mblock<scomp>::append(unsigned k, scomp* U, unsigned ldU, scomp* V,
   assert(isLrM());
 
   unsigned rank_new = bl_rank+k;
-  scomp *tmp = new scomp[rank_new*(n1+n2)];
+  scomp *tmp = alloc_(rank_new*(n1+n2));
   blas::copy(bl_rank*n1, data, tmp);
   for (unsigned i=0; i<k; i++)
     blas::copy(n1, U+i*ldU, tmp+bl_rank*n1+i*n1);
   blas::copy(bl_rank*n2, data+bl_rank*n1, tmp+rank_new*n1);
   for (unsigned i=0; i<k; i++)
     blas::copy(n2, V+i*ldV, tmp+rank_new*n1+bl_rank*n2+i*n2);
-  delete [] data;
+  free_(data);
   data = tmp;
   bl_rank = rank_new;
 }
@@ -209,7 +208,8 @@ void mblock<scomp>::addtrll(unsigned k, scomp* U, unsigned ldU, scomp* V,
       unsigned mmin=MIN(n1, ksum), nmin=MIN(n2, ksum), amin=MIN(mmin, nmin);
       unsigned size = ksum*(n1+n2)+LWORK+mmin+(mmin+amin+1)*nmin;
 
-      scomp *tmp1=new scomp[size], *tmp2=tmp1+ksum*n1; // tmp2 = new V
+      mblockWork<scomp> wsp(size);
+      scomp *tmp1=wsp.ptr(), *tmp2=tmp1+ksum*n1; // tmp2 = new V
       assert(tmp1!=NULL);
 
       // copy data(U) to tmp1
@@ -250,7 +250,8 @@ void mblock<scomp>::addtrll(unsigned k, scomp* U, unsigned ldU, scomp* V,
         for (unsigned j=0; j<nmin; ++j)
           if (abs(R[i+j*mmin])<thresh) R[i+j*mmin] = 0.0;
 
-      float* const S = new float[amin];
+      mblockWork<float> wspS(amin);
+      float* const S = wspS.ptr();
       scomp* const VT = R + mmin*nmin;    // amin*nmin
 
       // SVD von R1*R2^H
@@ -287,12 +288,14 @@ void mblock<scomp>::addtrll(unsigned k, scomp* U, unsigned ldU, scomp* V,
         assert(INFO==0);
 
       }
-
-      delete [] S;
-      delete [] tmp1;
     } else {
+      scomp* datatemp;
       addLowRankNB(delta, kgoal, n1, k, bl_rank, n2, U, ldU, V, ldV, haarInfo,
-                   X, ldX, Y_, ldY_, bl_rank, data);
+                   X, ldX, Y_, ldY_, data, bl_rank, datatemp);
+      free_(data);
+      data = alloc_(bl_rank*(n1+n2));
+      blas::copy(bl_rank*(n1+n2), datatemp, data);
+      delete [] datatemp;
     }
   }
 }
@@ -314,7 +317,8 @@ void mblock<scomp>::addtrll_rmnd(unsigned k, scomp* U, unsigned ldU, scomp* V,
     unsigned mmin=MIN(n1, ksum), nmin=MIN(n2, ksum), amin=MIN(mmin, nmin);
     unsigned size = ksum*(n1+n2)+LWORK+mmin+(mmin+amin+1)*nmin;
 
-    scomp *tmp1=new scomp[size], *tmp2=tmp1+ksum*n1; // tmp2 = new V
+    mblockWork<scomp> wsp(size);
+    scomp *tmp1=wsp.ptr(), *tmp2=tmp1+ksum*n1; // tmp2 = new V
     assert(tmp1!=NULL);
 
     // copy data(U) to tmp1
@@ -349,7 +353,8 @@ void mblock<scomp>::addtrll_rmnd(unsigned k, scomp* U, unsigned ldU, scomp* V,
     // Berechne R1*R2^H
     blas::utrmmh(mmin, ksum, nmin, tmp1, n1, tmp2, n2, R);
 
-    float* const S = new float[amin];
+    mblockWork<float> wspS(amin);
+    float* const S = wspS.ptr();
     scomp* const VT = R + mmin*nmin;    // amin*nmin
 
     // SVD von R1*R2^H
@@ -410,9 +415,6 @@ void mblock<scomp>::addtrll_rmnd(unsigned k, scomp* U, unsigned ldU, scomp* V,
       assert(INFO==0);
 
     }
-
-    delete [] S;
-    delete [] tmp1;
   }
 }
 
@@ -437,7 +439,8 @@ void mblock<scomp>::addGeM(scomp* A, unsigned ldA, double eps,
     const unsigned min12 = MIN(n1, n2);
     const unsigned mtn = n1*n2;
     const unsigned lwork = 5*(n1+n2);
-    scomp* const tmp = new scomp[mtn+min12*n2+lwork];
+    mblockWork<scomp> wsp(mtn+min12*n2+lwork);
+    scomp* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     for (unsigned j=0; j<n2; ++j)
@@ -450,7 +453,8 @@ void mblock<scomp>::addGeM(scomp* A, unsigned ldA, double eps,
 
     if (haarInfo==NULL) {
       // compute SVD
-      float* const S = new float[min12];
+      mblockWork<float> wspS(min12);
+      float* const S = wspS.ptr();
       scomp* const VT = tmp + mtn;           // min12*n2
       scomp* const work = VT + min12*n2;     // lwork
       int INFO = blas::gesvd(n1, n2, tmp, S, VT, min12, lwork, work);
@@ -469,12 +473,10 @@ void mblock<scomp>::addGeM(scomp* A, unsigned ldA, double eps,
           for (unsigned j=0; j<n2; ++j) data[kt*n1+l*n2+j] = conj(VT[l+j*min12]);
         }
       }
-
-      delete [] S;
-      delete [] tmp;
     } else {
       // compute SVD
-      float* const S = new float[min12];
+      mblockWork<float> wspS(min12);
+      float* const S = wspS.ptr();
       scomp* const VT = tmp+mtn;           	 // min12*n2
       scomp* const work = VT + min12*n2;     // lwork
       int INFO = blas::gesvd(n1, n2, tmp, S, VT, min12, lwork, work);
@@ -490,7 +492,6 @@ void mblock<scomp>::addGeM(scomp* A, unsigned ldA, double eps,
                                     X, ldX, Y_, ldY_, khat, data);
 
       bl_rank = khat;
-      delete [] tmp;
       delete [] V;
     }
   }
@@ -518,7 +519,8 @@ void mblock<scomp>::unify_cols_LrMLrM(double delta, unsigned kgoal,
     const unsigned n2a = mbl1.n2, n2b = mbl2.n2, kU = MIN(n1, ksum);
     const unsigned size=kU*ksum, LWORK=10*ksum;
     const unsigned sizeU1=k1*n1, sizeU2=k2*n1, sizeV1=k1*n2a, sizeV2=k2*n2b;
-    scomp* const tmp=new scomp[(n1+1)*ksum+2*size+kU+LWORK+sizeV1+sizeV2];
+    mblockWork<scomp> wsp((n1+1)*ksum+2*size+kU+LWORK+sizeV1+sizeV2);
+    scomp* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     scomp* const R1 = tmp;                                    // n1*k1
@@ -527,7 +529,8 @@ void mblock<scomp>::unify_cols_LrMLrM(double delta, unsigned kgoal,
     scomp* const tau1 = tau + kU;                             // k1
     scomp* const tau2 = tau1 + k1;                            // k2
     scomp* const M = tau2 + k2;                               // size
-    float* const S = new float[kU];
+    mblockWork<float> wspS(kU);
+    float* const S = wspS.ptr();
     scomp* const VT = M + size;                               // size
     scomp* const WORK = VT + size;                            // LWORK
     scomp* const V1 = WORK + LWORK;                           // sizeV1
@@ -571,7 +574,7 @@ void mblock<scomp>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new scomp[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         INFO = blas::orgqr(n1, kU, tmp, tau, LWORK, WORK);
@@ -615,7 +618,7 @@ void mblock<scomp>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       createLowRankMatHouseholderNB(delta, kgoal, kU, kU, ksum, M, V, haarInfo,
                                     Xnew, ksum, Y_new, kU, bl_rank, datatemp);
 
-      data = new scomp[bl_rank*(n1+n2)];
+      data = alloc_(bl_rank*(n1+n2));
       assert(data!=NULL);
       blas::gemm(n1, kU, bl_rank, C_ONE, tmp, n1, datatemp, kU, data, n1);
 
@@ -630,9 +633,6 @@ void mblock<scomp>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       delete [] Xnew;
       delete [] Y_new;
     }
-
-    delete [] S;
-    delete [] tmp;
   }
 }
 
@@ -654,7 +654,8 @@ void mblock<scomp>::unify_cols(double delta, unsigned kgoal,
     freedata();
 
     unsigned n2a=mbl1.n2, n2b=mbl2.n2, nmin=MIN(n1, n2), LWORK=5*(n1+n2);
-    scomp *tmp = new scomp[(n1+nmin)*n2+LWORK];
+    mblockWork<scomp> wsp((n1+nmin)*n2+LWORK);
+    scomp *tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     // convert (A,B) to dense matrix tmp
@@ -672,7 +673,8 @@ void mblock<scomp>::unify_cols(double delta, unsigned kgoal,
 
     // SVD von tmp
 
-    float* S = new float[nmin];
+    mblockWork<float> wspS(nmin);
+    float* S = wspS.ptr();
     scomp *VT = tmp+n1*n2, *WORK = VT+nmin*n2;
     int INFO = blas::gesvd(n1, n2, tmp, S, VT, nmin, LWORK, WORK);
     assert(INFO==0);
@@ -684,7 +686,7 @@ void mblock<scomp>::unify_cols(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new scomp[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         blas::copy(n1*kt, tmp, data);
@@ -704,8 +706,6 @@ void mblock<scomp>::unify_cols(double delta, unsigned kgoal,
                                     X, ldX, Y_, ldY_, bl_rank, data);
       delete [] V;
     }
-    delete [] S;
-    delete [] tmp;
   }
 }
 
@@ -727,7 +727,8 @@ void mblock<scomp>::unify_rows_LrMLrM(double delta, unsigned kgoal,
     const unsigned n1a = mbl1.n1, n1b = mbl2.n1, kV = MIN(n2, ksum);
     const unsigned size=kV*ksum, LWORK=10*ksum;
     const unsigned sizeU1=k1*n1a, sizeU2=k2*n1b, sizeV1=k1*n2, sizeV2=k2*n2;
-    scomp* const tmp=new scomp[(n2+1)*ksum+2*(size+kV)+LWORK+sizeU1+sizeU2];
+    mblockWork<scomp> wsp((n2+1)*ksum+2*(size+kV)+LWORK+sizeU1+sizeU2);
+    scomp* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     scomp* const R1 = tmp;                                    // n2*k1
@@ -785,7 +786,8 @@ void mblock<scomp>::unify_rows_LrMLrM(double delta, unsigned kgoal,
     }
 
     // SVD von M
-    float* const S = new float[kV];
+    mblockWork<float> wspS(kV);
+    float* const S = wspS.ptr();
     INFO = blas::gesvd(ksum, kV, M, S, VT, kV, LWORK, WORK);
     assert(INFO==0);
 
@@ -797,7 +799,7 @@ void mblock<scomp>::unify_rows_LrMLrM(double delta, unsigned kgoal,
 
       if (kt>0) {
         for (unsigned l=0; l<kt; ++l) blas::scal(ksum, S[l], M+l*ksum);
-        data = new scomp[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         INFO = blas::orgqr(n1a, k1, U1, tau1, LWORK, WORK);
@@ -837,7 +839,7 @@ void mblock<scomp>::unify_rows_LrMLrM(double delta, unsigned kgoal,
       createLowRankMatHouseholderNB(delta, kgoal, ksum, kV, kV, M, V, haarInfo,
                                     Xnew, kV, Y_new, ksum, bl_rank, datatemp);
 
-      data = new scomp[bl_rank*(n1+n2)];
+      data = alloc_(bl_rank*(n1+n2));
       assert(data!=NULL);
       blas::gemm(n1a, k1, bl_rank, C_ONE, U1, n1a, datatemp, ksum, data, n1);
 
@@ -852,9 +854,6 @@ void mblock<scomp>::unify_rows_LrMLrM(double delta, unsigned kgoal,
       delete [] Xnew;
       delete [] Y_new;
     }
-
-    delete [] S;
-    delete [] tmp;
   }
 }
 
@@ -875,7 +874,8 @@ void mblock<scomp>::unify_rows(double delta, unsigned kgoal,
     unify_rows_LrMLrM(delta, kgoal, mbl1, mbl2, haarInfo, X, ldX, Y_, ldY_);
   else {
     unsigned n1a=mbl1.n1, n1b=mbl2.n1, nmin=MIN(n1, n2), LWORK=5*(n1+n2);
-    scomp *tmp = new scomp[n1*n2+nmin*(1+n2)+LWORK];
+    mblockWork<scomp> wsp(n1*n2+nmin*(1+n2)+LWORK);
+    scomp *tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     // convert (A \\ B) to dense matrix tmp
@@ -896,7 +896,8 @@ void mblock<scomp>::unify_rows(double delta, unsigned kgoal,
 
     // SVD von tmp
     scomp *VT = tmp+n1*n2, *WORK = VT+nmin*n2;
-    float* S = new float[nmin];
+    mblockWork<float> wspS(nmin);
+    float* S = wspS.ptr();
     int INFO = blas::gesvd(n1, n2, tmp, S, VT, nmin, LWORK, WORK);
     assert(INFO==0);
 
@@ -907,7 +908,7 @@ void mblock<scomp>::unify_rows(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new scomp[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         blas::copy(n1*kt, tmp, data);
@@ -927,9 +928,6 @@ void mblock<scomp>::unify_rows(double delta, unsigned kgoal,
 				    haarInfo, X, ldX, Y_, ldY_, bl_rank, data);
       delete [] V;
     }
-
-    delete [] S;
-    delete [] tmp;
   }
 }
 
@@ -1034,7 +1032,7 @@ void mblock<scomp>::mltaUtMhVec(scomp d, scomp* x, scomp* y) const
   scomp *p = data;
   for (unsigned i=0; i<n1; ++i) {
     scomp e = C_ZERO;
-    for (unsigned j=0; j<=i; ++j) e += x[j] * *p++;
+    for (unsigned j=0; j<=i; ++j) e += x[j] * conj(*p++);
     y[i] += d * e;
   }
 }
@@ -1141,6 +1139,10 @@ void mblock<scomp>::addLrM(unsigned k, scomp* U, unsigned ldU, scomp* V,
 			   scomp* Y_, unsigned ldY_)
 {
   if (isLrM()) { // cannot be symmetric since it is lwr
+    if (acc!=NULL && haarInfo==NULL) {  // truncated later
+      addAcc_(k, U, ldU, V, ldV, eps, kgoal);
+      return;
+    }
     addtrll(k, U, ldU, V, ldV, eps, kgoal, haarInfo, X, ldX, Y_, ldY_);
     if (bl_rank*(n1+n2)>n1*n2) convLrM_toGeM();
   } else {
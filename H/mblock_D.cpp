@@ -12,6 +12,7 @@
 #include <cmath>
 #include "mblock.h"
 #include "basmod.h"
+#include "workspace.h"
 
 #define EPS0 1e-64
 
@@ -25,7 +26,8 @@ void mblock<double>::trunc_abs(double eps)
     unsigned LWORK = 10*k;
     unsigned size = k*(n1+n2)+LWORK+(2*k+3)*k;
 
-    double *tmp1=new double[size], *tmp2=tmp1+k*n1; // tmp2 = new V
+    mblockWork<double> wsp(size);
+    double *tmp1=wsp.ptr(), *tmp2=tmp1+k*n1; // tmp2 = new V
     assert(tmp1!=NULL);
 
     // copy data to tmp1
@@ -92,8 +94,6 @@ void mblock<double>::trunc_abs(double eps)
       INFO = blas::ormqr(n2, kt, k, tmp2, tau2, dataV, LWORK, WORK);
       assert(INFO==0);
     }
-
-    delete [] tmp1;
   }
 }
 
@@ -107,7 +107,8 @@ void mblock<double>::trunc_rank(unsigned rank_new)
     unsigned LWORK = 10*k;
     unsigned size = k*(n1+n2)+LWORK+(2*k+3)*k;
 
-    double *tmp1=new double[size], *tmp2=tmp1+k*n1; // tmp2 = new V
+    mblockWork<double> wsp(size);
+    double *tmp1=wsp.ptr(), *tmp2=tmp1+k*n1; // tmp2 = new V
     assert(tmp1!=NULL);
 
     // copy data to tmp1
@@ -173,8 +174,6 @@ void mblock<double>::trunc_rank(unsigned rank_new)
       INFO = blas::ormqr(n2, kt, k, tmp2, tau2, dataV, LWORK, WORK);
       assert(INFO==0);
     }
-
-    delete [] tmp1;
   }
 }
 
@@ -198,7 +197,8 @@ void mblock<double>::get_svals_LrM(double* sigma) const
   const unsigned LWORK = 10*k;
   const unsigned size = k*(n1+n2+k+2)+LWORK;
 
-  double* const tmp1 = new double[size];
+  mblockWork<double> wsp(size);
+  double* const tmp1 = wsp.ptr();
   assert(tmp1!=NULL);
 
   // copy data to tmp1
@@ -225,8 +225,6 @@ void mblock<double>::get_svals_LrM(double* sigma) const
   // SVD von R1*R2^T
   INFO = blas::svals(k, k, R, sigma, LWORK, WORK);
   assert(INFO==0);
-
-  delete [] tmp1;
 }
 
 
@@ -248,13 +246,13 @@ void mblock<double>::convLrM_toGeM()
   assert(isLrM());
 
   if (bl_rank>0) {
-    double* const new_data = new double[n1*n2];
+    double* const new_data = alloc_(n1*n2);
     assert(new_data!=NULL);
 
     blas::gemmh(n1, bl_rank, n2, D_ONE, data, n1, data+bl_rank*n1, n2,
                 new_data, n1);
 
-    delete [] data;
+    free_(data);
     data = new_data;
     info.is_LrM = info.is_UtM = info.is_LtM = info.is_HeM = info.is_SyM = 0;
   } else init0_GeM(n1, n2);
@@ -281,7 +279,8 @@ void mblock<double>::convGeM_toLrM(double eps)
 
   unsigned nmin = MIN(n1, n2), LWORK = n1+n2+5*nmin;
   int INFO;
-  double *tmp = new double[n1*n2+nmin*(n2+1)+LWORK];
+  mblockWork<double> wsp(n1*n2+nmin*(n2+1)+LWORK);
+  double *tmp = wsp.ptr();
   double *S = tmp + n1*n2, *VT = S + nmin, *WORK = VT + nmin*n2;
 
   blas::copy(n1*n2, data, tmp);
@@ -298,8 +297,6 @@ void mblock<double>::convGeM_toLrM(double eps)
   for (unsigned l=0; l<kt; ++l)
     for (unsigned j=0; j<n2; ++j)
       data[j+n2*l+kt*n1] = S[l] * VT[nmin*j+l];
-
-  delete [] tmp;
 }
 
 
@@ -340,14 +337,14 @@ void mblock<double>::append(unsigned k, double* U, unsigned ldU, double* V,
   assert(isLrM());
 
   unsigned rank_new = bl_rank+k;
-  double *tmp=new double[rank_new*(n1+n2)];
+  double *tmp=alloc_(rank_new*(n1+n2));
   blas::copy(bl_rank*n1, data, tmp);
   for (unsigned i=0; i<k; i++)
     blas::copy(n1, U+i*ldU, tmp+bl_rank*n1+i*n1);
   blas::copy(bl_rank*n2, data+bl_rank*n1, tmp+rank_new*n1);
   for (unsigned i=0; i<k; i++)
     blas::copy(n2, V+i*ldV, tmp+rank_new*n1+bl_rank*n2+i*n2);
-  delete [] data;
+  free_(data);
   data = tmp;
   bl_rank = rank_new;
 }
@@ -367,7 +364,8 @@ void mblock<double>::addtrll(unsigned k, double* U, unsigned ldU, double* V,
       unsigned mmin = MIN(n1, ksum), nmin = MIN(n2, ksum), amin = MIN(mmin, nmin);
       unsigned size = ksum*(n1+n2)+LWORK+mmin+(mmin+amin+1)*nmin+amin;
 
-      double *tmp1=new double[size], *tmp2=tmp1+ksum*n1; // tmp2 = new V
+      mblockWork<double> wsp(size);
+      double *tmp1=wsp.ptr(), *tmp2=tmp1+ksum*n1; // tmp2 = new V
       assert(tmp1!=NULL);
 
       // copy data(U) to tmp1
@@ -444,8 +442,6 @@ void mblock<double>::addtrll(unsigned k, double* U, unsigned ldU, double* V,
         INFO = blas::ormqr(n2, kt, nmin, tmp2, tau2, dataV, LWORK, WORK);
         assert(INFO==0);
       }
-
-      delete [] tmp1;
     } else {
       //std::cout<<"bl_rank: "<<bl_rank<<std::endl;
       /*std::cout<<"U: "<<std::endl;
@@ -457,8 +453,13 @@ void mblock<double>::addtrll(unsigned k, double* U, unsigned ldU, double* V,
 	std::cout<<"\ndata: "<<std::endl;
 	for(unsigned i=0;i<(n1+n2)*bl_rank;i++)
       	std::cout<<data[i]<<" ";*/
+      double* datatemp;
       addLowRankNB(delta, kgoal, n1, k, bl_rank, n2, U, ldU, V, ldV, haarInfo,
-                   X, ldX, Y_, ldY_, bl_rank, data);
+                   X, ldX, Y_, ldY_, data, bl_rank, datatemp);
+      free_(data);
+      data = alloc_(bl_rank*(n1+n2));
+      blas::copy(bl_rank*(n1+n2), datatemp, data);
+      delete [] datatemp;
       //std::cout<<"Rang: "<<bl_rank;
     }
   }
@@ -482,7 +483,8 @@ void mblock<double>::addtrll_rmnd(unsigned k, double* U, unsigned ldU,
     unsigned mmin=MIN(n1, ksum), nmin=MIN(n2, ksum), amin=MIN(mmin, nmin);
     unsigned size = ksum*(n1+n2)+LWORK+mmin+(mmin+amin+1)*nmin+amin;
 
-    double *tmp1=new double[size], *tmp2=tmp1+ksum*n1; // tmp2 = new V
+    mblockWork<double> wsp(size);
+    double *tmp1=wsp.ptr(), *tmp2=tmp1+ksum*n1; // tmp2 = new V
     assert(tmp1!=NULL);
 
     // copy data(U) to tmp1
@@ -578,8 +580,6 @@ void mblock<double>::addtrll_rmnd(unsigned k, double* U, unsigned ldU,
       assert(INFO==0);
 
     }
-
-    delete [] tmp1;
   }
 }
 
@@ -604,7 +604,8 @@ void mblock<double>::addGeM(double* A, unsigned ldA, double eps,
     const unsigned min12 = MIN(n1, n2);
     const unsigned mtn = n1*n2;
     const unsigned lwork = 5*(n1+n2);
-    double* const tmp = new double[mtn+min12*(n2+1)+lwork];
+    mblockWork<double> wsp(mtn+min12*(n2+1)+lwork);
+    double* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     for (unsigned j=0; j<n2; ++j)
@@ -650,7 +651,6 @@ void mblock<double>::addGeM(double* A, unsigned ldA, double eps,
       bl_rank = khat;
       delete [] V;
     }
-    delete [] tmp;
   } else { // is dense
     if (isHeM() || isSyM()) addGeM_toHeM(A, ldA);
     else addGeM_toGeM(A, ldA);
@@ -673,7 +673,8 @@ void mblock<double>::unify_cols_LrMLrM(double delta, unsigned kgoal,
     const unsigned n2a = mbl1.n2, n2b = mbl2.n2, kU = MIN(n1, ksum);
     const unsigned size=kU*ksum, LWORK=10*ksum;
     const unsigned sizeU1=k1*n1, sizeU2=k2*n1, sizeV1=k1*n2a, sizeV2=k2*n2b;
-    double* const tmp=new double[(n1+1)*ksum+2*(size+kU)+LWORK+sizeV1+sizeV2];
+    mblockWork<double> wsp((n1+1)*ksum+2*(size+kU)+LWORK+sizeV1+sizeV2);
+    double* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     double* const R1 = tmp;                                    // n1*k1
@@ -725,7 +726,7 @@ void mblock<double>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new double[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         INFO = blas::orgqr(n1, kU, tmp, tau, LWORK, WORK);
@@ -767,7 +768,7 @@ void mblock<double>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       createLowRankMatHouseholderNB(delta, kgoal, kU, kU, ksum, M, V, haarInfo,
                                     Xnew, ksum, Y_new, kU, bl_rank, datatemp);
 
-      data = new double[bl_rank*(n1+n2)];
+      data = alloc_(bl_rank*(n1+n2));
       assert(data!=NULL);
       blas::gemm(n1, kU, bl_rank, D_ONE, tmp, n1, datatemp, kU, data, n1);
 
@@ -782,8 +783,6 @@ void mblock<double>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       delete [] Xnew;
       delete [] Y_new;
     }
-
-    delete [] tmp;
   }
 }
 
@@ -803,7 +802,8 @@ void mblock<double>::unify_cols(double delta, unsigned kgoal,
     unify_cols_LrMLrM(delta, kgoal, mbl1, mbl2, haarInfo, X, ldX, Y_, ldY_);
   else {
     unsigned n2a=mbl1.n2, n2b=mbl2.n2, nmin=MIN(n1, n2), LWORK=5*(n1+n2);
-    double *tmp = new double[n1*n2+nmin*(1+n2)+LWORK];
+    mblockWork<double> wsp(n1*n2+nmin*(1+n2)+LWORK);
+    double *tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     // convert (A,B) to dense matrix tmp
@@ -832,7 +832,7 @@ void mblock<double>::unify_cols(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new double[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         blas::copy(n1*kt, tmp, data);
@@ -854,7 +854,6 @@ void mblock<double>::unify_cols(double delta, unsigned kgoal,
                                     X, ldX, Y_, ldY_, bl_rank, data);
       delete [] V;
     }
-    delete [] tmp;
   }
 }
 
@@ -875,7 +874,8 @@ void mblock<double>::unify_rows_LrMLrM(double delta, unsigned kgoal,
     const unsigned n1a = mbl1.n1, n1b = mbl2.n1, kV = MIN(n2, ksum);
     const unsigned size=kV*ksum, LWORK=10*ksum;
     const unsigned sizeU1=k1*n1a, sizeU2=k2*n1b, sizeV1=k1*n2, sizeV2=k2*n2;
-    double* const tmp=new double[(n2+1)*ksum+2*(size+kV)+LWORK+sizeU1+sizeU2];
+    mblockWork<double> wsp((n2+1)*ksum+2*(size+kV)+LWORK+sizeU1+sizeU2);
+    double* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     double* const R1 = tmp;                                    // n2*k1
@@ -941,7 +941,7 @@ void mblock<double>::unify_rows_LrMLrM(double delta, unsigned kgoal,
       bl_rank = kt;
       if (kt>0) {
         for (unsigned l=0; l<kt; ++l) blas::scal(ksum, S[l], M+l*ksum);
-        data = new double[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         INFO = blas::orgqr(n1a, k1, U1, tau1, LWORK, WORK);
@@ -981,7 +981,7 @@ void mblock<double>::unify_rows_LrMLrM(double delta, unsigned kgoal,
       createLowRankMatHouseholderNB(delta, kgoal, ksum, kV, kV, M, V, haarInfo,
                                     Xnew, kV, Y_new, ksum, bl_rank, datatemp);
 
-      data = new double[bl_rank*(n1+n2)];
+      data = alloc_(bl_rank*(n1+n2));
       assert(data!=NULL);
       blas::gemm(n1a, k1, bl_rank, D_ONE, U1, n1a, datatemp, ksum, data, n1);
 
@@ -996,8 +996,6 @@ void mblock<double>::unify_rows_LrMLrM(double delta, unsigned kgoal,
       delete [] Xnew;
       delete [] Y_new;
     }
-
-    delete [] tmp;
   }
 }
 
@@ -1018,7 +1016,8 @@ void mblock<double>::unify_rows(double delta, unsigned kgoal,
     unify_rows_LrMLrM(delta, kgoal, mbl1, mbl2, haarInfo, X, ldX, Y_, ldY_);
   else {
     unsigned n1a=mbl1.n1, n1b=mbl2.n1, nmin=MIN(n1, n2), LWORK=5*(n1+n2);
-    double *tmp = new double[n1*n2+nmin*(1+n2)+LWORK];
+    mblockWork<double> wsp(n1*n2+nmin*(1+n2)+LWORK);
+    double *tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     // convert (A \\ B) to dense matrix tmp
@@ -1049,7 +1048,7 @@ void mblock<double>::unify_rows(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new double[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         blas::copy(n1*kt, tmp, data);
@@ -1069,7 +1068,6 @@ void mblock<double>::unify_rows(double delta, unsigned kgoal,
                                     X, ldX, Y_, ldY_, bl_rank, data);
       delete [] V;
     }
-    delete [] tmp;
   }
 }
 
@@ -1278,6 +1276,10 @@ void mblock<double>::addLrM(unsigned k, double* U, unsigned ldU, double* V,
 			    double* Y_, unsigned ldY_)
 {
   if (isLrM()) { // cannot be symmetric since it is lwr
+    if (acc!=NULL && haarInfo==NULL) {  // truncated later
+      addAcc_(k, U, ldU, V, ldV, eps, kgoal);
+      return;
+    }
     addtrll(k, U, ldU, V, ldV, eps, kgoal, haarInfo, X, ldX, Y_, ldY_);
     if (bl_rank*(n1+n2)>n1*n2) convLrM_toGeM();
   } else {
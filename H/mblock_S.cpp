@@ -12,6 +12,7 @@
 #include <cmath>
 #include "mblock.h"
 #include "basmod.h"
+#include "workspace.h"
 
 #define EPS0 1e-32
 
@@ -24,7 +25,8 @@ void mblock<float>::get_svals_LrM(float* sigma) const
   const unsigned LWORK = 10*k;
   const unsigned size = k*(n1+n2+k+2)+LWORK;
 
-  float* const tmp1 = new float[size];
+  mblockWork<float> wsp(size);
+  float* const tmp1 = wsp.ptr();
   assert(tmp1!=NULL);
 
   // copy data to tmp1
@@ -51,8 +53,6 @@ void mblock<float>::get_svals_LrM(float* sigma) const
   // SVD von R1*R2^T
   INFO = blas::svals(k, k, R, sigma, LWORK, WORK);
   assert(INFO==0);
-
-  delete [] tmp1;
 }
 
 
@@ -73,13 +73,13 @@ void mblock<float>::convLrM_toGeM()
   assert(isLrM());
 
   if (bl_rank>0) {
-    float* const new_data = new float[n1*n2];
+    float* const new_data = alloc_(n1*n2);
     assert(new_data!=NULL);
 
     blas::gemmh(n1, bl_rank, n2, S_ONE, data, n1, data+bl_rank*n1, n2,
                 new_data, n1);
 
-    delete [] data;
+    free_(data);
     data = new_data;
     info.is_LrM = info.is_UtM = info.is_LtM = info.is_HeM = info.is_SyM = 0;
   } else init0_GeM(n1, n2);
@@ -106,7 +106,8 @@ void mblock<float>::convGeM_toLrM(double eps)
 
   unsigned nmin = MIN(n1, n2), LWORK = n1+n2+5*nmin;
   int INFO;
-  float *tmp = new float[n1*n2+nmin*(n2+1)+LWORK];
+  mblockWork<float> wsp(n1*n2+nmin*(n2+1)+LWORK);
+  float *tmp = wsp.ptr();
   float *S = tmp + n1*n2, *VT = S + nmin, *WORK = VT + nmin*n2;
 
   blas::copy(n1*n2, data, tmp);
@@ -123,8 +124,6 @@ void mblock<float>::convGeM_toLrM(double eps)
   for (unsigned l=0; l<kt; ++l)
     for (unsigned j=0; j<n2; ++j)
       data[j+n2*l+kt*n1] = S[l] * VT[nmin*j+l];
-
-  delete [] tmp;
 }
 
 
@@ -165,14 +164,14 @@ void mblock<float>::append(unsigned k, float* U, unsigned ldU, float* V,
   assert(isLrM());
 
   unsigned rank_new = bl_rank+k;
-  float *tmp=new float[rank_new*(n1+n2)];
+  float *tmp=alloc_(rank_new*(n1+n2));
   blas::copy(bl_rank*n1, data, tmp);
   for (unsigned i=0; i<k; i++)
     blas::copy(n1, U+i*ldU, tmp+bl_rank*n1+i*n1);
   blas::copy(bl_rank*n2, data+bl_rank*n1, tmp+rank_new*n1);
   for (unsigned i=0; i<k; i++)
     blas::copy(n2, V+i*ldV, tmp+rank_new*n1+bl_rank*n2+i*n2);
-  delete [] data;
+  free_(data);
   data = tmp;
   bl_rank = rank_new;
 }
@@ -192,7 +191,8 @@ void mblock<float>::addtrll(unsigned k, float* U, unsigned ldU,
       unsigned mmin=MIN(n1, ksum), nmin=MIN(n2, ksum), amin=MIN(mmin, nmin);
       unsigned size = ksum*(n1+n2)+LWORK+mmin+(mmin+amin+1)*nmin+amin;
 
-      float *tmp1=new float[size], *tmp2=tmp1+ksum*n1; // tmp2 = new V
+      mblockWork<float> wsp(size);
+      float *tmp1=wsp.ptr(), *tmp2=tmp1+ksum*n1; // tmp2 = new V
       assert(tmp1!=NULL);
 
       // copy data(U) to tmp1
@@ -269,11 +269,14 @@ void mblock<float>::addtrll(unsigned k, float* U, unsigned ldU,
         INFO = blas::ormqr(n2, kt, nmin, tmp2, tau2, dataV, LWORK, WORK);
         assert(INFO==0);
       }
-
-      delete [] tmp1;
     } else {
+      float* datatemp;
       addLowRankNB(delta, kgoal, n1, k, bl_rank, n2, U, ldU, V, ldV, haarInfo,
-                   X, ldX, Y_, ldY_, bl_rank, data);
+                   X, ldX, Y_, ldY_, data, bl_rank, datatemp);
+      free_(data);
+      data = alloc_(bl_rank*(n1+n2));
+      blas::copy(bl_rank*(n1+n2), datatemp, data);
+      delete [] datatemp;
     }
   }
 }
@@ -296,7 +299,8 @@ void mblock<float>::addtrll_rmnd(unsigned k, float* U, unsigned ldU, float* V,
     unsigned mmin=MIN(n1, ksum), nmin=MIN(n2, ksum), amin=MIN(mmin, nmin);
     unsigned size = ksum*(n1+n2)+LWORK+mmin+(mmin+amin+1)*nmin+amin;
 
-    float *tmp1=new float[size], *tmp2=tmp1+ksum*n1; // tmp2 = new V
+    mblockWork<float> wsp(size);
+    float *tmp1=wsp.ptr(), *tmp2=tmp1+ksum*n1; // tmp2 = new V
     assert(tmp1!=NULL);
 
     // copy data(U) to tmp1
@@ -392,8 +396,6 @@ void mblock<float>::addtrll_rmnd(unsigned k, float* U, unsigned ldU, float* V,
       assert(INFO==0);
 
     }
-
-    delete [] tmp1;
   }
 }
 
@@ -419,7 +421,8 @@ void mblock<float>::addGeM(float* A, unsigned ldA, double eps,
     const unsigned min12 = MIN(n1, n2);
     const unsigned mtn = n1*n2;
     const unsigned lwork = 5*(n1+n2);
-    float* const tmp = new float[mtn+min12*(n2+1)+lwork];
+    mblockWork<float> wsp(mtn+min12*(n2+1)+lwork);
+    float* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     for (unsigned j=0; j<n2; ++j)
@@ -465,7 +468,6 @@ void mblock<float>::addGeM(float* A, unsigned ldA, double eps,
       bl_rank = khat;
       delete [] V;
     }
-    delete [] tmp;
   }
   else { // is dense
     if (isHeM() || isSyM()) addGeM_toHeM(A, ldA);
@@ -490,7 +492,8 @@ void mblock<float>::unify_cols_LrMLrM(double delta, unsigned kgoal,
     const unsigned n2a = mbl1.n2, n2b = mbl2.n2, kU = MIN(n1, ksum);
     const unsigned size=kU*ksum, LWORK=10*ksum;
     const unsigned sizeU1=k1*n1, sizeU2=k2*n1, sizeV1=k1*n2a, sizeV2=k2*n2b;
-    float* const tmp=new float[(n1+1)*ksum+2*(size+kU)+LWORK+sizeV1+sizeV2];
+    mblockWork<float> wsp((n1+1)*ksum+2*(size+kU)+LWORK+sizeV1+sizeV2);
+    float* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     float* const R1 = tmp;                                    // n1*k1
@@ -542,7 +545,7 @@ void mblock<float>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new float[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         INFO = blas::orgqr(n1, kU, tmp, tau, LWORK, WORK);
@@ -584,7 +587,7 @@ void mblock<float>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       createLowRankMatHouseholderNB(delta, kgoal, kU, kU, ksum, M, V, haarInfo,
                                     Xnew, ksum, Y_new, kU, bl_rank, datatemp);
 
-      data = new float[bl_rank*(n1+n2)];
+      data = alloc_(bl_rank*(n1+n2));
       assert(data!=NULL);
       blas::gemm(n1, kU, bl_rank, S_ONE, tmp, n1, datatemp, kU, data, n1);
 
@@ -599,8 +602,6 @@ void mblock<float>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       delete [] Xnew;
       delete [] Y_new;
     }
-
-    delete [] tmp;
   }
 }
 
@@ -621,7 +622,8 @@ void mblock<float>::unify_cols(double delta, unsigned kgoal,
     unify_cols_LrMLrM(delta, kgoal, mbl1, mbl2, haarInfo, X, ldX, Y_, ldY_);
   else {
     unsigned n2a=mbl1.n2, n2b=mbl2.n2, nmin=MIN(n1, n2), LWORK=5*(n1+n2);
-    float *tmp = new float[n1*n2+nmin*(1+n2)+LWORK];
+    mblockWork<float> wsp(n1*n2+nmin*(1+n2)+LWORK);
+    float *tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     // convert (A,B) to dense matrix tmp
@@ -650,7 +652,7 @@ void mblock<float>::unify_cols(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new float[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         blas::copy(n1*kt, tmp, data);
@@ -670,7 +672,6 @@ void mblock<float>::unify_cols(double delta, unsigned kgoal,
                                     X, ldX, Y_, ldY_, bl_rank, data);
       delete [] V;
     }
-    delete [] tmp;
   }
 }
 
@@ -691,7 +692,8 @@ void mblock<float>::unify_rows_LrMLrM(double delta, unsigned kgoal,
     const unsigned n1a = mbl1.n1, n1b = mbl2.n1, kV = MIN(n2, ksum);
     const unsigned size=kV*ksum, LWORK=10*ksum;
     const unsigned sizeU1=k1*n1a, sizeU2=k2*n1b, sizeV1=k1*n2, sizeV2=k2*n2;
-    float* const tmp=new float[(n2+1)*ksum+2*(size+kV)+LWORK+sizeU1+sizeU2];
+    mblockWork<float> wsp((n2+1)*ksum+2*(size+kV)+LWORK+sizeU1+sizeU2);
+    float* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     float* const R1 = tmp;                                    // n2*k1
@@ -758,7 +760,7 @@ void mblock<float>::unify_rows_LrMLrM(double delta, unsigned kgoal,
 
       if (kt>0) {
         for (unsigned l=0; l<kt; ++l) blas::scal(ksum, S[l], M+l*ksum);
-        data = new float[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         INFO = blas::orgqr(n1a, k1, U1, tau1, LWORK, WORK);
@@ -798,7 +800,7 @@ void mblock<float>::unify_rows_LrMLrM(double delta, unsigned kgoal,
       createLowRankMatHouseholderNB(delta, kgoal, ksum, kV, kV, M, V, haarInfo,
                                     Xnew, kV, Y_new, ksum, bl_rank, datatemp);
 
-      data = new float[bl_rank*(n1+n2)];
+      data = alloc_(bl_rank*(n1+n2));
       assert(data!=NULL);
       blas::gemm(n1a, k1, bl_rank, S_ONE, U1, n1a, datatemp, ksum, data, n1);
 
@@ -813,7 +815,6 @@ void mblock<float>::unify_rows_LrMLrM(double delta, unsigned kgoal,
       delete [] Xnew;
       delete [] Y_new;
     }
-    delete [] tmp;
   }
 }
 
@@ -834,7 +835,8 @@ void mblock<float>::unify_rows(double delta, unsigned kgoal,
     unify_rows_LrMLrM(delta, kgoal, mbl1, mbl2, haarInfo, X, ldX, Y_, ldY_);
   else {
     unsigned n1a=mbl1.n1, n1b=mbl2.n1, nmin=MIN(n1, n2), LWORK=5*(n1+n2);
-    float *tmp = new float[n1*n2+nmin*(1+n2)+LWORK];
+    mblockWork<float> wsp(n1*n2+nmin*(1+n2)+LWORK);
+    float *tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     // convert (A \\ B) to dense matrix tmp
@@ -865,7 +867,7 @@ void mblock<float>::unify_rows(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new float[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         blas::copy(n1*kt, tmp, data);
@@ -885,8 +887,6 @@ void mblock<float>::unify_rows(double delta, unsigned kgoal,
                                     X, ldX, Y_, ldY_, bl_rank, data);
       delete [] V;
     }
-
-    delete [] tmp;
   }
 }
 
@@ -1095,6 +1095,10 @@ void mblock<float>::addLrM(unsigned k, float* U, unsigned ldU, float* V,
 			   float* Y_, unsigned ldY_)
 {
   if (isLrM()) { // cannot be symmetric since it is lwr
+    if (acc!=NULL && haarInfo==NULL) {  // truncated later
+      addAcc_(k, U, ldU, V, ldV, eps, kgoal);
+      return;
+    }
     addtrll(k, U, ldU, V, ldV, eps, kgoal, haarInfo, X, ldX, Y_, ldY_);
     if (bl_rank*(n1+n2)>n1*n2) convLrM_toGeM();
   } else {
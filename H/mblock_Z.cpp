@@ -12,6 +12,7 @@
 #include <cmath>
 #include "mblock.h"
 #include "basmod.h"
+#include "workspace.h"
 
 #define EPS0 1e-64
 
@@ -25,7 +26,8 @@ void mblock<dcomp>::get_svals_LrM(double* sigma) const
   const unsigned LWORK = 10*k;
   const unsigned size = k*(n1+n2+k+2)+LWORK;
 
-  dcomp* const tmp1 = new dcomp[size];
+  mblockWork<dcomp> wsp(size);
+  dcomp* const tmp1 = wsp.ptr();
   assert(tmp1!=NULL);
 
   // copy data to tmp1
@@ -52,8 +54,6 @@ void mblock<dcomp>::get_svals_LrM(double* sigma) const
   // SVD von R1*R2^H
   INFO = blas::svals(k, k, R, sigma, LWORK, WORK);
   assert(INFO==0);
-
-  delete [] tmp1;
 }
 
 
@@ -75,13 +75,13 @@ void mblock<dcomp>::convLrM_toGeM()
 {
   assert(isLrM());
   if (bl_rank>0) {
-    dcomp* const new_data = new dcomp[n1*n2];
+    dcomp* const new_data = alloc_(n1*n2);
     assert(new_data!=NULL);
 
     blas::gemmh(n1, bl_rank, n2, Z_ONE, data, n1,
                 data+bl_rank*n1, n2, new_data, n1);
 
-    delete [] data;
+    free_(data);
     data = new_data;
     info.is_LrM = info.is_UtM = info.is_LtM = info.is_HeM = info.is_SyM = 0;
   } else init0_GeM(n1, n2);
@@ -108,9 +108,11 @@ void mblock<dcomp>::convGeM_toLrM(double eps)
 
   unsigned nmin = MIN(n1, n2), LWORK = 5*(n1+n2);
   int INFO;
-  dcomp *tmp = new dcomp[(nmin+n1)*n2+LWORK];
+  mblockWork<dcomp> wsp((nmin+n1)*n2+LWORK);
+  dcomp *tmp = wsp.ptr();
   dcomp *VT =  tmp + n1*n2, *WORK = VT + nmin*n2;
-  double *S = new double[nmin];
+  mblockWork<double> wspS(nmin);
+  double *S = wspS.ptr();
 
   blas::copy(n1*n2, data, tmp);
 
@@ -126,9 +128,6 @@ void mblock<dcomp>::convGeM_toLrM(double eps)
   for (unsigned l=0; l<kt; ++l)
     for (unsigned j=0; j<n2; ++j)
       data[j+n2*l+kt*n1] = S[l] * conj(VT[nmin*j+l]);
-
-  delete [] S;
-  delete [] tmp;
 }
 
 
@@ -182,14 +181,14 @@ void mblock<dcomp>::append(unsigned k, dcomp* U, unsigned ldU, dcomp* V,
   assert(isLrM());
 
   unsigned rank_new = bl_rank+k;
-  dcomp *tmp=new dcomp[rank_new*(n1+n2)];
+  dcomp *tmp=alloc_(rank_new*(n1+n2));
   blas::copy(bl_rank*n1, data, tmp);
   for (unsigned i=0; i<k; i++)
     blas::copy(n1, U+i*ldU, tmp+bl_rank*n1+i*n1);
   blas::copy(bl_rank*n2, data+bl_rank*n1, tmp+rank_new*n1);
   for (unsigned i=0; i<k; i++)
     blas::copy(n2, V+i*ldV, tmp+rank_new*n1+bl_rank*n2+i*n2);
-  delete [] data;
+  free_(data);
   data = tmp;
   bl_rank = rank_new;
 }
@@ -210,7 +209,8 @@ void mblock<dcomp>::addtrll(unsigned k, dcomp* U, unsigned ldU, dcomp* V,
       unsigned mmin=MIN(n1, ksum), nmin=MIN(n2, ksum), amin=MIN(mmin, nmin);
       unsigned size = ksum*(n1+n2)+LWORK+mmin+(mmin+amin+1)*nmin;
 
-      dcomp *tmp1=new dcomp[size], *tmp2=tmp1+ksum*n1; // tmp2 = new V
+      mblockWork<dcomp> wsp(size);
+      dcomp *tmp1=wsp.ptr(), *tmp2=tmp1+ksum*n1; // tmp2 = new V
       assert(tmp1!=NULL);
 
       // copy data(U) to tmp1
@@ -251,7 +251,8 @@ void mblock<dcomp>::addtrll(unsigned k, dcomp* U, unsigned ldU, dcomp* V,
         for (unsigned j=0; j<nmin; ++j)
           if (abs(R[i+j*mmin])<thresh) R[i+j*mmin] = 0.0;
 
-      double* const S = new double[amin];
+      mblockWork<double> wspS(amin);
+      double* const S = wspS.ptr();
       dcomp* const VT = R + mmin*nmin;         // amin*nmin
 
       // SVD von R1*R2^H
@@ -288,12 +289,14 @@ void mblock<dcomp>::addtrll(unsigned k, dcomp* U, unsigned ldU, dcomp* V,
         assert(INFO==0);
 
       }
-
-      delete [] S;
-      delete [] tmp1;
     } else {
+      dcomp* datatemp;
       addLowRankNB(delta, kgoal, n1, k, bl_rank, n2, U, ldU, V, ldV, haarInfo,
-                   X, ldX, Y_, ldY_, bl_rank, data);
+                   X, ldX, Y_, ldY_, data, bl_rank, datatemp);
+      free_(data);
+      data = alloc_(bl_rank*(n1+n2));
+      blas::copy(bl_rank*(n1+n2), datatemp, data);
+      delete [] datatemp;
     }
   }
 }
@@ -316,7 +319,8 @@ void mblock<dcomp>::addtrll_rmnd(unsigned k, dcomp* U, unsigned ldU, dcomp* V,
     unsigned mmin=MIN(n1, ksum), nmin=MIN(n2, ksum), amin=MIN(mmin, nmin);
     unsigned size = ksum*(n1+n2)+LWORK+mmin+(mmin+amin+1)*nmin;
 
-    dcomp *tmp1=new dcomp[size], *tmp2=tmp1+ksum*n1; // tmp2 = new V
+    mblockWork<dcomp> wsp(size);
+    dcomp *tmp1=wsp.ptr(), *tmp2=tmp1+ksum*n1; // tmp2 = new V
     assert(tmp1!=NULL);
 
     // copy data(U) to tmp1
@@ -351,7 +355,8 @@ void mblock<dcomp>::addtrll_rmnd(unsigned k, dcomp* U, unsigned ldU, dcomp* V,
     // Berechne R1*R2^H
     blas::utrmmh(mmin, ksum, nmin, tmp1, n1, tmp2, n2, R);
 
-    double* const S = new double[amin];
+    mblockWork<double> wspS(amin);
+    double* const S = wspS.ptr();
     dcomp* const VT =  R + mmin*nmin;         // amin*nmin
 
     // SVD von R1*R2^H
@@ -412,9 +417,6 @@ void mblock<dcomp>::addtrll_rmnd(unsigned k, dcomp* U, unsigned ldU, dcomp* V,
       assert(INFO==0);
 
     }
-
-    delete [] S;
-    delete [] tmp1;
   }
 }
 
@@ -440,7 +442,8 @@ void mblock<dcomp>::addGeM(dcomp* A, unsigned ldA, double eps,
     const unsigned min12 = MIN(n1, n2);
     const unsigned mtn = n1*n2;
     const unsigned lwork = 5*(n1+n2);
-    dcomp* const tmp = new dcomp[mtn+min12*n2+lwork];
+    mblockWork<dcomp> wsp(mtn+min12*n2+lwork);
+    dcomp* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     for (unsigned j=0; j<n2; ++j)
@@ -453,7 +456,8 @@ void mblock<dcomp>::addGeM(dcomp* A, unsigned ldA, double eps,
 
     if (haarInfo==NULL) {
       // compute SVD
-      double* S = new double[min12];
+      mblockWork<double> wspS(min12);
+      double* S = wspS.ptr();
       dcomp* const VT = tmp + mtn;           // min12*n2
       dcomp* const work = VT + min12*n2;     // lwork
       int INFO = blas::gesvd(n1, n2, tmp, S, VT, min12, lwork, work);
@@ -472,12 +476,10 @@ void mblock<dcomp>::addGeM(dcomp* A, unsigned ldA, double eps,
           for (unsigned j=0; j<n2; ++j) data[kt*n1+l*n2+j] = conj(VT[l+j*min12]);
         }
       }
-
-      delete [] S;
-      delete [] tmp;
     } else {
       // compute SVD
-      double* const S = new double[min12];   // min12
+      mblockWork<double> wspS(min12);
+      double* const S = wspS.ptr();   // min12
       dcomp* const VT = tmp + mtn;           // min12*n2
       dcomp* const work = VT + min12*n2;     // lwork
       int INFO = blas::gesvd(n1, n2, tmp, S, VT, min12, lwork, work);
@@ -493,7 +495,6 @@ void mblock<dcomp>::addGeM(dcomp* A, unsigned ldA, double eps,
                                     X, ldX, Y_, ldY_, khat, data);
 
       bl_rank = khat;
-      delete [] tmp;
       delete [] V;
     }
   }
@@ -521,7 +522,8 @@ void mblock<dcomp>::unify_cols_LrMLrM(double delta, unsigned kgoal,
     const unsigned n2a = mbl1.n2, n2b = mbl2.n2, kU = MIN(n1, ksum);
     const unsigned size=kU*ksum, LWORK=10*ksum;
     const unsigned sizeU1=k1*n1, sizeU2=k2*n1, sizeV1=k1*n2a, sizeV2=k2*n2b;
-    dcomp* const tmp=new dcomp[(n1+1)*ksum+2*size+kU+LWORK+sizeV1+sizeV2];
+    mblockWork<dcomp> wsp((n1+1)*ksum+2*size+kU+LWORK+sizeV1+sizeV2);
+    dcomp* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     dcomp* const R1 = tmp;                                    // n1*k1
@@ -530,7 +532,8 @@ void mblock<dcomp>::unify_cols_LrMLrM(double delta, unsigned kgoal,
     dcomp* const tau1 = tau + kU;                             // k1
     dcomp* const tau2 = tau1 + k1;                            // k2
     dcomp* const M = tau2 + k2;                               // size
-    double* const S = new double[kU];
+    mblockWork<double> wspS(kU);
+    double* const S = wspS.ptr();
     dcomp* const VT = M + size;                               // size
     dcomp* const WORK = VT + size;                            // LWORK
     dcomp* const V1 = WORK + LWORK;                           // sizeV1
@@ -574,7 +577,7 @@ void mblock<dcomp>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new dcomp[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         INFO = blas::orgqr(n1, kU, tmp, tau, LWORK, WORK);
@@ -616,7 +619,7 @@ void mblock<dcomp>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       createLowRankMatHouseholderNB(delta, kgoal, kU, kU, ksum, M, V, haarInfo,
                                     Xnew, ksum, Y_new, kU, bl_rank, datatemp);
 
-      data = new dcomp[bl_rank*(n1+n2)];
+      data = alloc_(bl_rank*(n1+n2));
       assert(data!=NULL);
       blas::gemm(n1, kU, bl_rank, D_ONE, tmp, n1, datatemp, kU, data, n1);
 
@@ -631,9 +634,6 @@ void mblock<dcomp>::unify_cols_LrMLrM(double delta, unsigned kgoal,
       delete [] Xnew;
       delete [] Y_new;
     }
-
-    delete [] S;
-    delete [] tmp;
   }
 }
 
@@ -655,7 +655,8 @@ void mblock<dcomp>::unify_cols(double delta, unsigned kgoal,
     freedata();
 
     unsigned n2a=mbl1.n2, n2b=mbl2.n2, nmin=MIN(n1, n2), LWORK=5*(n1+n2);
-    dcomp *tmp = new dcomp [(n1+nmin)*n2+LWORK];
+    mblockWork<dcomp> wsp((n1+nmin)*n2+LWORK);
+    dcomp *tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     // convert (A,B) to dense matrix tmp
@@ -673,7 +674,8 @@ void mblock<dcomp>::unify_cols(double delta, unsigned kgoal,
 
     // SVD von tmp
 
-    double* S = new double[nmin];
+    mblockWork<double> wspS(nmin);
+    double* S = wspS.ptr();
     dcomp *VT = tmp+n1*n2, *WORK = VT+nmin*n2;
     int INFO = blas::gesvd(n1, n2, tmp, S, VT, nmin, LWORK, WORK);
     assert(INFO==0);
@@ -685,7 +687,7 @@ void mblock<dcomp>::unify_cols(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new dcomp[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         blas::copy(n1*kt, tmp, data);
@@ -705,8 +707,6 @@ void mblock<dcomp>::unify_cols(double delta, unsigned kgoal,
                                     X, ldX, Y_, ldY_, bl_rank, data);
       delete [] V;
     }
-    delete [] tmp;
-    delete [] S;
   }
 }
 
@@ -727,7 +727,8 @@ void mblock<dcomp>::unify_rows_LrMLrM(double delta, unsigned kgoal,
     const unsigned n1a = mbl1.n1, n1b = mbl2.n1, kV = MIN(n2, ksum);
     const unsigned size=kV*ksum, LWORK=10*ksum;
     const unsigned sizeU1=k1*n1a, sizeU2=k2*n1b, sizeV1=k1*n2, sizeV2=k2*n2;
-    dcomp* const tmp=new dcomp[(n2+1)*ksum+2*(size+kV)+LWORK+sizeU1+sizeU2];
+    mblockWork<dcomp> wsp((n2+1)*ksum+2*(size+kV)+LWORK+sizeU1+sizeU2);
+    dcomp* const tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     dcomp* const R1 = tmp;                                    // n2*k1
@@ -785,7 +786,8 @@ void mblock<dcomp>::unify_rows_LrMLrM(double delta, unsigned kgoal,
     }
 
     // SVD von M
-    double* const S = new double[kV];
+    mblockWork<double> wspS(kV);
+    double* const S = wspS.ptr();
     INFO = blas::gesvd(ksum, kV, M, S, VT, kV, LWORK, WORK);
     assert(INFO==0);
 
@@ -797,7 +799,7 @@ void mblock<dcomp>::unify_rows_LrMLrM(double delta, unsigned kgoal,
 
       if (kt>0) {
         for (unsigned l=0; l<kt; ++l) blas::scal(ksum, S[l], M+l*ksum);
-        data = new dcomp[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         INFO = blas::orgqr(n1a, k1, U1, tau1, LWORK, WORK);
@@ -837,7 +839,7 @@ void mblock<dcomp>::unify_rows_LrMLrM(double delta, unsigned kgoal,
       createLowRankMatHouseholderNB(delta, kgoal, ksum, kV, kV, M, V, haarInfo,
                                     Xnew, kV, Y_new, ksum, bl_rank, datatemp);
 
-      data = new dcomp[bl_rank*(n1+n2)];
+      data = alloc_(bl_rank*(n1+n2));
       assert(data!=NULL);
       blas::gemm(n1a, k1, bl_rank, D_ONE, U1, n1a, datatemp, ksum, data, n1);
 
@@ -852,8 +854,6 @@ void mblock<dcomp>::unify_rows_LrMLrM(double delta, unsigned kgoal,
       delete [] Xnew;
       delete [] Y_new;
     }
-    delete [] S;
-    delete [] tmp;
   }
 }
 
@@ -874,7 +874,8 @@ void mblock<dcomp>::unify_rows(double delta, unsigned kgoal,
     unify_rows_LrMLrM(delta, kgoal, mbl1, mbl2, haarInfo, X, ldX, Y_, ldY_);
   else {
     unsigned n1a=mbl1.n1, n1b=mbl2.n1, nmin=MIN(n1, n2), LWORK=5*(n1+n2);
-    dcomp *tmp = new dcomp[n1*n2+nmin*(1+n2)+LWORK];
+    mblockWork<dcomp> wsp(n1*n2+nmin*(1+n2)+LWORK);
+    dcomp *tmp = wsp.ptr();
     assert(tmp!=NULL);
 
     // convert (A \\ B) to dense matrix tmp
@@ -895,7 +896,8 @@ void mblock<dcomp>::unify_rows(double delta, unsigned kgoal,
 
     // SVD von tmp
     dcomp *VT = tmp+n1*n2, *WORK = VT+nmin*n2;
-    double *S = new double[nmin];
+    mblockWork<double> wspS(nmin);
+    double *S = wspS.ptr();
     int INFO = blas::gesvd(n1, n2, tmp, S, VT, nmin, LWORK, WORK);
     assert(INFO==0);
 
@@ -906,7 +908,7 @@ void mblock<dcomp>::unify_rows(double delta, unsigned kgoal,
       bl_rank = kt;
 
       if (kt>0) {
-        data = new dcomp[kt*(n1+n2)];
+        data = alloc_(kt*(n1+n2));
         assert(data!=NULL);
 
         blas::copy(n1*kt, tmp, data);
@@ -926,8 +928,6 @@ void mblock<dcomp>::unify_rows(double delta, unsigned kgoal,
                                     X, ldX, Y_, ldY_, bl_rank, data);
       delete [] V;
     }
-    delete [] S;
-    delete [] tmp;
   }
 }
 
@@ -1032,7 +1032,7 @@ void mblock<dcomp>::mltaUtMhVec(dcomp d, dcomp* x, dcomp* y) const
   dcomp *p = data;
   for (unsigned i=0; i<n1; ++i) {
     dcomp e = Z_ZERO;
-    for (unsigned j=0; j<=i; ++j) e += x[j] * *p++;
+    for (unsigned j=0; j<=i; ++j) e += x[j] * conj(*p++);
     y[i] += d * e;
   }
 }
@@ -1141,6 +1141,10 @@ void mblock<dcomp>::addLrM(unsigned k, dcomp* U, unsigned ldU, dcomp* V,
 			   dcomp* Y_, unsigned ldY_)
 {
   if (isLrM()) { // cannot be symmetric since it is lwr
+    if (acc!=NULL && haarInfo==NULL) {  // truncated later
+      addAcc_(k, U, ldU, V, ldV, eps, kgoal);
+      return;
+    }
     addtrll(k, U, ldU, V, ldV, eps, kgoal, haarInfo, X, ldX, Y_, ldY_);
     if (bl_rank*(n1+n2)>n1*n2) convLrM_toGeM();
   } else {
@@ -11,6 +11,7 @@
 
 #include "blcluster.h"
 #include "H.h"
+#include "HProdAcc.h"
 
 // C += d A B  (A,C H-matrices, B low-rank mblock)
 // idea: A B = (A U) V^H
@@ -271,6 +272,69 @@ void mltaGeMGeH_toMbl_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
 }
 
 
+// P(i0:i0+mA, j0:j0+nB) += d A B  (A,B H-matrices)
+// the products of the leaves are collected in P and added to the target at
+// once (see HProdAcc) instead of unifying and truncating the products of
+// the sons
+template<class T> static
+void mltaGeHGeH_toAcc_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
+                       mblock<T>** B, HProdAcc<T>& P, unsigned i0,
+                       unsigned j0)
+{
+  const unsigned mA = blA->getn1(), nA = blA->getn2(), nB = blB->getn2();
+
+  if (blB->isleaf() && blB->isLrM(B)) {          // A B = (A U) V^H
+    const unsigned rankB = blB->rank(B);
+    if (rankB==0) return;
+    T* const dataB = blB->data(B);
+    T* const tmp = new T[rankB*mA];
+    assert(tmp!=NULL);
+    blas::setzero(rankB*mA, tmp);
+    if (mltaGeHGeM(d, blA, A, rankB, dataB, nA, tmp, mA))
+      P.addLrM(i0, j0, mA, nB, rankB, tmp, mA, dataB+rankB*nA, nB);
+    delete [] tmp;
+  } else if (blA->isleaf() && blA->isLrM(A)) {   // A B = U (B^H V)^H
+    const unsigned rankA = blA->rank(A);
+    if (rankA==0) return;
+    T* const dataA = blA->data(A);
+    T* const tmp = new T[rankA*nB];
+    assert(tmp!=NULL);
+    blas::setzero(rankA*nB, tmp);
+    if (mltaGeHhGeM(d, blB, B, rankA, dataA+rankA*mA, nA, tmp, nB))
+      P.addLrM(i0, j0, mA, nB, rankA, dataA, mA, tmp, nB);
+    delete [] tmp;
+  } else if (blB->isleaf() && blB->isGeM(B)) {
+    T* const tmp = new T[mA*nB];
+    assert(tmp!=NULL);
+    blas::setzero(mA*nB, tmp);
+    if (mltaGeHGeM(d, blA, A, nB, blB->data(B), nA, tmp, mA))
+      P.addGeM(i0, j0, mA, nB, tmp, mA);
+    delete [] tmp;
+  } else if (blA->isleaf() && blA->isGeM(A)) {   // A B = (B^H A^H)^H
+    T* const tmp = new T[mA*(MAX(nA,nB)+nB)];
+    assert(tmp!=NULL);
+    blas::transpose(mA, nA, blA->data(A), tmp);
+    T* const tmp1 = tmp + mA*MAX(nA,nB);
+    blas::setzero(nB*mA, tmp1);
+    if (mltaGeHhGeM(d, blB, B, mA, tmp, nA, tmp1, nB)) {
+      blas::transpose(nB, mA, tmp1, tmp);
+      P.addGeM(i0, j0, mA, nB, tmp, mA);
+    }
+    delete [] tmp;
+  } else {
+    assert(blA->getncs()==blB->getnrs());
+    for (unsigned i=0; i<blA->getnrs(); ++i)
+      for (unsigned j=0; j<blB->getncs(); ++j)
+        for (unsigned k=0; k<blA->getncs(); ++k) {
+          blcluster *bl1 = blA->getson(i, k), *bl2 = blB->getson(k, j);
+          mltaGeHGeH_toAcc_(d, bl1, A, bl2, B, P,
+                            i0+bl1->getb1()-blA->getb1(),
+                            j0+bl2->getb2()-blB->getb2());
+        }
+  }
+}
+
+
 // C += d A B  (A,B H-matrices, C mblock)
 template<class T> static
 void mltaGeHGeH_toMbl_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
@@ -285,7 +349,11 @@ void mltaGeHGeH_toMbl_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
     mltaGeHGeM_toMbl_(d, blA, A, blB, B, mblC, eps, rankmax, haar);
   else if (blA->isleaf() && blA->isGeM(A))
     mltaGeMGeH_toMbl_(d, blA, A, blB, B, mblC, eps, rankmax, haar);
-  else {        // A and B are no leaves, hence the clusters can be subdivided
+  else if (haar==NULL && mblC->isAccRsvd()) {
+    HProdAcc<T> P(mblC->getn1(), mblC->getn2());
+    mltaGeHGeH_toAcc_(d, blA, A, blB, B, P, 0, 0);
+    P.flush(mblC, eps, rankmax);
+  } else {        // A and B are no leaves, hence the clusters can be subdivided
     assert(blA->getncs()==blB->getnrs());
     unsigned ns1 = blA->getnrs(), nsp = blA->getncs(), ns2 = blB->getncs();
 
@@ -448,36 +516,54 @@ void mltaGeHGeH_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
 }
 
 
+// C += d A B, the updates of the leaves of C are accumulated (acc>0) and
+// truncated at the end unless this is already done by the caller
+template<class T> static
+void mltaGeHGeH_acc_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
+                     mblock<T>** B, blcluster* blC, mblock<T>** C,
+                     double eps, unsigned rankmax, contBasis<T>* haar,
+                     unsigned acc)
+{
+  const bool own = (acc>0 && haar==NULL && initAccH(blC, C, acc==2));
+  mltaGeHGeH_(d, blA, A, blB, B, blC, C, eps, rankmax, haar);
+  if (own) flushAccH(blC, C);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Instanzen
 //
 
 void mltaGeHGeH(double d, blcluster* blA, mblock<double>** A, blcluster* blB,
 		mblock<double>** B, blcluster* blC, mblock<double>** C,
-		double eps, unsigned rankmax, contBasis<double>* haar)
+		double eps, unsigned rankmax, contBasis<double>* haar,
+		unsigned acc)
 {
-  mltaGeHGeH_(d, blA, A, blB, B, blC, C, eps, rankmax, haar);
+  mltaGeHGeH_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, haar, acc);
 }
 
 void mltaGeHGeH(float d, blcluster* blA, mblock<float>** A, blcluster* blB,
 		mblock<float>** B, blcluster* blC, mblock<float>** C,
-		double eps, unsigned rankmax, contBasis<float>* haar)
+		double eps, unsigned rankmax, contBasis<float>* haar,
+		unsigned acc)
 {
-  mltaGeHGeH_(d, blA, A, blB, B, blC, C, eps, rankmax, haar);
+  mltaGeHGeH_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, haar, acc);
 }
 
 void mltaGeHGeH(dcomp d, blcluster* blA, mblock<dcomp>** A, blcluster* blB,
 		mblock<dcomp>** B, blcluster* blC, mblock<dcomp>** C,
-		double eps, unsigned rankmax, contBasis<dcomp>* haar)
+		double eps, unsigned rankmax, contBasis<dcomp>* haar,
+		unsigned acc)
 {
-  mltaGeHGeH_(d, blA, A, blB, B, blC, C, eps, rankmax, haar);
+  mltaGeHGeH_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, haar, acc);
 }
 
 void mltaGeHGeH(scomp d, blcluster* blA, mblock<scomp>** A, blcluster* blB,
 		mblock<scomp>** B, blcluster* blC, mblock<scomp>** C,
-		double eps, unsigned rankmax, contBasis<scomp>* haar)
+		double eps, unsigned rankmax, contBasis<scomp>* haar,
+		unsigned acc)
 {
-  mltaGeHGeH_(d, blA, A, blB, B, blC, C, eps, rankmax, haar);
+  mltaGeHGeH_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, haar, acc);
 }
 
 
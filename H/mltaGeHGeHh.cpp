@@ -11,6 +11,7 @@
 
 #include "blcluster.h"
 #include "H.h"
+#include "HProdAcc.h"
 
 // C += d A B^H  (A,C H-matrices, B low-rank)
 // idea: A B^H = (A V) U^H
@@ -243,6 +244,68 @@ void mltaGeMGeHh_toMbl_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
 }
 
 
+// P(i0:i0+mA, j0:j0+mB) += d A B^H  (A,B H-matrices), see mltaGeHGeH_toAcc_
+template<class T> static
+void mltaGeHGeHh_toAcc_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
+                        mblock<T>** B, HProdAcc<T>& P, unsigned i0,
+                        unsigned j0)
+{
+  const unsigned mA = blA->getn1(), nA = blA->getn2(), mB = blB->getn1();
+
+  if (blB->isleaf() && blB->isLrM(B)) {          // A B^H = (A V) U^H
+    const unsigned rankB = blB->rank(B);
+    if (rankB==0) return;
+    T* const dataB = blB->data(B);
+    T* const tmp = new T[mA*rankB];
+    assert(tmp!=NULL);
+    blas::setzero(mA*rankB, tmp);
+    if (mltaGeHGeM(d, blA, A, rankB, dataB+rankB*mB, nA, tmp, mA))
+      P.addLrM(i0, j0, mA, mB, rankB, tmp, mA, dataB, mB);
+    delete [] tmp;
+  } else if (blA->isleaf() && blA->isLrM(A)) {   // A B^H = U (B V)^H
+    const unsigned rankA = blA->rank(A);
+    if (rankA==0) return;
+    T* const dataA = blA->data(A);
+    T* const tmp = new T[mB*rankA];
+    assert(tmp!=NULL);
+    blas::setzero(mB*rankA, tmp);
+    if (mltaGeHGeM(d, blB, B, rankA, dataA+rankA*mA, nA, tmp, mB))
+      P.addLrM(i0, j0, mA, mB, rankA, dataA, mA, tmp, mB);
+    delete [] tmp;
+  } else if (blB->isleaf() && blB->isGeM(B)) {
+    T* const tmp = new T[mB*(mA+nA)];
+    assert(tmp!=NULL);
+    blas::transpose(mB, nA, blB->data(B), tmp);
+    T* const tmp1 = tmp + mB*nA;
+    blas::setzero(mA*mB, tmp1);
+    if (mltaGeHGeM(d, blA, A, mB, tmp, nA, tmp1, mA))
+      P.addGeM(i0, j0, mA, mB, tmp1, mA);
+    delete [] tmp;
+  } else if (blA->isleaf() && blA->isGeM(A)) {   // A B^H = (B A^H)^H
+    T* const tmp = new T[mA*(MAX(nA,mB)+mB)];
+    assert(tmp!=NULL);
+    blas::transpose(mA, nA, blA->data(A), tmp);
+    T* const tmp1 = tmp + MAX(nA,mB)*mA;
+    blas::setzero(mB*mA, tmp1);
+    if (mltaGeHGeM(d, blB, B, mA, tmp, nA, tmp1, mB)) {
+      blas::transpose(mB, mA, tmp1, tmp);
+      P.addGeM(i0, j0, mA, mB, tmp, mA);
+    }
+    delete [] tmp;
+  } else {
+    assert(blA->getncs()==blB->getncs());
+    for (unsigned i=0; i<blA->getnrs(); ++i)
+      for (unsigned j=0; j<blB->getnrs(); ++j)
+        for (unsigned k=0; k<blA->getncs(); ++k) {
+          blcluster *bl1 = blA->getson(i, k), *bl2 = blB->getson(j, k);
+          mltaGeHGeHh_toAcc_(d, bl1, A, bl2, B, P,
+                             i0+bl1->getb1()-blA->getb1(),
+                             j0+bl2->getb1()-blB->getb1());
+        }
+  }
+}
+
+
 // C += d A B^H  (A,B H-matrices, C mblock)
 template<class T> static
 void mltaGeHGeHh_toMbl_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
@@ -257,7 +320,11 @@ void mltaGeHGeHh_toMbl_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
     mltaGeHGeMh_toMbl_(d, blA, A, blB, B, mblC, eps, rankmax);
   else if (blA->isleaf() && blA->isGeM(A))
     mltaGeMGeHh_toMbl_(d, blA, A, blB, B, mblC, eps, rankmax);
-  else {         // A and B are no leaves, hence the clusters can be subdivided
+  else if (mblC->isAccRsvd()) {
+    HProdAcc<T> P(mblC->getn1(), mblC->getn2());
+    mltaGeHGeHh_toAcc_(d, blA, A, blB, B, P, 0, 0);
+    P.flush(mblC, eps, rankmax);
+  } else {         // A and B are no leaves, hence the clusters can be subdivided
     assert(blA->getncs()==blB->getncs());
     unsigned ns1 = blA->getnrs(), nsp = blA->getncs(), ns2 = blB->getnrs();
 
@@ -374,36 +441,49 @@ void mltaGeHGeHh_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
   }
 }
 
+// C += d A B^H, the updates of the leaves of C are accumulated (acc>0) and
+// truncated at the end unless this is already done by the caller
+template<class T> static
+void mltaGeHGeHh_acc_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
+                      mblock<T>** B, blcluster* blC, mblock<T>** C,
+                      double eps, unsigned rankmax, unsigned acc)
+{
+  const bool own = (acc>0 && initAccH(blC, C, acc==2));
+  mltaGeHGeHh_(d, blA, A, blB, B, blC, C, eps, rankmax);
+  if (own) flushAccH(blC, C);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Instanzen
 //
 
 void mltaGeHGeHh(double d, blcluster* blA, mblock<double>** A, blcluster* blB,
               mblock<double>** B, blcluster* blC, mblock<double>** C,
-              double eps, unsigned rankmax)
+              double eps, unsigned rankmax, unsigned acc)
 {
-  mltaGeHGeHh_(d, blA, A, blB, B, blC, C, eps, rankmax);
+  mltaGeHGeHh_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, acc);
 }
 
 void mltaGeHGeHh(float d, blcluster* blA, mblock<float>** A, blcluster* blB,
               mblock<float>** B, blcluster* blC, mblock<float>** C,
-              double eps, unsigned rankmax)
+              double eps, unsigned rankmax, unsigned acc)
 {
-  mltaGeHGeHh_(d, blA, A, blB, B, blC, C, eps, rankmax);
+  mltaGeHGeHh_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, acc);
 }
 
 void mltaGeHGeHh(dcomp d, blcluster* blA, mblock<dcomp>** A, blcluster* blB,
               mblock<dcomp>** B, blcluster* blC, mblock<dcomp>** C,
-              double eps, unsigned rankmax)
+              double eps, unsigned rankmax, unsigned acc)
 {
-  mltaGeHGeHh_(d, blA, A, blB, B, blC, C, eps, rankmax);
+  mltaGeHGeHh_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, acc);
 }
 
 void mltaGeHGeHh(scomp d, blcluster* blA, mblock<scomp>** A, blcluster* blB,
               mblock<scomp>** B, blcluster* blC, mblock<scomp>** C,
-              double eps, unsigned rankmax)
+              double eps, unsigned rankmax, unsigned acc)
 {
-  mltaGeHGeHh_(d, blA, A, blB, B, blC, C, eps, rankmax);
+  mltaGeHGeHh_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, acc);
 }
 
 
@@ -558,6 +558,64 @@ void mltaSyHhVec_(T d, blcluster* bl, mblock<T>** A, T* x, T* y)
 
 
 
+// size of the L2 cache in bytes
+#ifndef L2_CACHE_SIZE
+#define L2_CACHE_SIZE 262144
+#endif
+
+// minimum number of columns of a panel
+#define MIN_PANEL_WIDTH 16
+
+// sum of the dimensions n1+n2 of the leaves
+static unsigned long sumdims_(blcluster* bl)
+{
+  if (bl->isleaf()) return bl->getn1() + bl->getn2();
+  unsigned long sum = 0;
+  for (unsigned i=0; i<bl->getnrs(); ++i)
+    for (unsigned j=0; j<bl->getncs(); ++j) {
+      blcluster* son = bl->getson(i, j);
+      if (son) sum += sumdims_(son);
+    }
+  return sum;
+}
+
+// The right-hand sides are processed in panels such that the parts of X and
+// Y belonging to an average leaf fit into the L2 cache. Each leaf is then
+// applied to a whole panel by BLAS-3 operations.
+template<class T> static
+unsigned panelwidth_(blcluster* bl, unsigned p)
+{
+  if (p<=MIN_PANEL_WIDTH) return p;
+  const unsigned long navg = sumdims_(bl)/bl->nleaves();
+  unsigned long pb = L2_CACHE_SIZE/(sizeof(T)*(navg+1));
+  if (pb<MIN_PANEL_WIDTH) pb = MIN_PANEL_WIDTH;
+  return (pb<p) ? pb : p;
+}
+
+// op=='N': Y += d A X, op=='H': Y += d A^H X, op=='S': Y += d A X with
+// A hermitian (only upper part stored)
+template<class T> static
+bool mltaHGeM_pnl_(char op, T d, blcluster* bl, mblock<T>** A, unsigned p,
+                   T* X, unsigned ldX, T* Y, unsigned ldY)
+{
+  const unsigned pb = panelwidth_<T>(bl, p);
+  bool changed = false;
+  for (unsigned l=0; l<p; l+=pb) {
+    const unsigned q = (pb<p-l) ? pb : p-l;
+    T *Xl = X + l*ldX, *Yl = Y + l*ldY;
+    if (op=='N') {
+      if (mltaGeHGeM_(d, bl, A, q, Xl, ldX, Yl, ldY)) changed = true;
+    } else if (op=='H') {
+      if (mltaGeHhGeM_(d, bl, A, q, Xl, ldX, Yl, ldY)) changed = true;
+    } else {
+      mltaHeHGeM_(d, bl, A, q, Xl, ldX, Yl, ldY);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Instanzen (solange template 'export' noch nicht funktioniert)
 
@@ -573,7 +631,7 @@ bool mltaGeHVec(double d, blcluster* bl, mblock<double>** A, double* x,
 bool mltaGeHGeM(double d, blcluster* bl, mblock<double>** A, unsigned p,
                double* X, unsigned ldX, double* Y, unsigned ldY)
 {
-  return mltaGeHGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  return mltaHGeM_pnl_('N', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 bool mltaGeHhVec(double d, blcluster* bl, mblock<double>** A, double* x,
@@ -585,7 +643,7 @@ bool mltaGeHhVec(double d, blcluster* bl, mblock<double>** A, double* x,
 bool mltaGeHhGeM(double d, blcluster* bl, mblock<double>** A, unsigned p,
                 double* X, unsigned ldX, double* Y, unsigned ldY)
 {
-  return mltaGeHhGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  return mltaHGeM_pnl_('H', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 // y += d A^H D x
@@ -660,7 +718,7 @@ void mltaHeHVec(double d, blcluster* bl, mblock<double>** A, double* x,
 void mltaHeHGeM(double d, blcluster* bl, mblock<double>** A, unsigned p,
                   double* X, unsigned ldX, double* Y, unsigned ldY)
 {
-  mltaHeHGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  mltaHGeM_pnl_('S', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 
@@ -676,7 +734,7 @@ bool mltaGeHVec(float d, blcluster* bl, mblock<float>** A, float* x, float* y)
 bool mltaGeHGeM(float d, blcluster* bl, mblock<float>** A, unsigned p,
                float* X, unsigned ldX, float* Y, unsigned ldY)
 {
-  return mltaGeHGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  return mltaHGeM_pnl_('N', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 bool mltaGeHhVec(float d, blcluster* bl, mblock<float>** A, float* x, float* y)
@@ -687,7 +745,7 @@ bool mltaGeHhVec(float d, blcluster* bl, mblock<float>** A, float* x, float* y)
 bool mltaGeHhGeM(float d, blcluster* bl, mblock<float>** A, unsigned p,
                 float* X, unsigned ldX, float* Y, unsigned ldY)
 {
-  return mltaGeHhGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  return mltaHGeM_pnl_('H', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 bool mltaGeHhDiHVec(float d, mblock<float>** A, blcluster* blA, blcluster* blD,
@@ -759,7 +817,7 @@ void mltaHeHVec(float d, blcluster* bl, mblock<float>** A, float* x,
 void mltaHeHGeM(float d, blcluster* bl, mblock<float>** A, unsigned p,
                   float* X, unsigned ldX, float* Y, unsigned ldY)
 {
-  mltaHeHGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  mltaHGeM_pnl_('S', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 
@@ -776,7 +834,7 @@ bool mltaGeHVec(dcomp d, blcluster* bl, mblock<dcomp>** A, dcomp* x,
 bool mltaGeHGeM(dcomp d, blcluster* bl, mblock<dcomp>** A, unsigned p,
                dcomp* X, unsigned ldX, dcomp* Y, unsigned ldY)
 {
-  return mltaGeHGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  return mltaHGeM_pnl_('N', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 bool mltaGeHhVec(dcomp d, blcluster* bl, mblock<dcomp>** A, dcomp* x,
@@ -788,7 +846,7 @@ bool mltaGeHhVec(dcomp d, blcluster* bl, mblock<dcomp>** A, dcomp* x,
 bool mltaGeHhGeM(dcomp d, blcluster* bl, mblock<dcomp>** A, unsigned p,
                 dcomp* X, unsigned ldX, dcomp* Y, unsigned ldY)
 {
-  return mltaGeHhGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  return mltaHGeM_pnl_('H', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 bool mltaGeHtVec(dcomp d, blcluster* bl, mblock<dcomp>** A, dcomp* x,
@@ -873,7 +931,7 @@ void mltaHeHVec(dcomp d, blcluster* bl, mblock<dcomp>** A, dcomp* x,
 void mltaHeHGeM(dcomp d, blcluster* bl, mblock<dcomp>** A, unsigned p,
                   dcomp* X, unsigned ldX, dcomp* Y, unsigned ldY)
 {
-  mltaHeHGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  mltaHGeM_pnl_('S', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 void mltaHeHtVec(dcomp d, blcluster* bl, mblock<dcomp>** A, dcomp* x,
@@ -914,7 +972,7 @@ bool mltaGeHVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
 bool mltaGeHGeM(scomp d, blcluster* bl, mblock<scomp>** A, unsigned p,
                scomp* X, unsigned ldX, scomp* Y, unsigned ldY)
 {
-  return mltaGeHGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  return mltaHGeM_pnl_('N', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 bool mltaGeHhVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
@@ -926,7 +984,7 @@ bool mltaGeHhVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
 bool mltaGeHhGeM(scomp d, blcluster* bl, mblock<scomp>** A, unsigned p,
 		 scomp* X, unsigned ldX, scomp* Y, unsigned ldY)
 {
-  return mltaGeHhGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  return mltaHGeM_pnl_('H', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 bool mltaGeHtVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
@@ -1011,7 +1069,7 @@ void mltaHeHVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
 void mltaHeHGeM(scomp d, blcluster* bl, mblock<scomp>** A, unsigned p,
                   scomp* X, unsigned ldX, scomp* Y, unsigned ldY)
 {
-  mltaHeHGeM_(d, bl, A, p, X, ldX, Y, ldY);
+  mltaHGeM_pnl_('S', d, bl, A, p, X, ldX, Y, ldY);
 }
 
 void mltaHeHtVec(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
@@ -12,49 +12,287 @@
 #include "mblock.h"
 #include "blcluster.h"
 #include "bllist.h"
+#include "blas.h"
+#ifdef _OPENMP
 #include <omp.h>
+#endif
+
+// The leaves are split into nparts consecutive parts of the Z-order block
+// sequence with (almost) equal number of stored entries and small ranges of
+// x and y (see genBlSeqPartLoc). Each part is processed by a single thread.
+// A part whose output range does not intersect the output range of any other
+// part writes to y directly, the other parts accumulate their contribution in
+// a private buffer, which is added to y afterwards. Hence, the result does not
+// depend on the scheduling.
 
 template<class T> static
-bool mltaGeHVec_omp_(T d, blcluster* bl, mblock<T>** A, T* x, T* y)
+void genBlSeqPart_omp_(blcluster* bl, mblock<T>** A, unsigned nparts,
+                       BlSeqPart& P, bool sym)
 {
-  return A[bl->getidx()]->mltaVec(d, x+bl->getb2(), y+bl->getb1());
+  P.clear();
+
+  if (sym) gen_upBlSequence(bl, P.BlList, P.nblcks);
+  else {
+    P.nblcks = bl->nleaves();
+    gen_BlSequence(bl, P.BlList);
+  }
+
+  // off-diagonal blocks of symmetric matrices are applied twice
+  unsigned long* cost = new unsigned long[P.nblcks];
+  assert(cost!=NULL);
+  for (unsigned i=0; i<P.nblcks; ++i) {
+    blcluster* b = P.BlList[i];
+    cost[i] = A[b->getidx()]->nvals() + 1;
+    if (sym && b->isndbl()) cost[i] *= 2;
+  }
+
+  P.nparts = MIN(MAX(nparts, 1u), P.nblcks);
+  genBlSeqPartLoc(P.BlList, P.nblcks, cost, P.nparts, P.part);
+  delete [] cost;
+
+  P.setExtents();
 }
 
+// output range of part i
+static void outrng_(BlSeqPart& P, unsigned i, char op,
+                    unsigned& beg, unsigned& end)
+{
+  if (op=='N') {
+    beg = P.beg1[i];
+    end = P.end1[i];
+  } else if (op=='H') {
+    beg = P.beg2[i];
+    end = P.end2[i];
+  } else {
+    beg = MIN(P.beg1[i], P.beg2[i]);
+    end = MAX(P.end1[i], P.end2[i]);
+  }
+}
+
+// op=='N': y += d A x, op=='H': y += d A^H x,
+// op=='S': y += d A x, where only the upper triangular part of the
+//          hermitian matrix A is stored
 template<class T> static
-bool mltaGeHVec_omp(T d, blcluster* bl, mblock<T>** A, T* x, T* y)
+bool mltaHVec_omp_(T d, BlSeqPart& P, mblock<T>** A, T* x, T* y, char op)
 {
-  unsigned nblcks = bl->nleaves();
+  const unsigned np = P.nparts;
+
+  // the sizes of the buffers depend on op, the workspace of P is reused
+  unsigned long nbuf = 0;
+  unsigned i, nmax = 0, b, e;
+  for (i=0; i<np; ++i) {
+    outrng_(P, i, op, b, e);
+    nbuf += e - b;
+  }
+  T** const buf = (T**) P.workspace(np*sizeof(T*) + nbuf*sizeof(T)
+                                    + 2*np*sizeof(unsigned) + np);
+  T* const wsp = (T*) (buf + np);
+  unsigned* const beg = (unsigned*) (wsp + nbuf);
+  unsigned* const end = beg + np;
+  bool* const ovlp = (bool*) (end + np);
+
+  for (i=0; i<np; ++i) {
+    outrng_(P, i, op, beg[i], end[i]);
+    if (end[i]>nmax) nmax = end[i];
+  }
+
+  nbuf = 0;
+  for (i=0; i<np; ++i) {
+    ovlp[i] = false;
+    for (unsigned j=0; j<np && !ovlp[i]; ++j)
+      if (j!=i && beg[i]<end[j] && beg[j]<end[i]) ovlp[i] = true;
+    buf[i] = NULL;
+    if (ovlp[i]) {
+      buf[i] = wsp + nbuf;
+      nbuf += end[i] - beg[i];
+    }
+  }
+
   bool changed = false;
-  blcluster** BlList;
-  gen_BlSequence(bl, BlList);
 
-#pragma omp parallel for schedule(dynamic)
-  for (int i=0; i<(int) nblcks; i++)
-    if (mltaGeHVec_omp_(d, BlList[i], A, x, y)) changed = true;
+#pragma omp parallel
+  {
+#pragma omp for schedule(static,1) reduction(||:changed)
+    for (int k=0; k<(int) np; ++k) {
+      T* yp = y;
+      if (ovlp[k]) {
+        blas::setzero(end[k]-beg[k], buf[k]);
+        yp = buf[k] - beg[k];
+      }
+
+      for (unsigned j=P.part[k]; j<P.part[k+1]; ++j) {
+        blcluster* bl = P.BlList[j];
+        mblock<T>* mbl = A[bl->getidx()];
+        const unsigned b1 = bl->getb1(), b2 = bl->getb2();
+        if (op=='H') {
+          if (mbl->mltahVec(d, x+b1, yp+b2)) changed = true;
+        } else {
+          if (mbl->mltaVec(d, x+b2, yp+b1)) changed = true;
+          if (op=='S' && bl->isndbl() && mbl->mltahVec(d, x+b1, yp+b2))
+            changed = true;
+        }
+      }
+    }
+
+    // add the buffers to y; each thread is responsible for a range of y
+#ifdef _OPENMP
+    const int nchnks = omp_get_num_threads();
+#else
+    const int nchnks = 1;
+#endif
+
+#pragma omp for schedule(static)
+    for (int c=0; c<nchnks; ++c) {
+      const unsigned lo = (unsigned) ((unsigned long) nmax*c/nchnks);
+      const unsigned hi = (unsigned) ((unsigned long) nmax*(c+1)/nchnks);
+      for (unsigned k=0; k<np; ++k)
+        if (buf[k]) {
+          const unsigned l = MAX(lo, beg[k]), h = MIN(hi, end[k]);
+          if (l<h) blas::add(h-l, buf[k]+l-beg[k], y+l);
+        }
+    }
+  }
 
   return changed;
 }
 
+template<class T> static
+bool mltaHVec_omp_(T d, blcluster* bl, mblock<T>** A, T* x, T* y, char op)
+{
+#ifdef _OPENMP
+  const unsigned nthr = omp_get_max_threads();
+#else
+  const unsigned nthr = 1;
+#endif
+  BlSeqPart P;
+  genBlSeqPart_omp_(bl, A, nthr, P, op=='S');
+  return mltaHVec_omp_(d, P, A, x, y, op);
+}
+
+
+// Instanzen
+
+void genBlSeqPart_omp(blcluster* bl, mblock<double>** A, unsigned nparts,
+                      BlSeqPart& P, bool sym)
+{
+  genBlSeqPart_omp_(bl, A, nparts, P, sym);
+}
+
+void genBlSeqPart_omp(blcluster* bl, mblock<float>** A, unsigned nparts,
+                      BlSeqPart& P, bool sym)
+{
+  genBlSeqPart_omp_(bl, A, nparts, P, sym);
+}
+
+void genBlSeqPart_omp(blcluster* bl, mblock<dcomp>** A, unsigned nparts,
+                      BlSeqPart& P, bool sym)
+{
+  genBlSeqPart_omp_(bl, A, nparts, P, sym);
+}
+
+void genBlSeqPart_omp(blcluster* bl, mblock<scomp>** A, unsigned nparts,
+                      BlSeqPart& P, bool sym)
+{
+  genBlSeqPart_omp_(bl, A, nparts, P, sym);
+}
+
+
 bool mltaGeHVec_omp(double d, blcluster* bl, mblock<double>** A, double* x,
 		   double* y)
 {
-  return mltaGeHVec_omp_(d, bl, A, x, y);
+  return mltaHVec_omp_(d, bl, A, x, y, 'N');
 }
 
 bool mltaGeHVec_omp(float d, blcluster* bl, mblock<float>** A, float* x,
 		   float* y)
 {
-  return mltaGeHVec_omp_(d, bl, A, x, y);
+  return mltaHVec_omp_(d, bl, A, x, y, 'N');
 }
 
 bool mltaGeHVec_omp(dcomp d, blcluster* bl, mblock<dcomp>** A, dcomp* x,
 		   dcomp* y)
 {
-  return mltaGeHVec_omp_(d, bl, A, x, y);
+  return mltaHVec_omp_(d, bl, A, x, y, 'N');
 }
 
 bool mltaGeHVec_omp(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
 		   scomp* y)
 {
-  return mltaGeHVec_omp_(d, bl, A, x, y);
+  return mltaHVec_omp_(d, bl, A, x, y, 'N');
+}
+
+
+bool mltaGeHVec_omp(double d, BlSeqPart& P, mblock<double>** A, double* x,
+		   double* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'N');
+}
+
+bool mltaGeHVec_omp(float d, BlSeqPart& P, mblock<float>** A, float* x,
+		   float* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'N');
+}
+
+bool mltaGeHVec_omp(dcomp d, BlSeqPart& P, mblock<dcomp>** A, dcomp* x,
+		   dcomp* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'N');
+}
+
+bool mltaGeHVec_omp(scomp d, BlSeqPart& P, mblock<scomp>** A, scomp* x,
+		   scomp* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'N');
+}
+
+
+bool mltaGeHhVec_omp(double d, BlSeqPart& P, mblock<double>** A, double* x,
+		    double* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'H');
+}
+
+bool mltaGeHhVec_omp(float d, BlSeqPart& P, mblock<float>** A, float* x,
+		    float* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'H');
+}
+
+bool mltaGeHhVec_omp(dcomp d, BlSeqPart& P, mblock<dcomp>** A, dcomp* x,
+		    dcomp* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'H');
+}
+
+bool mltaGeHhVec_omp(scomp d, BlSeqPart& P, mblock<scomp>** A, scomp* x,
+		    scomp* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'H');
+}
+
+
+// P has to be generated with sym=true
+bool mltaHeHVec_omp(double d, BlSeqPart& P, mblock<double>** A, double* x,
+		   double* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'S');
+}
+
+bool mltaHeHVec_omp(float d, BlSeqPart& P, mblock<float>** A, float* x,
+		   float* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'S');
+}
+
+bool mltaHeHVec_omp(dcomp d, BlSeqPart& P, mblock<dcomp>** A, dcomp* x,
+		   dcomp* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'S');
+}
+
+bool mltaHeHVec_omp(scomp d, BlSeqPart& P, mblock<scomp>** A, scomp* x,
+		   scomp* y)
+{
+  return mltaHVec_omp_(d, P, A, x, y, 'S');
 }
@@ -11,6 +11,7 @@
 
 #include "blcluster.h"
 #include "H.h"
+#include "HProdAcc.h"
 
 // C += d A^H B  (A,C H-matrices, B low-rank)
 template<class T> static
@@ -286,6 +287,65 @@ void mltaGeMhGeH_toMbl_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
 }
 
 
+// P(i0:i0+nA, j0:j0+nB) += d A^H B  (A,B H-matrices), see mltaGeHGeH_toAcc_
+template<class T> static
+void mltaGeHhGeH_toAcc_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
+                        mblock<T>** B, HProdAcc<T>& P, unsigned i0,
+                        unsigned j0)
+{
+  const unsigned mA = blA->getn1(), nA = blA->getn2(), nB = blB->getn2();
+
+  if (blB->isleaf() && blB->isLrM(B)) {          // A^H B = (A^H U) V^H
+    const unsigned rankB = blB->rank(B);
+    if (rankB==0) return;
+    T* const dataB = blB->data(B);
+    T* const tmp = new T[nA*rankB];
+    assert(tmp!=NULL);
+    blas::setzero(nA*rankB, tmp);
+    if (mltaGeHhGeM(d, blA, A, rankB, dataB, mA, tmp, nA))
+      P.addLrM(i0, j0, nA, nB, rankB, tmp, nA, dataB+rankB*mA, nB);
+    delete [] tmp;
+  } else if (blA->isleaf() && blA->isLrM(A)) {   // A^H B = V (B^H U)^H
+    const unsigned rankA = blA->rank(A);
+    if (rankA==0) return;
+    T* const dataA = blA->data(A);
+    T* const tmp = new T[nB*rankA];
+    assert(tmp!=NULL);
+    blas::setzero(nB*rankA, tmp);
+    if (mltaGeHhGeM(d, blB, B, rankA, dataA, mA, tmp, nB))
+      P.addLrM(i0, j0, nA, nB, rankA, dataA+rankA*mA, nA, tmp, nB);
+    delete [] tmp;
+  } else if (blB->isleaf() && blB->isGeM(B)) {
+    T* const tmp = new T[nA*nB];
+    assert(tmp!=NULL);
+    blas::setzero(nA*nB, tmp);
+    if (mltaGeHhGeM(d, blA, A, nB, blB->data(B), mA, tmp, nA))
+      P.addGeM(i0, j0, nA, nB, tmp, nA);
+    delete [] tmp;
+  } else if (blA->isleaf() && blA->isGeM(A)) {   // A^H B = (B^H A)^H
+    T* const tmp = new T[2*nA*nB];
+    assert(tmp!=NULL);
+    blas::setzero(nB*nA, tmp);
+    if (mltaGeHhGeM(d, blB, B, nA, blA->data(A), mA, tmp, nB)) {
+      T* const tmp1 = tmp + nA*nB;
+      blas::transpose(nB, nA, tmp, tmp1);
+      P.addGeM(i0, j0, nA, nB, tmp1, nA);
+    }
+    delete [] tmp;
+  } else {
+    assert(blA->getnrs()==blB->getnrs());
+    for (unsigned i=0; i<blA->getncs(); ++i)
+      for (unsigned j=0; j<blB->getncs(); ++j)
+        for (unsigned k=0; k<blA->getnrs(); ++k) {
+          blcluster *bl1 = blA->getson(k, i), *bl2 = blB->getson(k, j);
+          mltaGeHhGeH_toAcc_(d, bl1, A, bl2, B, P,
+                             i0+bl1->getb2()-blA->getb2(),
+                             j0+bl2->getb2()-blB->getb2());
+        }
+  }
+}
+
+
 // C += d A^H B  (A,B H-matrices, C mblock)
 template<class T> static
 void mltaGeHhGeH_toMbl_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
@@ -300,6 +360,10 @@ void mltaGeHhGeH_toMbl_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
     mltaGeHhGeM_toMbl_(d, blA, A, blB, B, mblC, eps, rankmax, haar);
   } else if (blA->isleaf() && blA->isGeM(A)){
     mltaGeMhGeH_toMbl_(d, blA, A, blB, B, mblC, eps, rankmax, haar);
+  } else if (haar==NULL && mblC->isAccRsvd()) {
+    HProdAcc<T> P(mblC->getn1(), mblC->getn2());
+    mltaGeHhGeH_toAcc_(d, blA, A, blB, B, P, 0, 0);
+    P.flush(mblC, eps, rankmax);
   } else {         // A and B are no leaves, hence the clusters can be subdivided
     assert(blA->getnrs()==blB->getnrs());
     unsigned ns1 = blA->getncs(), nsp = blA->getnrs(), ns2 = blB->getncs();
@@ -459,36 +523,54 @@ void mltaGeHhGeH_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
 }
 
 
+// C += d A^H B, the updates of the leaves of C are accumulated (acc>0) and
+// truncated at the end unless this is already done by the caller
+template<class T> static
+void mltaGeHhGeH_acc_(T d, blcluster* blA, mblock<T>** A, blcluster* blB,
+                      mblock<T>** B, blcluster* blC, mblock<T>** C,
+                      double eps, unsigned rankmax, contBasis<T>* haar,
+                      unsigned acc)
+{
+  const bool own = (acc>0 && haar==NULL && initAccH(blC, C, acc==2));
+  mltaGeHhGeH_(d, blA, A, blB, B, blC, C, eps, rankmax, haar);
+  if (own) flushAccH(blC, C);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Instanzen
 //
 
 void mltaGeHhGeH(double d, blcluster* blA, mblock<double>** A, blcluster* blB,
 		 mblock<double>** B, blcluster* blC, mblock<double>** C,
-		 double eps, unsigned rankmax, contBasis<double>* haar)
+		 double eps, unsigned rankmax, contBasis<double>* haar,
+		 unsigned acc)
 {
-  mltaGeHhGeH_(d, blA, A, blB, B, blC, C, eps, rankmax, haar);
+  mltaGeHhGeH_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, haar, acc);
 }
 
 void mltaGeHhGeH(float d, blcluster* blA, mblock<float>** A, blcluster* blB,
 		 mblock<float>** B, blcluster* blC, mblock<float>** C,
-		 double eps, unsigned rankmax, contBasis<float>* haar)
+		 double eps, unsigned rankmax, contBasis<float>* haar,
+		 unsigned acc)
 {
-  mltaGeHhGeH_(d, blA, A, blB, B, blC, C, eps, rankmax, haar);
+  mltaGeHhGeH_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, haar, acc);
 }
 
 void mltaGeHhGeH(dcomp d, blcluster* blA, mblock<dcomp>** A, blcluster* blB,
 		 mblock<dcomp>** B, blcluster* blC, mblock<dcomp>** C,
-		 double eps, unsigned rankmax, contBasis<dcomp>* haar)
+		 double eps, unsigned rankmax, contBasis<dcomp>* haar,
+		 unsigned acc)
 {
-  mltaGeHhGeH_(d, blA, A, blB, B, blC, C, eps, rankmax, haar);
+  mltaGeHhGeH_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, haar, acc);
 }
 
 void mltaGeHhGeH(scomp d, blcluster* blA, mblock<scomp>** A, blcluster* blB,
 		 mblock<scomp>** B, blcluster* blC, mblock<scomp>** C,
-		 double eps, unsigned rankmax, contBasis<scomp>* haar)
+		 double eps, unsigned rankmax, contBasis<scomp>* haar,
+		 unsigned acc)
 {
-  mltaGeHhGeH_(d, blA, A, blB, B, blC, C, eps, rankmax, haar);
+  mltaGeHhGeH_acc_(d, blA, A, blB, B, blC, C, eps, rankmax, haar, acc);
 }
 
 
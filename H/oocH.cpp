@@ -0,0 +1,392 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#include <vector>
+#include "blcluster.h"
+#include "bllist.h"
+#include "H.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifndef WIN32
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+// Out-of-core execution for H-matrices whose blocks are attached to a
+// mapped file (see mapmbls): matrix-vector products and the forward and
+// backward substitutions with the factors of HLU (see HLU_solve with a
+// budget). The factorization itself is not done out of core; it has to be
+// computed in memory and saved with savembls_bin, the factors can then be
+// mapped and applied with a bounded resident set.
+// The operation is a sequence of steps, each of which uses a single leaf.
+// While one thread executes the steps, a second thread loads the entries of
+// the following leaves from the file until budget bytes are loaded but not
+// yet used. After its step the pages of a leaf are returned to the
+// operating system. Leaves which are not attached to a mapping (e.g.
+// detached or changed after mapping) are simply used from memory. As the
+// mapping is read-only (see mblFile), returning the pages cannot discard
+// changes of the entries. Since the leaves are stored in the order of
+// gen_BlSequence (see savembls_bin), the file is read sequentially by the
+// matrix-vector multiplication.
+
+struct oocStep {
+  unsigned idx;               // index of the leaf
+  unsigned b1, b2;            // offsets of its rows and columns
+  char op;                    // 'N' Y_b1 += d A X_b2, 'H' Y_b2 += d A^H X_b1
+                              // 'L' solve PL Y_b1 = Y_b1, 'U' U Y_b1 = Y_b1
+};
+
+
+// the pages which contain the entries of mbl
+template<class T> static
+bool oocPages_(const mblock<T>* mbl, char*& beg, char*& end)
+{
+  if (!mbl->isAttached() || mbl->nvals()==0) return false;
+  beg = (char*) mbl->storage();
+  end = beg + mbl->nvals()*mblock<T>::bytesPrec(mbl->getPrec());
+  return true;
+}
+
+template<class T> static unsigned long oocBytes_(const mblock<T>* mbl)
+{
+  if (!mbl->isAttached()) return 0;
+  return mbl->nvals()*mblock<T>::bytesPrec(mbl->getPrec());
+}
+
+// loads the entries of mbl
+template<class T> static void oocLoad_(const mblock<T>* mbl)
+{
+  char *beg, *end;
+  if (!oocPages_(mbl, beg, end)) return;
+#ifndef WIN32
+  const unsigned long pg = sysconf(_SC_PAGESIZE);
+  char* const p = (char*) ((unsigned long) beg / pg * pg);
+  madvise(p, end-p, MADV_WILLNEED);
+#else
+  const unsigned long pg = 4096;
+#endif
+  volatile char s = 0;                  // touch each page
+  for (const char* q=beg; q<end; q+=pg) s += *q;
+  s += *(end-1);
+}
+
+// returns the pages of mbl except for the last one, which is shared with
+// the following leaf in the file (if last, it is returned too). The pages
+// are reclaimed by MADV_PAGEOUT if possible, which also removes them from
+// the page cache; otherwise the kernel would map them again when
+// neighbouring pages are accessed. If MADV_PAGEOUT is not available or
+// fails, the pages are only unmapped (MADV_DONTNEED).
+template<class T> static void oocRelease_(const mblock<T>* mbl, bool last)
+{
+#ifndef WIN32
+  char *beg, *end;
+  if (!oocPages_(mbl, beg, end)) return;
+  const unsigned long pg = sysconf(_SC_PAGESIZE);
+  char* const p = (char*) ((unsigned long) beg / pg * pg);
+  const unsigned long e = (unsigned long) end + (last ? pg-1 : 0);
+  char* const q = (char*) (e / pg * pg);
+  if (p<q) {
+#ifdef MADV_PAGEOUT
+    if (madvise(p, q-p, MADV_PAGEOUT)!=0)
+#endif
+      madvise(p, q-p, MADV_DONTNEED);
+  }
+#endif
+}
+
+// the counters of oocRun_ are written by the other thread
+template<class C> static C oocGet_(C* c)
+{
+  C v;
+#pragma omp atomic read
+  v = *c;
+#pragma omp flush
+  return v;
+}
+
+static void oocSet_(unsigned* c, unsigned v)
+{
+#pragma omp flush
+#pragma omp atomic write
+  *c = v;
+}
+
+static void oocYield_()
+{
+#ifndef WIN32
+  sched_yield();
+#endif
+}
+
+template<class T> static
+bool oocStep_(const oocStep& s, mblock<T>** A, T d, unsigned p,
+              T* X, unsigned ldX, T* Y, unsigned ldY)
+{
+  mblock<T>* mbl = A[s.idx];
+  switch (s.op) {
+  case 'N':
+    if (p==1) return mbl->mltaVec(d, X+s.b2, Y+s.b1);
+    return mbl->mltaGeM(d, p, X+s.b2, ldX, Y+s.b1, ldY);
+  case 'H':
+    if (p==1) return mbl->mltahVec(d, X+s.b1, Y+s.b2);
+    return mbl->mltahGeM(d, p, X+s.b1, ldX, Y+s.b2, ldY);
+  case 'L':
+    mbl->ltr_solve(p, Y+s.b1, ldY);
+    return true;
+  default:
+    mbl->utr_solve(p, Y+s.b1, ldY);
+    return true;
+  }
+}
+
+// executes the steps S
+template<class T> static
+bool oocRun_(const std::vector<oocStep>& S, mblock<T>** A, T d, unsigned p,
+             T* X, unsigned ldX, T* Y, unsigned ldY, unsigned long budget)
+{
+  const unsigned n = S.size();
+  bool changed = false;
+  unsigned ready = 0, done = 0;            // steps loaded and executed
+  unsigned long inflight = 0;              // bytes loaded, not released
+
+#pragma omp parallel num_threads(2)
+  {
+#ifdef _OPENMP
+    const int tid = omp_get_thread_num(), nthr = omp_get_num_threads();
+#else
+    const int tid = 0, nthr = 1;
+#endif
+
+    if (nthr==1) {
+      for (unsigned i=0; i<n; ++i) {
+        oocLoad_(A[S[i].idx]);
+        if (oocStep_(S[i], A, d, p, X, ldX, Y, ldY)) changed = true;
+        oocRelease_(A[S[i].idx], i+1==n);
+      }
+    } else if (tid==1) {                   // loads the leaves
+      for (unsigned i=0; i<n; ++i) {
+        const unsigned long b = oocBytes_(A[S[i].idx]);
+        while (oocGet_(&inflight)+b>budget && oocGet_(&done)<i) oocYield_();
+        oocLoad_(A[S[i].idx]);
+#pragma omp atomic
+        inflight += b;
+        oocSet_(&ready, i+1);
+      }
+    } else if (tid==0) {                   // executes the steps
+      for (unsigned i=0; i<n; ++i) {
+        while (oocGet_(&ready)<=i) oocYield_();
+        if (oocStep_(S[i], A, d, p, X, ldX, Y, ldY)) changed = true;
+        oocRelease_(A[S[i].idx], i+1==n);
+        const unsigned long b = oocBytes_(A[S[i].idx]);
+#pragma omp atomic
+        inflight -= b;
+        oocSet_(&done, i+1);
+      }
+    }
+  }
+  return changed;
+}
+
+
+// steps for the leaves of bl; the offsets are relative to (b1, b2)
+template<class T> static
+void oocLeaves_(blcluster* bl, mblock<T>** A, char op, unsigned b1,
+                unsigned b2, std::vector<oocStep>& S)
+{
+  blcluster** BlList;
+  gen_BlSequence(bl, BlList);
+  const unsigned n = bl->nleaves();
+  for (unsigned i=0; i<n; ++i) {
+    const unsigned idx = BlList[i]->getidx();
+    if (A[idx]==NULL) continue;
+    oocStep s;
+    s.idx = idx;
+    s.b1 = BlList[i]->getb1() - b1;
+    s.b2 = BlList[i]->getb2() - b2;
+    s.op = op;
+    S.push_back(s);
+  }
+  delete [] BlList;
+}
+
+// steps of the forward substitution, see LtHGeM_solve_
+template<class T> static
+void oocLtH_(blcluster* blL, mblock<T>** L, unsigned off,
+             std::vector<oocStep>& S)
+{
+  if (blL->isleaf()) oocLeaves_(blL, L, 'L', off, off, S);
+  else {
+    const unsigned ns = blL->getnrs();
+    for (unsigned i=0; i<ns; ++i) {
+      for (unsigned k=0; k<i; ++k)
+        oocLeaves_(blL->getson(i, k), L, 'N', off, off, S);
+      oocLtH_(blL->getson(i, i), L, off, S);
+    }
+  }
+}
+
+// steps of the backward substitution, see UtHGeM_solve_
+template<class T> static
+void oocUtH_(blcluster* blU, mblock<T>** U, unsigned off,
+             std::vector<oocStep>& S)
+{
+  if (blU->isleaf()) oocLeaves_(blU, U, 'U', off, off, S);
+  else {
+    const unsigned ns = blU->getnrs();
+    for (unsigned i=ns; i>0; --i) {
+      for (unsigned k=i; k<ns; ++k)
+        oocLeaves_(blU->getson(i-1, k), U, 'N', off, off, S);
+      oocUtH_(blU->getson(i-1, i-1), U, off, S);
+    }
+  }
+}
+
+
+// y += d A x
+template<class T> static
+bool mltaGeHVec_ooc_(T d, blcluster* bl, mblock<T>** A, T* x, T* y,
+                     unsigned long budget)
+{
+  std::vector<oocStep> S;
+  oocLeaves_(bl, A, 'N', bl->getb1(), bl->getb2(), S);
+  return oocRun_(S, A, d, 1, x, 0, y, 0, budget);
+}
+
+// y += d A^H x
+template<class T> static
+bool mltaGeHhVec_ooc_(T d, blcluster* bl, mblock<T>** A, T* x, T* y,
+                      unsigned long budget)
+{
+  std::vector<oocStep> S;
+  oocLeaves_(bl, A, 'H', bl->getb1(), bl->getb2(), S);
+  return oocRun_(S, A, d, 1, x, 0, y, 0, budget);
+}
+
+// solve L X = B for X, B is destroyed
+template<class T> static
+void LtHGeM_solve_ooc_(blcluster* blL, mblock<T>** L, unsigned p, T* B,
+                       unsigned ldB, unsigned long budget)
+{
+  std::vector<oocStep> S;
+  oocLtH_(blL, L, blL->getb1(), S);
+  oocRun_(S, L, (T) -1.0, p, B, ldB, B, ldB, budget);
+}
+
+// solve U X = B for X, B is destroyed
+template<class T> static
+void UtHGeM_solve_ooc_(blcluster* blU, mblock<T>** U, unsigned p, T* B,
+                       unsigned ldB, unsigned long budget)
+{
+  std::vector<oocStep> S;
+  oocUtH_(blU, U, blU->getb1(), S);
+  oocRun_(S, U, (T) -1.0, p, B, ldB, B, ldB, budget);
+}
+
+
+// Instanzen
+
+bool mltaGeHVec_ooc(double d, blcluster* bl, mblock<double>** A, double* x,
+                    double* y, unsigned long budget)
+{
+  return mltaGeHVec_ooc_(d, bl, A, x, y, budget);
+}
+
+bool mltaGeHVec_ooc(float d, blcluster* bl, mblock<float>** A, float* x,
+                    float* y, unsigned long budget)
+{
+  return mltaGeHVec_ooc_(d, bl, A, x, y, budget);
+}
+
+bool mltaGeHVec_ooc(dcomp d, blcluster* bl, mblock<dcomp>** A, dcomp* x,
+                    dcomp* y, unsigned long budget)
+{
+  return mltaGeHVec_ooc_(d, bl, A, x, y, budget);
+}
+
+bool mltaGeHVec_ooc(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
+                    scomp* y, unsigned long budget)
+{
+  return mltaGeHVec_ooc_(d, bl, A, x, y, budget);
+}
+
+bool mltaGeHhVec_ooc(double d, blcluster* bl, mblock<double>** A, double* x,
+                     double* y, unsigned long budget)
+{
+  return mltaGeHhVec_ooc_(d, bl, A, x, y, budget);
+}
+
+bool mltaGeHhVec_ooc(float d, blcluster* bl, mblock<float>** A, float* x,
+                     float* y, unsigned long budget)
+{
+  return mltaGeHhVec_ooc_(d, bl, A, x, y, budget);
+}
+
+bool mltaGeHhVec_ooc(dcomp d, blcluster* bl, mblock<dcomp>** A, dcomp* x,
+                     dcomp* y, unsigned long budget)
+{
+  return mltaGeHhVec_ooc_(d, bl, A, x, y, budget);
+}
+
+bool mltaGeHhVec_ooc(scomp d, blcluster* bl, mblock<scomp>** A, scomp* x,
+                     scomp* y, unsigned long budget)
+{
+  return mltaGeHhVec_ooc_(d, bl, A, x, y, budget);
+}
+
+void LtHGeM_solve_ooc(blcluster* blL, mblock<double>** L, unsigned p,
+                      double* B, unsigned ldB, unsigned long budget)
+{
+  LtHGeM_solve_ooc_(blL, L, p, B, ldB, budget);
+}
+
+void LtHGeM_solve_ooc(blcluster* blL, mblock<float>** L, unsigned p,
+                      float* B, unsigned ldB, unsigned long budget)
+{
+  LtHGeM_solve_ooc_(blL, L, p, B, ldB, budget);
+}
+
+void LtHGeM_solve_ooc(blcluster* blL, mblock<dcomp>** L, unsigned p,
+                      dcomp* B, unsigned ldB, unsigned long budget)
+{
+  LtHGeM_solve_ooc_(blL, L, p, B, ldB, budget);
+}
+
+void LtHGeM_solve_ooc(blcluster* blL, mblock<scomp>** L, unsigned p,
+                      scomp* B, unsigned ldB, unsigned long budget)
+{
+  LtHGeM_solve_ooc_(blL, L, p, B, ldB, budget);
+}
+
+void UtHGeM_solve_ooc(blcluster* blU, mblock<double>** U, unsigned p,
+                      double* B, unsigned ldB, unsigned long budget)
+{
+  UtHGeM_solve_ooc_(blU, U, p, B, ldB, budget);
+}
+
+void UtHGeM_solve_ooc(blcluster* blU, mblock<float>** U, unsigned p,
+                      float* B, unsigned ldB, unsigned long budget)
+{
+  UtHGeM_solve_ooc_(blU, U, p, B, ldB, budget);
+}
+
+void UtHGeM_solve_ooc(blcluster* blU, mblock<dcomp>** U, unsigned p,
+                      dcomp* B, unsigned ldB, unsigned long budget)
+{
+  UtHGeM_solve_ooc_(blU, U, p, B, ldB, budget);
+}
+
+void UtHGeM_solve_ooc(blcluster* blU, mblock<scomp>** U, unsigned p,
+                      scomp* B, unsigned ldB, unsigned long budget)
+{
+  UtHGeM_solve_ooc_(blU, U, p, B, ldB, budget);
+}
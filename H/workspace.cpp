@@ -0,0 +1,120 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#include <assert.h>
+#include <stddef.h>
+#include "workspace.h"
+#include "blas.h"
+
+template<class T> struct mblockWork_ {
+  T* p;
+  unsigned long n;
+  bool busy;
+};
+
+// one array per thread and type
+static mblockWork_<float> work_S = { NULL, 0, false };
+static mblockWork_<double> work_D = { NULL, 0, false };
+static mblockWork_<scomp> work_C = { NULL, 0, false };
+static mblockWork_<dcomp> work_Z = { NULL, 0, false };
+#pragma omp threadprivate(work_S, work_D, work_C, work_Z)
+
+static mblockWork_<float>& work_(float*) { return work_S; }
+static mblockWork_<double>& work_(double*) { return work_D; }
+static mblockWork_<scomp>& work_(scomp*) { return work_C; }
+static mblockWork_<dcomp>& work_(dcomp*) { return work_Z; }
+
+template<class T> static mblockWork_<T>& work_()
+{
+  return work_((T*) NULL);
+}
+
+// grow by at least 50% to avoid reallocations for slowly growing sizes
+template<class T> static void grow_(mblockWork_<T>& w, unsigned long n)
+{
+  if (n>w.n) {
+    delete [] w.p;
+    w.n = MAX(n, w.n+w.n/2);
+    w.p = new T[w.n];
+    assert(w.p!=NULL);
+  }
+}
+
+
+template<class T> mblockWork<T>::mblockWork(unsigned long n)
+{
+  mblockWork_<T>& w = work_<T>();
+  own = w.busy;
+  if (own) p = new T[n];
+  else {
+    grow_(w, n);
+    w.busy = true;
+    p = w.p;
+  }
+  assert(p!=NULL);
+}
+
+template<class T> mblockWork<T>::~mblockWork()
+{
+  if (own) delete [] p;
+  else work_<T>().busy = false;
+}
+
+template<class T> void mblockWork<T>::reserve(unsigned long n)
+{
+  mblockWork_<T>& w = work_<T>();
+  assert(!w.busy);
+  grow_(w, n);
+}
+
+// the largest arrays needed by addtrll and unify_cols/rows_LrMLrM if two
+// blocks of rank k are combined
+template<class T> void mblockWork<T>::reserve(unsigned n1, unsigned n2,
+                                              unsigned k)
+{
+  const unsigned long ksum = 2*k, LWORK = 10*ksum;
+  const unsigned long mmin = MIN(n1, ksum), nmin = MIN(n2, ksum);
+  const unsigned long amin = MIN(mmin, nmin);
+  const unsigned long s = ksum*(n1+n2)+LWORK+mmin+(mmin+amin+1)*nmin+amin;
+  const unsigned long sc = (n1+1)*ksum+2*(mmin*ksum+mmin)+LWORK+k*n2;
+  const unsigned long sr = (n2+1)*ksum+2*(nmin*ksum+nmin)+LWORK+k*n1;
+  reserve(MAX(s, MAX(sc, sr)));
+}
+
+template<class T> void mblockWork<T>::release()
+{
+  mblockWork_<T>& w = work_<T>();
+  assert(!w.busy);
+  delete [] w.p;
+  w.p = NULL;
+  w.n = 0;
+}
+
+template<class T> unsigned long mblockWork<T>::size()
+{
+  return work_<T>().n;
+}
+
+void releaseWork()
+{
+  mblockWork<float>::release();
+  mblockWork<double>::release();
+  mblockWork<scomp>::release();
+  mblockWork<dcomp>::release();
+}
+
+
+// Instanzen
+
+template class mblockWork<float>;
+template class mblockWork<double>;
+template class mblockWork<scomp>;
+template class mblockWork<dcomp>;
@@ -719,5 +719,392 @@ NSUCC:
   return false;
 }
 
+// ----------------------------------------------------------------------------
+// batched kernel evaluation
+//
+// Besides cmpbl, cmpblsym and scale a generator may provide overloads of the
+// following functions (found by argument dependent lookup). The defaults
+// evaluate one row or column at a time using cmpbl.
+
+// number of rows/columns the generator wants to evaluate at once,
+// 0 or 1 keeps the scalar ACA
+template<class MATGEN_T>
+inline unsigned ACA_nbatch(const MATGEN_T&)
+{
+  return 0;
+}
+
+// rows b1+rows[l], l=0,...,nr-1, of the block b1,b2,n2;
+// the l-th row is stored in d+l*n2
+template<class T, class MATGEN_T>
+inline void cmpblrows(MATGEN_T& MatGen, unsigned b1, unsigned nr,
+                      const unsigned* rows, unsigned b2, unsigned n2, T* d)
+{
+  for (unsigned l=0; l<nr; ++l) MatGen.cmpbl(b1+rows[l], 1, b2, n2, d+l*n2);
+}
+
+// columns b2+cols[l], l=0,...,nc-1, of the block b1,n1,b2;
+// the l-th column is stored in d+l*n1
+template<class T, class MATGEN_T>
+inline void cmpblcols(MATGEN_T& MatGen, unsigned b1, unsigned n1,
+                      unsigned b2, unsigned nc, const unsigned* cols, T* d)
+{
+  for (unsigned l=0; l<nc; ++l) MatGen.cmpbl(b1, n1, b2+cols[l], 1, d+l*n1);
+}
+
+
+// ----------------------------------------------------------------------------
+// block version of ACAr
+//
+// In each sweep nb rows are requested at once: the pivotal row i0 and the
+// rows of the largest entries of the last column (lookahead). The crosses
+// are found by partially pivoted elimination restricted to these rows.
+// Afterwards the corresponding columns are requested at once. The stopping
+// criterion is checked for each cross; the crosses of the last sweep are kept.
+// For nb=1 the same approximation as with ACAr is computed.
+
+template<class T, class MATGEN_T>
+bool ACAb(MATGEN_T& MatGen, unsigned b1, unsigned n1, unsigned b2, unsigned n2,
+          double eps, unsigned kmax, unsigned i0, unsigned& k, T* &U, T* &V,
+          unsigned nb)
+{
+  typedef typename num_traits<T>::abs_type abs_T;
+  unsigned l, r, no = 0;
+  abs_T nrmlsk2 = 0.0, nrms2 = 0.0;
+  T sum;
+
+  abs_T scale = MatGen.scale(b1, n1, b2, n2); // set initial scale
+
+  if (nb<1) nb = 1;
+  if (nb>n1) nb = n1;
+
+  U = new T[(kmax+1)*n1];
+  V = new T[(kmax+1)*n2];
+  assert(U!=NULL && V!=NULL);
+
+  int *Z = new int[n1];
+  unsigned *rows = new unsigned[2*nb], *cols = rows + nb;
+  abs_T *piv = new abs_T[nb];
+  T *R = new T[nb*n2], *W = new T[(kmax+1)*nb];
+  assert(Z!=NULL && rows!=NULL && piv!=NULL && R!=NULL && W!=NULL);
+
+  for (l=0; l<n1; ++l) Z[l] = 0;
+
+  k = 0;
+
+  do {
+
+    // choose the rows of this sweep, start with i0
+    unsigned m = 0;
+    rows[m++] = i0;
+    while (m<nb && m<n1-no && m<kmax-k) {
+      unsigned imax = n1;
+      if (k>0) {
+        abs_T absmax = -1.0;
+        const T* const pu = U + (k-1)*n1;
+        for (l=0; l<n1; ++l) {
+          if (Z[l]<0) continue;
+          bool used = false;
+          for (r=0; r<m && !used; ++r) used = (rows[r]==l);
+          if (!used && abs(pu[l])>absmax) {
+            absmax = abs(pu[l]);
+            imax = l;
+          }
+        }
+      } else {       // no information yet, take rows evenly distributed
+        imax = nexti(n1, Z, (i0 + m*(n1/nb)) % n1);
+        for (r=0; r<m; ++r)
+          if (rows[r]==imax) imax = n1;
+      }
+      if (imax==n1) break;
+      rows[m++] = imax;
+    }
+
+    // rows of the remainder (conjugated)
+    cmpblrows(MatGen, b1, m, rows, b2, n2, R);
+    blas::conj(m*n2, R);
+    if (k>0) {
+      for (r=0; r<m; ++r)
+        for (l=0; l<k; ++l) W[l+r*k] = conj(U[l*n1+rows[r]]);
+      blas::gemma(n2, k, m, (T) -1.0, V, n2, W, k, R, n2);
+    }
+
+    // crosses restricted to the rows of this sweep
+    unsigned mc = 0, r0 = 0;
+    bool* done = new bool[m];
+    assert(done!=NULL);
+    for (r=0; r<m; ++r) done[r] = false;
+
+    while (r0<m) {
+      T* const pr = R + r0*n2;
+      abs_T absmax = 0.0;
+      unsigned j0 = 0;
+      for (l=0; l<n2; ++l) {
+        const abs_T eabs = abs(pr[l]);
+        if (eabs>absmax) {
+          absmax = eabs;
+          j0 = l;
+        }
+      }
+
+      done[r0] = true;
+      Z[rows[r0]] = -1;
+      ++no;
+
+      if (absmax >= 1e-14 * scale) {
+        const abs_T sqrtpiv = sqrt(absmax);
+        T* const pv = V + (k+mc)*n2;
+        const T sca = sqrtpiv/pr[j0];
+        for (l=0; l<n2; ++l) pv[l] = pr[l] * sca;
+        cols[mc] = j0;
+        piv[mc++] = sqrtpiv;
+
+        // eliminate the cross from the other rows, next pivotal row
+        absmax = -1.0;
+        unsigned rnext = m;
+        for (r=0; r<m; ++r) {
+          if (done[r]) continue;
+          T* const ps = R + r*n2;
+          const T d = ps[j0]/sqrtpiv;
+          blas::axpy(n2, -d, pv, ps);
+          if (abs(d)>absmax) {
+            absmax = abs(d);
+            rnext = r;
+          }
+        }
+        r0 = rnext;
+      } else {
+        for (r0=0; r0<m && done[r0]; ++r0);
+      }
+    }
+    delete [] done;
+
+    if (mc==0) {              // all rows of this sweep are zero
+      if (no<n1) {
+        i0 = nexti(n1, Z, i0);
+        continue;
+      }
+      nrmlsk2 = 0.0;
+      break;
+    }
+
+    // columns of the remainder
+    cmpblcols(MatGen, b1, n1, b2, mc, cols, U+k*n1);
+    if (k>0) {
+      for (r=0; r<mc; ++r)
+        for (l=0; l<k; ++l) W[l+r*k] = conj(V[l*n2+cols[r]]);
+      blas::gemma(n1, k, mc, (T) -1.0, U, n1, W, k, U+k*n1, n1);
+    }
+
+    for (r=0; r<mc; ++r) {
+      T* const pu = U + (k+r)*n1;
+      for (l=0; l<r; ++l) {
+        const T d = nconj(V[(k+l)*n2+cols[r]]);
+        blas::axpy(n1, d, U+(k+l)*n1, pu);
+      }
+      blas::scal(n1, (T) (1.0/piv[r]), pu);
+    }
+
+    // update norms, check stopping criterion
+    bool stop = false;
+    for (r=0; r<mc; ++r, ++k) {
+      const abs_T nrmu2 = blas::nrm2(n1, U+k*n1), nrmv2 = blas::nrm2(n2, V+k*n2);
+      nrmlsk2 = nrmu2*nrmu2 * nrmv2*nrmv2;
+
+      sum = (T) 0.0;
+      for (l=0; l<k; ++l)
+        sum += blas::scpr(n1, U+l*n1, U+k*n1) * blas::scpr(n2, V+l*n2, V+k*n2);
+
+      nrms2 += 2.0 * Re(sum) + nrmlsk2;
+      if (nrmlsk2<eps*eps*nrms2) stop = true;
+    }
+
+    // adjust scale (estimated entry size of the next remainder)
+    scale = sqrt(nrmlsk2/(n1*n2));
+
+    if (stop) break;
+
+    // new pivotal row: maximum of the last column
+    const T* const pu = U + (k-1)*n1;
+    abs_T absmax = -1.0;
+    for (l=0; l<n1; ++l)
+      if (Z[l]>=0 && abs(pu[l])>absmax) {
+        i0 = l;
+        absmax = abs(pu[l]);
+      }
+
+  } while (no<n1 && k<kmax);
+
+  delete [] W;
+  delete [] R;
+  delete [] piv;
+  delete [] rows;
+  delete [] Z;
+
+  if (nrms2>0.0 && sqrt(nrmlsk2/nrms2)>=eps) return false;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// a posteriori error control and randomized fallback
+
+// pseudo random numbers, standard normal distribution (Box-Muller);
+// an own generator is used such that the results are reproducible and
+// independent of the thread
+inline double ACA_randn(unsigned long& seed)
+{
+  seed = (1664525ul*seed + 1013904223ul) & 0xfffffffful;
+  const double u1 = (seed + 1.0) / 4294967297.0;
+  seed = (1664525ul*seed + 1013904223ul) & 0xfffffffful;
+  const double u2 = seed / 4294967296.0;
+  return sqrt(-2.0*log(u1)) * cos(6.283185307179586*u2);
+}
+
+// number of rows of the a posteriori check of the cross approximation
+// (ACA_check); 0 switches the check off. A generator may provide an
+// overload like ACA_nbatch, since the check costs ns additional rows
+// per admissible block.
+template<class MATGEN_T>
+inline unsigned ACA_ncheck(const MATGEN_T&)
+{
+  return 0;
+}
+
+// checks the approximation U V^H of the block by ns (at most n1) rows with
+// equal distance and a pseudo random offset; the rows are returned in
+// increasing order in rows and their entries in R (the l-th row in R+l*n2)
+// such that they can be reused. Returns false if the relative error of
+// these rows exceeds fac*eps
+template<class T, class MATGEN_T>
+bool ACA_check(MATGEN_T& MatGen, unsigned b1, unsigned n1, unsigned b2,
+               unsigned n2, unsigned k, T* U, T* V, double eps,
+               unsigned ns, unsigned* rows, T* R, double fac=20.0)
+{
+  typedef typename num_traits<T>::abs_type abs_T;
+  unsigned long seed = 2654435761ul*b1 + b2;
+  abs_T nrm2 = 0.0, err2 = 0.0;
+
+  assert(ns<=n1);
+  seed = (1664525ul*seed + 1013904223ul) & 0xfffffffful;
+  const unsigned i0 = (unsigned) (((double) seed/4294967296.0) * n1);
+  for (unsigned s=0; s<ns; ++s)
+    rows[s] = (unsigned) ((i0 + (unsigned long) s*n1/ns) % n1);
+  for (unsigned s=1; s<ns; ++s)                 // sort, ns is small
+    for (unsigned t=s; t>0 && rows[t-1]>rows[t]; --t) {
+      const unsigned r = rows[t];
+      rows[t] = rows[t-1];
+      rows[t-1] = r;
+    }
+  cmpblrows(MatGen, b1, ns, rows, b2, n2, R);
+
+  T* const pv = new T[n2];
+  assert(pv!=NULL);
+  for (unsigned s=0; s<ns; ++s) {
+    const unsigned i = rows[s];
+    blas::copy(n2, R+s*n2, pv);
+    blas::conj(n2, pv);
+    const abs_T nrm = blas::nrm2(n2, pv);
+    nrm2 += nrm*nrm;
+
+    for (unsigned l=0; l<k; ++l)
+      blas::axpy(n2, nconj(U[l*n1+i]), V+l*n2, pv);
+    const abs_T err = blas::nrm2(n2, pv);
+    err2 += err*err;
+  }
+
+  delete [] pv;
+  return (err2 <= fac*fac*eps*eps*nrm2);
+}
+
+
+// randomized range finder (N. Halko, P.G. Martinsson, J.A. Tropp,
+// SIAM Rev. 53, 2011) for the dense n1 x n2 matrix A:
+// the basis Q is extended by blocks of nb columns Q=orth(A Omega) until the
+// Frobenius norm of (I-QQ^H)A, which is estimated from nt independent
+// samples, is less than eps ||A||_F. Then V = A^H Q.
+// On exit U V^H approximates A; returns false if the rank exceeds kmax.
+template<class T>
+bool RRF(unsigned n1, unsigned n2, T* A, double eps, unsigned kmax,
+         unsigned& k, T* &U, T* &V, unsigned long seed=1)
+{
+  typedef typename num_traits<T>::abs_type abs_T;
+  const unsigned nb = 8, nt = 8;
+  unsigned j, l;
+
+  kmax = MIN(kmax, MIN(n1, n2));
+  U = new T[(kmax+nb)*n1];
+  V = new T[(kmax+nb)*n2];
+  T *Om = new T[n2*nb], *Y = new T[n1*nt], *s = new T[kmax+nb];
+  assert(U!=NULL && V!=NULL && Om!=NULL && Y!=NULL && s!=NULL);
+
+  // test samples
+  for (l=0; l<nt; ++l) {
+    for (j=0; j<n2; ++j) Om[j] = (T) ACA_randn(seed);
+    blas::setzero(n1, Y+l*n1);
+    blas::gemva(n1, n2, (T) 1.0, A, Om, Y+l*n1);
+  }
+  abs_T nrmA2 = 0.0;
+  for (l=0; l<nt; ++l) {
+    const abs_T e = blas::nrm2(n1, Y+l*n1);
+    nrmA2 += e*e;
+  }
+
+  k = 0;
+  abs_T err2 = nrmA2;
+  while (err2>eps*eps*nrmA2 && k<kmax) {
+
+    // new block of the range
+    for (j=0; j<n2*nb; ++j) Om[j] = (T) ACA_randn(seed);
+    T* const Q = U + k*n1;
+    blas::setzero(n1*nb, Q);
+    blas::gemma(n1, n2, nb, (T) 1.0, A, n1, Om, n2, Q, n1);
+
+    // orthogonalize (twice), drop dependent columns
+    unsigned knew = k;
+    for (j=0; j<nb; ++j) {
+      T* const q = Q + j*n1;
+      const abs_T nrm0 = blas::nrm2(n1, q);
+      for (unsigned r=0; r<2; ++r) {
+        if (knew>0) {
+          blas::gemhm(n1, knew, 1, (T) 1.0, U, n1, q, n1, s, knew);
+          blas::gemma(n1, knew, 1, (T) -1.0, U, n1, s, knew, q, n1);
+        }
+      }
+      const abs_T nrm = blas::nrm2(n1, q);
+      if (nrm>1e6*D_PREC*nrm0 && nrm>0.0) {
+        blas::scal(n1, (T) (1.0/nrm), q);
+        if (knew<k+j) blas::copy(n1, q, U+knew*n1);
+        ++knew;
+      }
+    }
+    if (knew==k) break;     // no new direction, remainder is negligible
+
+    // project the test samples
+    for (l=0; l<nt; ++l) {
+      T* const y = Y + l*n1;
+      blas::gemhm(n1, knew-k, 1, (T) 1.0, U+k*n1, n1, y, n1, s, knew-k);
+      blas::gemma(n1, knew-k, 1, (T) -1.0, U+k*n1, n1, s, knew-k, y, n1);
+    }
+    k = knew;
+
+    err2 = 0.0;
+    for (l=0; l<nt; ++l) {
+      const abs_T e = blas::nrm2(n1, Y+l*n1);
+      err2 += e*e;
+    }
+  }
+
+  delete [] s;
+  delete [] Y;
+  delete [] Om;
+
+  // the last block may have exceeded kmax
+  if (k>kmax || err2>eps*eps*nrmA2) return false;
+
+  // V = A^H Q
+  if (k>0) blas::gemhm(n1, n2, k, (T) 1.0, A, n1, U, n1, V, n2);
+  return true;
+}
+
 #endif
 
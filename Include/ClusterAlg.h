@@ -33,6 +33,10 @@
 #define UNWEIGHTED
 #endif
 
+// clusters with less indices are subdivided within the task of their
+// father; also the neighbour tests are done in parallel only above
+#define CLTASK_MIN 4096
+
 class ClusterAlg;
 class AdjMat;
 template <class NodeDataType, class EdgeWeightType> class MGraph;
@@ -13,6 +13,7 @@
 #define H_H
 
 #include "blcluster.h"
+#include "bllist.h"
 #include "helper.h"
 #include "preserveVec2.h"
 #include <fstream>
@@ -44,6 +45,112 @@ template<class T> void freembls(blcluster* bl, mblock<T>**& A)
   freembls(bl->nleaves(), A);
 }
 
+// moves the entries of all blocks to the arena ar, where they are stored
+// contiguously in the order of the matrix-vector multiplication;
+// the blocks have to be deleted before ar
+template<class T> void packmbls(blcluster* bl, mblock<T>** A,
+                                mblockArena<T>& ar)
+{
+  const unsigned n = bl->nleaves();
+  blcluster** BlList;
+  gen_BlSequence(bl, BlList);
+
+  unsigned long size = 0;
+  for (unsigned i=0; i<n; ++i) {
+    mblock<T>* mbl = A[BlList[i]->getidx()];
+    if (mbl!=NULL) size += mbl->nvals() + 2;
+  }
+  ar.reserve(size);
+
+  for (unsigned i=0; i<n; ++i) {
+    mblock<T>* mbl = A[BlList[i]->getidx()];
+    if (mbl!=NULL) mbl->setArena(&ar);
+  }
+  delete [] BlList;
+}
+
+// the low-rank leaves of bl accumulate their updates, which are truncated
+// at once by flushAccH (see mblock::initAcc); returns true if a leaf has
+// not been accumulating before.
+// The argument acc of mltaGeHGeH, mltaGeHhGeH, mltaGeHGeHh, HLU and HCholesky
+// switches this on for the blocks which are updated: 0 no accumulation,
+// 1 accumulation, 2 accumulation and truncation by a randomized SVD.
+// If the target leaf of a product of two H-matrices is accumulating with
+// the randomized SVD, the products of their leaves are collected and added
+// to the target with a single truncation (see HProdAcc) instead of
+// truncating the products of the sons and their unions
+template<class T> bool initAccH(blcluster* bl, mblock<T>** A,
+                                bool rsvd=false)
+{
+  if (bl->isleaf()) {
+    mblock<T>* mbl = A[bl->getidx()];
+    if (mbl==NULL || mbl->isAcc() || !mbl->isLrM()) return false;
+    mbl->initAcc(rsvd);
+    return true;
+  }
+
+  bool ret = false;
+  for (unsigned i=0; i<bl->getnrs(); ++i)
+    for (unsigned j=0; j<bl->getncs(); ++j) {
+      blcluster* son = bl->getson(i, j);
+      if (son!=NULL && initAccH(son, A, rsvd)) ret = true;
+    }
+  return ret;
+}
+
+// adds the pending updates of the leaves of bl
+template<class T> void flushAccH(blcluster* bl, mblock<T>** A)
+{
+  if (bl->isleaf()) {
+    mblock<T>* mbl = A[bl->getidx()];
+    if (mbl!=NULL) mbl->flushAcc();
+  } else
+    for (unsigned i=0; i<bl->getnrs(); ++i)
+      for (unsigned j=0; j<bl->getncs(); ++j) {
+        blcluster* son = bl->getson(i, j);
+        if (son!=NULL) flushAccH(son, A);
+      }
+}
+
+// stores each leaf of bl in the lowest precision (see mblock::setPrec) for
+// which the error of the whole matrix stays below eps ||A||_F. Rounding to
+// unit roundoff u changes a dense leaf B by at most u ||B||_F and a low-rank
+// leaf U V^H by at most 2u ||U||_F ||V||_F, hence leaves which are small
+// compared with ||A||_F are stored in bfloat16 or single precision.
+// setPrecH(bl, A, 0.0) restores all leaves to precision T (the rounding
+// errors remain).
+template<class T> void setPrecH(blcluster* bl, mblock<T>** A, double eps)
+{
+  typedef typename num_traits<T>::abs_type R;
+  const double u[3] = { 0.0, 5.97e-8, 3.91e-3 };     // 2^-24 and 2^-8
+  const unsigned n = bl->nleaves();
+
+  double nrm2 = 0.0;
+  for (unsigned i=0; i<n; ++i)
+    if (A[i]!=NULL) {
+      A[i]->setPrec(0);
+      nrm2 += A[i]->nrmF2();
+    }
+  if (eps<=0.0) return;
+
+  // the squared errors of the leaves add up to at most eps^2 ||A||_F^2
+  const double tol = eps*sqrt(nrm2/n);
+
+  for (unsigned i=0; i<n; ++i) {
+    mblock<T>* mbl = A[i];
+    if (mbl==NULL || mbl->nvals()==0) continue;
+    double e;
+    if (mbl->isLrM()) {
+      const unsigned n1 = mbl->getn1(), n2 = mbl->getn2(), k = mbl->rank();
+      e = 2.0 * blas::nrm2(k*n1, mbl->getdata())
+        * blas::nrm2(k*n2, mbl->getdata()+k*n1);
+    } else e = sqrt(mbl->nrmF2());
+
+    if (u[2]*e<=tol) mbl->setPrec(2);
+    else if (sizeof(R)==sizeof(double) && u[1]*e<=tol) mbl->setPrec(1);
+  }
+}
+
 template<class T> static
 void loadmbls_(const unsigned n, mblock<T>** &A, std::ifstream& is)
 {
@@ -232,17 +339,24 @@ extern void mltaUtHhGeM(double, blcluster*, mblock<double>**, unsigned,
 extern void mltaHeHVec(double, blcluster*, mblock<double>**, double*, double*);
 extern void mltaHeHGeM(double, blcluster*, mblock<double>**, unsigned,
 		       double*, unsigned, double*, unsigned);
+////mltaGeHVec_omp.cpp:
+extern void genBlSeqPart_omp(blcluster*, mblock<double>**, unsigned, BlSeqPart&,
+			     bool sym=false);
+extern bool mltaGeHVec_omp(double, blcluster*, mblock<double>**, double*, double*);
+extern bool mltaGeHVec_omp(double, BlSeqPart&, mblock<double>**, double*, double*);
+extern bool mltaGeHhVec_omp(double, BlSeqPart&, mblock<double>**, double*, double*);
+extern bool mltaHeHVec_omp(double, BlSeqPart&, mblock<double>**, double*, double*);
 ////mltaGeHGeH.cpp:
 extern void mltaGeHGeH(double, blcluster*, mblock<double>**, blcluster*, 
 		       mblock<double>**, blcluster*, mblock<double>**, double, 
-		       unsigned, contBasis<double>* haar=NULL);
+		       unsigned, contBasis<double>* haar=NULL, unsigned acc=0);
 extern void mltaGeHGeH_toMbl(double, blcluster*, mblock<double>**, blcluster*,
 			     mblock<double>**, mblock<double>*, double, 
 			     unsigned, contBasis<double>* haar=NULL);
 ////mltaGeHhGeH.cpp:
 extern void mltaGeHhGeH(double, blcluster*, mblock<double>**, blcluster*, 
 			mblock<double>**, blcluster*, mblock<double>**, double,
-			unsigned, contBasis<double>* haar=NULL);
+			unsigned, contBasis<double>* haar=NULL, unsigned acc=0);
 extern void mltaGeHhGeH_toMbl(double, blcluster*, mblock<double>**,
 			      blcluster*, mblock<double>**, mblock<double>*, 
 			      double, unsigned);
@@ -298,7 +412,7 @@ extern void mltaGeHhDiHGeH_toHeH(double, blcluster*, mblock<double>**,
 ////mltaGeHGeHh.cpp:
 extern void mltaGeHGeHh(double, blcluster*, mblock<double>**, blcluster*,
 			mblock<double>**, blcluster*, mblock<double>**,
-			double, unsigned);
+			double, unsigned, unsigned acc=0);
 extern void mltaGeHGeHh_toMbl(double, blcluster*, mblock<double>**,
 			      blcluster*, mblock<double>**, mblock<double>*, 
 			      double, unsigned);
@@ -362,15 +476,22 @@ extern void invertHeH(blcluster*, mblock<double>**, mblock<double>**&,
 ////HLU.cpp:
 extern bool HLU(blcluster*, mblock<double>**, mblock<double>**, 
 		mblock<double>**, double, unsigned, 
-		contBasis<double>* haar=NULL);
+		contBasis<double>* haar=NULL, unsigned acc=0);
 extern bool HCholesky(blcluster* const, mblock<double>** const, const double,
-                      const unsigned, contBasis<double>* haar=NULL);
+                      const unsigned, contBasis<double>* haar=NULL,
+                      unsigned acc=0);
 extern bool HUhDU(blcluster*, mblock<double>**, int*, double, unsigned);
 extern bool genLUprecond(blcluster*, mblock<double>**, double, unsigned,
                          blcluster*&, mblock<double>**&, mblock<double>**&,
                          bool);
 extern bool genCholprecond(blcluster*, mblock<double>**, double, unsigned,
                            blcluster*&, mblock<double>**&, bool);
+extern bool HLU_omp(blcluster* const, mblock<double>** const, mblock<double>** const,
+                    mblock<double>** const, const double, const unsigned,
+                    contBasis<double>* haar=NULL, unsigned acc=0);
+extern bool HCholesky_omp(blcluster* const, mblock<double>** const, const double,
+                          const unsigned, contBasis<double>* haar=NULL,
+                          unsigned acc=0);
 ////TU_solve.cpp:
 extern void LtHGeM_solve(blcluster*, mblock<double>**, unsigned, double*,
                          unsigned);
@@ -400,6 +521,15 @@ extern void UtHhDdns_solve(blcluster*, mblock<double>**, int*, unsigned,
 //extern void HLtHh_solve(blcluster*, mblock<double>**, blcluster*,
 // mblock<double>** B, mblock<double>**, double, unsigned);
 
+////oocH.cpp:
+extern bool mltaGeHVec_ooc(double, blcluster*, mblock<double>**, double*,
+                           double*, unsigned long);
+extern bool mltaGeHhVec_ooc(double, blcluster*, mblock<double>**, double*,
+                            double*, unsigned long);
+extern void LtHGeM_solve_ooc(blcluster*, mblock<double>**, unsigned, double*,
+                             unsigned, unsigned long);
+extern void UtHGeM_solve_ooc(blcluster*, mblock<double>**, unsigned, double*,
+                             unsigned, unsigned long);
 ////Hequilib.cpp:
 extern void Hcolnrms(unsigned, blcluster*, mblock<double>**, double*);
 extern void Hrownrms(unsigned, blcluster*, mblock<double>**, double*);
@@ -553,17 +683,24 @@ extern void mltaUtHhGeM(float, blcluster*, mblock<float>**, unsigned, float*,
 extern void mltaHeHVec(float, blcluster*, mblock<float>**, float*, float*);
 extern void mltaHeHGeM(float, blcluster*, mblock<float>**, unsigned,
 		       float*, unsigned, float*, unsigned);
+////mltaGeHVec_omp.cpp:
+extern void genBlSeqPart_omp(blcluster*, mblock<float>**, unsigned, BlSeqPart&,
+			     bool sym=false);
+extern bool mltaGeHVec_omp(float, blcluster*, mblock<float>**, float*, float*);
+extern bool mltaGeHVec_omp(float, BlSeqPart&, mblock<float>**, float*, float*);
+extern bool mltaGeHhVec_omp(float, BlSeqPart&, mblock<float>**, float*, float*);
+extern bool mltaHeHVec_omp(float, BlSeqPart&, mblock<float>**, float*, float*);
 ////mltaGehGeH.cpp:
 extern void mltaGeHGeH(float, blcluster*, mblock<float>**, blcluster*, 
 		       mblock<float>**, blcluster*, mblock<float>**, double, unsigned,
-		       contBasis<float>* haar=NULL);
+		       contBasis<float>* haar=NULL, unsigned acc=0);
 extern void mltaGeHGeH_toMbl(float, blcluster*, mblock<float>**, blcluster*,
 			     mblock<float>**, mblock<float>*, double, unsigned,
 			     contBasis<float>* haar=NULL);
 ////mltaGeHhGeH.cpp:
 extern void mltaGeHhGeH(float, blcluster*, mblock<float>**, blcluster*,
 			mblock<float>**, blcluster*, mblock<float>**, double,
-			unsigned, contBasis<float>* haar=NULL);
+			unsigned, contBasis<float>* haar=NULL, unsigned acc=0);
 extern void mltaGeHhGeH_toMbl(float, blcluster*, mblock<float>**, blcluster*,
 			      mblock<float>**, mblock<float>*, double, unsigned);
 extern void mltaGeHhLrM_toMbl(float, blcluster*, mblock<float>**, blcluster*,
@@ -618,7 +755,7 @@ extern void mltDiHGeM(unsigned, mblock<float>**, blcluster*, int* const,
 ////mltaGeHGeHh.cpp:
 extern void mltaGeHGeHh(float, blcluster*, mblock<float>**, blcluster*,
 			mblock<float>**, blcluster*, mblock<float>**,
-			double, unsigned);
+			double, unsigned, unsigned acc=0);
 extern void mltaGeHGeHh_toMbl(float, blcluster*, mblock<float>**,
 			      blcluster*, mblock<float>**, mblock<float>*, 
 			      double, unsigned);
@@ -676,9 +813,10 @@ extern void invertHeH(blcluster*, mblock<float>**, mblock<float>**&,
 		      double, unsigned);
 ////HLU.cpp:
 extern bool HLU(blcluster*, mblock<float>**, mblock<float>**, mblock<float>**,
-                double, unsigned, contBasis<float>* haar=NULL);
+                double, unsigned, contBasis<float>* haar=NULL,
+                unsigned acc=0);
 extern bool HCholesky(blcluster* const, mblock<float>**, double, unsigned, 
-                      contBasis<float>* haar=NULL);
+                      contBasis<float>* haar=NULL, unsigned acc=0);
 extern bool HUhDU(blcluster*, mblock<float>**, int*, double, unsigned);
 extern bool genLUprecond(blcluster*, mblock<double>**, double, unsigned,
                          blcluster*&, mblock<float>**&, mblock<float>**&, bool);
@@ -688,6 +826,12 @@ extern bool genCholprecond(blcluster*, mblock<double>**, double, unsigned,
                            blcluster*&, mblock<float>**&, bool);
 extern bool genCholprecond(blcluster*, mblock<float>**, double, unsigned,
                            blcluster*&, mblock<float>**&, bool);
+extern bool HLU_omp(blcluster* const, mblock<float>** const, mblock<float>** const,
+                    mblock<float>** const, const double, const unsigned,
+                    contBasis<float>* haar=NULL, unsigned acc=0);
+extern bool HCholesky_omp(blcluster* const, mblock<float>** const, const double,
+                          const unsigned, contBasis<float>* haar=NULL,
+                          unsigned acc=0);
 ////TU_solve.cpp:
 extern void LtHGeM_solve(blcluster*, mblock<float>**, unsigned, float*,
 			 unsigned);
@@ -718,6 +862,15 @@ extern void UtHhDdns_solve(blcluster*, mblock<float>**, int*, unsigned,
   mblock<float>** B, mblock<float>**, double, unsigned);
 */
 
+////oocH.cpp:
+extern bool mltaGeHVec_ooc(float, blcluster*, mblock<float>**, float*,
+                           float*, unsigned long);
+extern bool mltaGeHhVec_ooc(float, blcluster*, mblock<float>**, float*,
+                            float*, unsigned long);
+extern void LtHGeM_solve_ooc(blcluster*, mblock<float>**, unsigned, float*,
+                             unsigned, unsigned long);
+extern void UtHGeM_solve_ooc(blcluster*, mblock<float>**, unsigned, float*,
+                             unsigned, unsigned long);
 ////psoutH.cpp:
 extern void psoutputGeH(std::ofstream&, blcluster*, unsigned, mblock<float>**);
 extern void psoutputGeH(std::ofstream&, blcluster**, unsigned, unsigned,
@@ -842,17 +995,24 @@ extern void mltaSyHVec(dcomp, blcluster*, mblock<dcomp>**, dcomp*, dcomp*);
 extern void mltaSyHGeM(scomp, blcluster*, mblock<scomp>**, unsigned,
 		       scomp*, unsigned, scomp*, unsigned);
 extern void mltaSyHhVec(dcomp, blcluster*, mblock<dcomp>**, dcomp*, dcomp*);
+////mltaGeHVec_omp.cpp:
+extern void genBlSeqPart_omp(blcluster*, mblock<scomp>**, unsigned, BlSeqPart&,
+			     bool sym=false);
+extern bool mltaGeHVec_omp(scomp, blcluster*, mblock<scomp>**, scomp*, scomp*);
+extern bool mltaGeHVec_omp(scomp, BlSeqPart&, mblock<scomp>**, scomp*, scomp*);
+extern bool mltaGeHhVec_omp(scomp, BlSeqPart&, mblock<scomp>**, scomp*, scomp*);
+extern bool mltaHeHVec_omp(scomp, BlSeqPart&, mblock<scomp>**, scomp*, scomp*);
 ////mltaGeHGeH.cpp:
 extern void mltaGeHGeH(scomp, blcluster*, mblock<scomp>**, blcluster*, mblock<scomp>**,
 		       blcluster*, mblock<scomp>**, double, unsigned, 
-		       contBasis<scomp>* haar=NULL);
+		       contBasis<scomp>* haar=NULL, unsigned acc=0);
 extern void mltaGeHGeH_toMbl(scomp, blcluster*, mblock<scomp>**, blcluster*,
 			     mblock<scomp>**, mblock<scomp>*, double, unsigned,
 			     contBasis<scomp>* haar=NULL);
 ////mltaGeHhGeH.cpp:
 extern void mltaGeHhGeH(scomp, blcluster*, mblock<scomp>**, blcluster*, mblock<scomp>**,
 			blcluster*, mblock<scomp>**, double, unsigned, 
-			contBasis<scomp>* haar=NULL);
+			contBasis<scomp>* haar=NULL, unsigned acc=0);
 extern void mltaGeHhGeH_toMbl(scomp, blcluster*, mblock<scomp>**,
 			      blcluster*, mblock<scomp>**, mblock<scomp>*, double, 
 			      unsigned);
@@ -908,7 +1068,7 @@ extern void mltDiHGeM(unsigned, mblock<scomp>**, blcluster*, int* const ,
 ////mltaGeHGeHh.cpp:
 extern void mltaGeHGeHh(scomp, blcluster*, mblock<scomp>**, blcluster*,
 			mblock<scomp>**, blcluster*, mblock<scomp>**,
-			double, unsigned);
+			double, unsigned, unsigned acc=0);
 extern void mltaGeHGeHh_toMbl(scomp, blcluster*, mblock<scomp>**,
 			      blcluster*, mblock<scomp>**, mblock<scomp>*, 
 			      double, unsigned);
@@ -965,14 +1125,20 @@ extern void invertHeH(blcluster*, mblock<scomp>**, mblock<scomp>**&,
 		      scomp, unsigned);
 ////HLU.cpp:
 extern bool HLU(blcluster*, mblock<scomp>**, mblock<scomp>**, mblock<scomp>**, double,
-		unsigned, contBasis<scomp>* haar=NULL);
+		unsigned, contBasis<scomp>* haar=NULL, unsigned acc=0);
 extern bool HCholesky(blcluster* const, mblock<scomp>** const, double, unsigned, 
-                      contBasis<scomp>* haar=NULL);
+                      contBasis<scomp>* haar=NULL, unsigned acc=0);
 extern bool HUhDU(blcluster*, mblock<scomp>**, int*, double, unsigned);
 extern bool genLUprecond(blcluster*, mblock<dcomp>**, double, unsigned,
                          blcluster*&, mblock<scomp>**&, mblock<scomp>**&, bool);
 extern bool genCholprecond(blcluster*, mblock<scomp>**, scomp, unsigned,
                            blcluster*&, mblock<scomp>**&, bool);
+extern bool HLU_omp(blcluster* const, mblock<scomp>** const, mblock<scomp>** const,
+                    mblock<scomp>** const, const double, const unsigned,
+                    contBasis<scomp>* haar=NULL, unsigned acc=0);
+extern bool HCholesky_omp(blcluster* const, mblock<scomp>** const, const double,
+                          const unsigned, contBasis<scomp>* haar=NULL,
+                          unsigned acc=0);
 ////TU_solve.cpp:
 extern void LtHGeM_solve(blcluster*, mblock<scomp>**, unsigned, scomp*,
                          unsigned);
@@ -1004,6 +1170,15 @@ extern void UtHhDdns_solve(blcluster*, mblock<scomp>**, int*, unsigned,
   mblock<scomp>** B, mblock<scomp>**, double, unsigned);
 */
 
+////oocH.cpp:
+extern bool mltaGeHVec_ooc(scomp, blcluster*, mblock<scomp>**, scomp*,
+                           scomp*, unsigned long);
+extern bool mltaGeHhVec_ooc(scomp, blcluster*, mblock<scomp>**, scomp*,
+                            scomp*, unsigned long);
+extern void LtHGeM_solve_ooc(blcluster*, mblock<scomp>**, unsigned, scomp*,
+                             unsigned, unsigned long);
+extern void UtHGeM_solve_ooc(blcluster*, mblock<scomp>**, unsigned, scomp*,
+                             unsigned, unsigned long);
 ////psoutH.cpp:
 extern void psoutputGeH(std::ofstream&, blcluster*, unsigned, mblock<scomp>**);
 extern void psoutputGeH(std::ofstream&, blcluster**, unsigned, unsigned,
@@ -1127,17 +1302,24 @@ extern void mltaSyHVec(dcomp, blcluster*, mblock<dcomp>**, dcomp*, dcomp*);
 extern void mltaSyHGeM(dcomp, blcluster*, mblock<dcomp>**, unsigned,
 		       dcomp*, unsigned, dcomp*, unsigned);
 extern void mltaSyHhVec(dcomp, blcluster*, mblock<dcomp>**, dcomp*, dcomp*);
+////mltaGeHVec_omp.cpp:
+extern void genBlSeqPart_omp(blcluster*, mblock<dcomp>**, unsigned, BlSeqPart&,
+			     bool sym=false);
+extern bool mltaGeHVec_omp(dcomp, blcluster*, mblock<dcomp>**, dcomp*, dcomp*);
+extern bool mltaGeHVec_omp(dcomp, BlSeqPart&, mblock<dcomp>**, dcomp*, dcomp*);
+extern bool mltaGeHhVec_omp(dcomp, BlSeqPart&, mblock<dcomp>**, dcomp*, dcomp*);
+extern bool mltaHeHVec_omp(dcomp, BlSeqPart&, mblock<dcomp>**, dcomp*, dcomp*);
 ////mltaGeHGeH.cpp:
 extern void mltaGeHGeH(dcomp, blcluster*, mblock<dcomp>**, blcluster*,
 		       mblock<dcomp>**, blcluster*, mblock<dcomp>**, double,
-		       unsigned, contBasis<dcomp>* haar=NULL);
+		       unsigned, contBasis<dcomp>* haar=NULL, unsigned acc=0);
 extern void mltaGeHGeH_toMbl(dcomp, blcluster*, mblock<dcomp>**, blcluster*,
 			     mblock<dcomp>**, mblock<dcomp>*, double, unsigned,
 			     contBasis<dcomp>* haar=NULL);
 ////mltaGeHhGeH.cpp:
 extern void mltaGeHhGeH(dcomp, blcluster*, mblock<dcomp>**, blcluster*, mblock<dcomp>**,
 			blcluster*, mblock<dcomp>**, double, unsigned, 
-			contBasis<dcomp>* haar=NULL);
+			contBasis<dcomp>* haar=NULL, unsigned acc=0);
 extern void mltaGeHhGeH_toMbl(dcomp, blcluster*, mblock<dcomp>**,
 			      blcluster*, mblock<dcomp>**, mblock<dcomp>*, 
 			      double, unsigned);
@@ -1193,7 +1375,7 @@ extern void mltaGeHhDiHGeH_toHeH(dcomp, blcluster*, mblock<dcomp>**, blcluster*,
 ////mltaGeHGeHh.cpp:
 extern void mltaGeHGeHh(dcomp, blcluster*, mblock<dcomp>**, blcluster*,
 			mblock<dcomp>**, blcluster*, mblock<dcomp>**,
-			double, unsigned);
+			double, unsigned, unsigned acc=0);
 extern void mltaGeHGeHh_toMbl(dcomp, blcluster*, mblock<dcomp>**,
 			      blcluster*, mblock<dcomp>**, mblock<dcomp>*, double, 
 			      unsigned);
@@ -1249,14 +1431,21 @@ extern void invertHeH(blcluster*, mblock<dcomp>**, mblock<dcomp>**&,
 		      dcomp, unsigned);
 ////HLU.cpp:
 extern bool HLU(blcluster*, mblock<dcomp>**, mblock<dcomp>**, mblock<dcomp>**,
-                double, unsigned, contBasis<dcomp>* haar=NULL);
+                double, unsigned, contBasis<dcomp>* haar=NULL,
+                unsigned acc=0);
 extern bool HCholesky(blcluster* const, mblock<dcomp>** const, double, unsigned, 
-                      contBasis<dcomp>* haar=NULL);
+                      contBasis<dcomp>* haar=NULL, unsigned acc=0);
 extern bool HUhDU(blcluster*, mblock<dcomp>**, int*, double, unsigned);
 extern bool genLUprecond(blcluster*, mblock<dcomp>**, double, unsigned,
                          blcluster*&, mblock<dcomp>**&, mblock<dcomp>**&, bool);
 extern bool genCholprecond(blcluster*, mblock<dcomp>**, dcomp, unsigned,
                            blcluster*&, mblock<dcomp>**&, bool);
+extern bool HLU_omp(blcluster* const, mblock<dcomp>** const, mblock<dcomp>** const,
+                    mblock<dcomp>** const, const double, const unsigned,
+                    contBasis<dcomp>* haar=NULL, unsigned acc=0);
+extern bool HCholesky_omp(blcluster* const, mblock<dcomp>** const, const double,
+                          const unsigned, contBasis<dcomp>* haar=NULL,
+                          unsigned acc=0);
 ////TU_solve.cpp:
 extern void LtHGeM_solve(blcluster*, mblock<dcomp>**, unsigned, dcomp*,
                          unsigned);
@@ -1288,6 +1477,15 @@ extern void UtHhDdns_solve(blcluster*, mblock<dcomp>**, int*, unsigned,
   extern void HLtHh_solve(blcluster*, mblock<dcomp>**, blcluster*,
   mblock<dcomp>** B, mblock<dcomp>**, double, unsigned);
 */
+////oocH.cpp:
+extern bool mltaGeHVec_ooc(dcomp, blcluster*, mblock<dcomp>**, dcomp*,
+                           dcomp*, unsigned long);
+extern bool mltaGeHhVec_ooc(dcomp, blcluster*, mblock<dcomp>**, dcomp*,
+                            dcomp*, unsigned long);
+extern void LtHGeM_solve_ooc(blcluster*, mblock<dcomp>**, unsigned, dcomp*,
+                             unsigned, unsigned long);
+extern void UtHGeM_solve_ooc(blcluster*, mblock<dcomp>**, unsigned, dcomp*,
+                             unsigned, unsigned long);
 ////psoutH.cpp:
 extern void psoutputGeH(std::ofstream&, blcluster*, unsigned, mblock<dcomp>**);
 extern void psoutputGeH(std::ofstream&, blcluster**, unsigned, unsigned,
@@ -1388,6 +1586,35 @@ inline void HLU_solve(blcluster* bl, mblock<T>** L, mblock<T>** U, T* b)
   UtHVec_solve(bl, U, b);    // Backward substitution
 }
 
+// solve L x = b for x, forward substitution, b is destroyed; the blocks of
+// L are streamed from a mapped file with at most budget bytes resident
+// (see LtHGeM_solve_ooc)
+template<class T>
+inline void LtHVec_solve(blcluster* blL, mblock<T>** L, T* b,
+                         unsigned long budget)
+{
+  LtHGeM_solve_ooc(blL, L, 1, b, blL->getn1(), budget);
+}
+
+// solve U x = b for x, backward substitution, b is destroyed; the blocks of
+// U are streamed from a mapped file (see UtHGeM_solve_ooc)
+template<class T>
+inline void UtHVec_solve(blcluster* blU, mblock<T>** U, T* b,
+                         unsigned long budget)
+{
+  UtHGeM_solve_ooc(blU, U, 1, b, blU->getn1(), budget);
+}
+
+// solve L U x = b for x and store x in b; the factors are mapped from files
+// (see mapmbls) and are streamed through memory, budget bytes at a time
+template<class T>
+inline void HLU_solve(blcluster* bl, mblock<T>** L, mblock<T>** U, T* b,
+                      unsigned long budget)
+{
+  LtHVec_solve(bl, L, b, budget);    // Forward substitution
+  UtHVec_solve(bl, U, b, budget);    // Backward substitution
+}
+
 // solve (L U)^H x = b for x and store x in b
 template<class T>
 inline void HLUh_solve(blcluster* bl, mblock<T>** L, mblock<T>** U, T* b)
@@ -1397,4 +1624,12 @@ inline void HLUh_solve(blcluster* bl, mblock<T>** L, mblock<T>** U, T* b)
 }
 
 
+// as initGeH_0, the storage of the blocks is taken from the arena ar
+template<class T> void initGeH_0(blcluster* bl, mblock<T>** &A,
+                                 mblockArena<T>& ar)
+{
+  initGeH_0(bl, A);
+  packmbls(bl, A, ar);
+}
+
 #endif
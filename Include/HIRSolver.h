@@ -0,0 +1,223 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#ifndef HIRSOLVER_H
+#define HIRSOLVER_H
+
+#include <cmath>
+#include "matrix.h"
+#include "solvers.h"
+#include "HSolvePlan.h"
+
+//! mixed precision solver for A x = b with an H-matrix A in precision T
+//! (double or dcomp) by iterative refinement, i.e. GMRES-IR (E. Carson,
+//! N.J. Higham, SIAM J. Sci. Comput. 40, 2018) or CG-IR if A is hermitian.
+//! A is factorized (HLU or HCholesky) with accuracy delta in the low
+//! precision S (float or scomp), which halves the storage of the factors
+//! and roughly the time of the factorization. The residual of each
+//! refinement step is computed in precision T with A itself, the correction
+//! equation is solved by GMRes (PipeCG if A is hermitian) preconditioned
+//! with the factors. If a refinement step reduces the residual by less than
+//! a factor 2 or if the factorization fails, A is factorized with higher
+//! accuracy: delta is decreased by a factor 10 as long as it is larger
+//! than the unit roundoff of S allows, then A is factorized in precision T.
+//! The accuracy reached is kept for subsequent solves.
+//! If A is hermitian, only its upper part is stored (see HeHMatrix).
+//!
+//!   HIRSolver<double, float> IR(bl, A, false, 1e-2, 100);
+//!   IR.factorize();
+//!   IR.solve(b, x, eps, nsteps);
+template<class T, class S> class HIRSolver : public Matrix<T>
+{
+  blcluster* bl;
+  mblock<T>** A;
+  bool herm;
+  double delta;                 // accuracy of the factorization
+  unsigned rankmax;
+  bool lowp;                    // are the factors stored in precision S?
+
+  mblock<S> **LS, **US;
+  mblock<T> **LT, **UT;
+  HSolvePlan<S> PfS, PbS;       // forward and backward substitution
+  HSolvePlan<T> PfT, PbT;
+  S* xs;
+
+  HIRSolver(const HIRSolver&);
+  HIRSolver& operator=(const HIRSolver&);
+
+  void clear_() {
+    PfS.clear();
+    PbS.clear();
+    PfT.clear();
+    PbT.clear();
+    freembls(bl, LS);
+    freembls(bl, US);
+    freembls(bl, LT);
+    freembls(bl, UT);
+  }
+
+  template<class R>
+  bool factor_(mblock<R>** &L, mblock<R>** &U, HSolvePlan<R>& Pf,
+               HSolvePlan<R>& Pb) {
+    allocmbls(bl, U);
+    if (herm) {
+      copyH(bl, A, U);
+      if (!HCholesky(bl, U, delta, rankmax)) return false;
+      Pf.init(bl, U, 'u');
+    } else {
+      mblock<R>** B;
+      allocmbls(bl, B);
+      copyH(bl, A, B);
+      allocmbls(bl, L);
+      initLtH_0(bl, L);
+      initUtH_0(bl, U);
+      const bool inf = HLU(bl, B, L, U, delta, rankmax);
+      freembls(bl, B);
+      if (!inf) return false;
+      Pf.init(bl, L, 'L');
+    }
+    Pb.init(bl, U, 'U');
+    return true;
+  }
+
+  // next accuracy of the factorization, false if there is none
+  bool escalate_() {
+    if (lowp && delta>1e-5) delta *= 0.1;
+    else if (lowp) lowp = false;
+    else if (delta>1e-14) delta *= 0.1;
+    else return false;
+
+#ifndef NDEBUG
+    std::cout << "HIRSolver: delta=" << delta << (lowp ? ", low" : ", full")
+              << " precision" << std::endl;
+#endif
+    return true;
+  }
+
+public:
+  HIRSolver(blcluster* tree, mblock<T>** blcks, bool hermitian,
+            double eps, unsigned rmax) :
+    Matrix<T>(tree->getn1(), tree->getn1()), bl(tree), A(blcks),
+    herm(hermitian), delta(eps), rankmax(rmax), lowp(true),
+    LS(NULL), US(NULL), LT(NULL), UT(NULL) {
+    xs = new S[Matrix<T>::n];
+    assert(xs!=NULL);
+  }
+
+  ~HIRSolver() {
+    clear_();
+    delete [] xs;
+  }
+
+  //! factorizes A with the current accuracy, which is increased until the
+  //! factorization succeeds; returns false if it fails in precision T with
+  //! delta=1e-14
+  bool factorize() {
+    for (;;) {
+      clear_();
+      const bool inf = lowp ? factor_(LS, US, PfS, PbS)
+                            : factor_(LT, UT, PfT, PbT);
+      if (inf) return true;
+      if (!escalate_()) {
+        clear_();
+        return false;
+      }
+    }
+  }
+
+  bool lowprec() const { return lowp; }
+  double accuracy() const { return delta; }
+
+  void amux(T d, T* x, T* y) const {
+    if (herm) mltaHeHVec(d, bl, A, x, y);
+    else mltaGeHVec(d, bl, A, x, y);
+  }
+
+  // x = (LU)^{-1} x
+  void precond_apply(T* x) const {
+    if (lowp) {
+      blas::copy(Matrix<T>::n, x, xs);
+      PfS.solve(xs);
+      PbS.solve(xs);
+      blas::copy(Matrix<T>::n, xs, x);
+    } else {
+      PfT.solve(x);
+      PbT.solve(x);
+    }
+  }
+
+  //! solves A x = b by iterative refinement, x contains the initial guess.
+  //! The correction equations are solved with at most m steps each.
+  //! The return value indicates convergence within nsteps (input) inner
+  //! iterations (0), or no convergence (1). On return, nsteps is the
+  //! number of inner iterations and eps the residual |b-Ax|/|b|.
+  unsigned solve(T* const b, T* const x, double& eps, unsigned& nsteps,
+                 const unsigned m=30) {
+    assert(!PbS.empty() || !PbT.empty());
+    const unsigned N = Matrix<T>::n;
+    const double normb = blas::nrm2(N, b);
+    if (normb==0.0) {
+      blas::setzero(N, x);
+      eps = 0.0;
+      nsteps = 0;
+      return 0;
+    }
+
+    T *r = new T[2*N], *d = r + N;
+    assert(r!=NULL);
+
+    // r = b - Ax
+    blas::copy(N, b, r);
+    amux((T) -1.0, x, r);
+    double resid = blas::nrm2(N, r)/normb;
+
+    unsigned l = 0;
+    while (resid>eps && l<nsteps) {
+
+      // A d = r up to the accuracy needed to reach eps, but not more
+      // accurately than a relative residual of 1e-4; the refinement steps
+      // take care of the rest
+      double e = MAX(0.5*eps/resid, 1e-4);
+      unsigned ns = MIN(m, nsteps-l);
+      blas::setzero(N, d);
+      if (herm) PipeCG(*this, r, d, e, ns);
+      else GMRes(*this, r, d, e, m, ns);
+      l += ns;
+
+      blas::add(N, d, x);
+      blas::copy(N, b, r);
+      amux((T) -1.0, x, r);
+      const double resid1 = blas::nrm2(N, r)/normb;
+
+#ifndef NDEBUG
+      std::cout << "Step " << l << ", resid=" << resid1 << std::endl;
+#endif
+
+      if (resid1>0.5*resid && resid1>eps) {
+        if (resid1>resid) {
+          // reject the correction
+          blas::axpy(N, (T) -1.0, d, x);
+          blas::copy(N, b, r);
+          amux((T) -1.0, x, r);
+        } else resid = resid1;
+        if (!escalate_() || !factorize()) break;
+      } else resid = resid1;
+    }
+
+    delete [] r;
+    const unsigned ret = (resid<=eps) ? 0 : 1;
+    eps = resid;
+    nsteps = l;
+    return ret;
+  }
+};
+
+#endif
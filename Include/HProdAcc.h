@@ -0,0 +1,221 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#ifndef HPRODACC_H
+#define HPRODACC_H
+
+#include <vector>
+#include "blas.h"
+#include "mblock.h"
+#include "ACA.h"
+
+//! sum S of the products of the leaves of two H-matrices which contribute
+//! to a low-rank block C of size n1 x n2 (see mltaGeHGeH_toAcc_).
+//! Each product is stored for its sub-block of C without padding and
+//! without truncation. flush adds S to C at once; instead of the QR
+//! decompositions of the padded factors of all contributions, which cost
+//! O((n1+n2) K^2) with the sum K of their ranks, S is compressed by a
+//! randomized SVD (N. Halko, P.G. Martinsson, J.A. Tropp, SIAM Rev. 53,
+//! 2011), which needs only the products of S and S^H with l random vectors,
+//! i.e. O(sum (m_i+n_i) k_i l) operations for the sub-blocks m_i x n_i.
+template<class T> class HProdAcc
+{
+  struct term {
+    unsigned i0, j0, m, n, k;   // sub-block of C and rank
+    T *U, *V;                   // m x k and n x k, V==NULL if U is dense
+  };
+
+  unsigned n1, n2, K;
+  std::vector<term> terms;
+
+  HProdAcc(const HProdAcc&);
+  HProdAcc& operator=(const HProdAcc&);
+
+  // Y += S X with n2 x l matrix X and n1 x l matrix Y, G has size K l
+  void mltaGeM_(unsigned l, T* X, T* Y, T* G) const {
+    for (unsigned t=0; t<terms.size(); ++t) {
+      const term& s = terms[t];
+      if (s.V==NULL)
+        blas::gemma(s.m, s.n, l, (T) 1.0, s.U, s.m, X+s.j0, n2, Y+s.i0, n1);
+      else {
+        blas::gemhm(s.n, s.k, l, (T) 1.0, s.V, s.n, X+s.j0, n2, G, s.k);
+        blas::gemma(s.m, s.k, l, (T) 1.0, s.U, s.m, G, s.k, Y+s.i0, n1);
+      }
+    }
+  }
+
+  // Y += S^H X with n1 x l matrix X and n2 x l matrix Y
+  void mltahGeM_(unsigned l, T* X, T* Y, T* G) const {
+    for (unsigned t=0; t<terms.size(); ++t) {
+      const term& s = terms[t];
+      if (s.V==NULL)
+        blas::gemhma(s.m, s.n, l, (T) 1.0, s.U, s.m, X+s.i0, n1, Y+s.j0, n2);
+      else {
+        blas::gemhm(s.m, s.k, l, (T) 1.0, s.U, s.m, X+s.i0, n1, G, s.k);
+        blas::gemma(s.n, s.k, l, (T) 1.0, s.V, s.n, G, s.k, Y+s.j0, n2);
+      }
+    }
+  }
+
+  // adds S to mbl by a randomized SVD with l samples, which are doubled
+  // until the l-th singular value is below eps; returns false if the
+  // sampling does not pay off or LAPACK fails, mbl is not changed then
+  bool flush_rsvd_(mblock<T>* mbl, double eps, unsigned rankmax,
+                   unsigned l) const {
+    typedef typename num_traits<T>::abs_type abs_T;
+
+    const unsigned lmax = MIN(MIN(n1, n2), K);
+    l = MIN(l, lmax);
+    if (2*l>=K) return false;
+
+    unsigned long seed = 1;
+    for (;;) {
+      const unsigned LWORK = 5*(n1+n2+l);
+      T* const Q = new T[(n1+2*n2+K+l+1)*l+LWORK];
+      assert(Q!=NULL);
+      T* const B = Q + n1*l;                   // n2*l
+      T* const Om = B + n2*l;                  // n2*l
+      T* const G = Om + n2*l;                  // K*l
+      T* const VT = G + K*l;                   // l*l
+      T* const tau = VT + l*l;                 // l
+      T* const WORK = tau + l;                 // LWORK
+      abs_T* const S = new abs_T[l];
+
+      // Q = orth(S Om)
+      for (unsigned i=0; i<n2*l; ++i) Om[i] = (T) ACA_randn(seed);
+      blas::setzero(n1*l, Q);
+      mltaGeM_(l, Om, Q, G);
+      bool ok = blas::geqrf(n1, l, Q, tau, LWORK, WORK)==0
+        && blas::orgqr(n1, l, Q, tau, LWORK, WORK)==0;
+
+      // B = S^H Q = P Sigma R^H, hence S = Q B^H = (Q R) Sigma P^H
+      if (ok) {
+        blas::setzero(n2*l, B);
+        mltahGeM_(l, Q, B, G);
+        ok = blas::gesvd(n2, l, B, S, VT, l, LWORK, WORK)==0;
+      }
+
+      if (!ok) {                                  // LAPACK failed
+        delete [] S;
+        delete [] Q;
+        return false;
+      }
+
+      if (l<lmax && S[l-1]>eps*S[0]) {            // more samples are needed
+        delete [] S;
+        delete [] Q;
+        l = MIN(2*l, lmax);
+        if (2*l>=K) return false;
+        continue;
+      }
+
+      unsigned kt = MIN(l, rankmax);
+      while (kt>0 && S[kt-1]<=eps*S[0]) --kt;
+
+      if (kt>0) {
+        T* const W = new T[kt*n1];
+        assert(W!=NULL);
+        blas::gemmh(n1, l, kt, (T) 1.0, Q, n1, VT, l, W, n1);
+        for (unsigned j=0; j<kt; ++j) blas::scal(n1, (T) S[j], W+j*n1);
+        mbl->addLrM(kt, W, n1, B, n2, eps, rankmax);
+        delete [] W;
+      }
+
+      delete [] S;
+      delete [] Q;
+      return true;
+    }
+  }
+
+  // adds S to mbl as a single update of rank K with padded factors;
+  // a dense contribution D is stored as I D^H or D I
+  void flush_pad_(mblock<T>* mbl, double eps, unsigned rankmax) const {
+    T* const U1 = new T[K*(n1+n2)];
+    assert(U1!=NULL);
+    T* const V1 = U1 + K*n1;
+    blas::setzero(K*(n1+n2), U1);
+    unsigned k = 0;
+    for (unsigned t=0; t<terms.size(); ++t) {
+      const term& s = terms[t];
+      T *U = U1+k*n1+s.i0, *V = V1+k*n2+s.j0;
+      if (s.V!=NULL)
+        for (unsigned l=0; l<s.k; ++l) {
+          blas::copy(s.m, s.U+l*s.m, U+l*n1);
+          blas::copy(s.n, s.V+l*s.n, V+l*n2);
+        }
+      else if (s.m<=s.n)
+        for (unsigned l=0; l<s.m; ++l) {
+          U[l+l*n1] = (T) 1.0;
+          for (unsigned j=0; j<s.n; ++j) V[j+l*n2] = conj(s.U[l+j*s.m]);
+        }
+      else
+        for (unsigned l=0; l<s.n; ++l) {
+          blas::copy(s.m, s.U+l*s.m, U+l*n1);
+          V[l+l*n2] = (T) 1.0;
+        }
+      k += s.k;
+    }
+    mbl->addLrM(K, U1, n1, V1, n2, eps, rankmax);
+    delete [] U1;
+  }
+
+public:
+  HProdAcc(unsigned m, unsigned n) : n1(m), n2(n), K(0) { }
+  ~HProdAcc() { clear(); }
+
+  void clear() {
+    for (unsigned t=0; t<terms.size(); ++t) delete [] terms[t].U;
+    terms.clear();
+    K = 0;
+  }
+
+  bool empty() const { return K==0; }
+
+  //! adds U V^H to the m x n sub-block at (i0,j0)
+  void addLrM(unsigned i0, unsigned j0, unsigned m, unsigned n, unsigned k,
+              T* U, unsigned ldU, T* V, unsigned ldV) {
+    assert(i0+m<=n1 && j0+n<=n2);
+    if (k==0) return;
+    term s = { i0, j0, m, n, k, new T[k*(m+n)], NULL };
+    assert(s.U!=NULL);
+    s.V = s.U + k*m;
+    for (unsigned l=0; l<k; ++l) {
+      blas::copy(m, U+l*ldU, s.U+l*m);
+      blas::copy(n, V+l*ldV, s.V+l*n);
+    }
+    terms.push_back(s);
+    K += k;
+  }
+
+  //! adds the dense m x n matrix D to the sub-block at (i0,j0)
+  void addGeM(unsigned i0, unsigned j0, unsigned m, unsigned n, T* D,
+              unsigned ldD) {
+    assert(i0+m<=n1 && j0+n<=n2);
+    if (m==0 || n==0) return;
+    term s = { i0, j0, m, n, MIN(m, n), new T[m*n], NULL };
+    assert(s.U!=NULL);
+    for (unsigned j=0; j<n; ++j) blas::copy(m, D+j*ldD, s.U+j*m);
+    terms.push_back(s);
+    K += s.k;
+  }
+
+  //! adds the sum to the low-rank block mbl of size n1 x n2 (accuracy eps,
+  //! rank at most rankmax) and clears it; the randomized SVD is used if K
+  //! is large enough compared with the rank of the sum
+  void flush(mblock<T>* mbl, double eps, unsigned rankmax) {
+    assert(mbl->getn1()==n1 && mbl->getn2()==n2);
+    if (K>0 && !flush_rsvd_(mbl, eps, rankmax, mbl->rank()+8))
+      flush_pad_(mbl, eps, rankmax);
+    clear();
+  }
+};
+
+#endif
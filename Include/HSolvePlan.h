@@ -0,0 +1,277 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#ifndef HSOLVEPLAN_H
+#define HSOLVEPLAN_H
+
+#include <vector>
+#include <algorithm>
+#include "mblock.h"
+#include "blcluster.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//! precomputed schedule of the forward or backward substitution with a
+//! triangular H-matrix for repeated solves, e.g. in preconditioners.
+//! The operations of LtHGeM_solve, LtHhGeM_solve, UtHGeM_solve and
+//! UtHhGeM_solve are generated on the leaves in the same order. Each
+//! operation depends on the last preceding operation writing a part of x
+//! it reads or writes and on the preceding operations reading a part it
+//! writes, where the parts are the index sets of the diagonal leaves.
+//! Independent operations are executed concurrently as OpenMP tasks, the
+//! operations on each part of x in the sequential order, so that the
+//! result does not depend on the number of threads. Leaves of rank zero
+//! and missing leaves (NULL) are omitted, hence e.g. the domains of a
+//! matrix in nested dissection ordering are solved concurrently.
+//! Since the plan refers to the blocks, it has to be regenerated (init)
+//! whenever the factor is changed.
+//!
+//!   HSolvePlan<double> PL, PU;
+//!   PL.init(bl, L, 'L');
+//!   PU.init(bl, U, 'U');
+//!   PL.solve(b); PU.solve(b);      // as HLU_solve(bl, L, U, b)
+template<class T> class HSolvePlan
+{
+  struct op {
+    mblock<T>* mbl;
+    unsigned bx, by;            // offsets of the parts of x read and written
+    char kind;                  // 'L','l','U','u' solve with the diagonal
+                                // leaf, 'A' y -= A x, 'H' y -= A^H x
+  };
+
+  unsigned nops;
+  op* ops;
+  unsigned *npred, *isucc, *succ;     // successors in CSR format
+
+  // parts of x are the index sets of the diagonal leaves, starting at beg
+  std::vector<unsigned> beg;
+
+  HSolvePlan(const HSolvePlan&);
+  HSolvePlan& operator=(const HSolvePlan&);
+
+  // the parts [first,last] which intersect [b,b+n)
+  void parts_(unsigned b, unsigned n, unsigned& first, unsigned& last) const {
+    first = (unsigned) (std::upper_bound(beg.begin(), beg.end(), b)
+                        - beg.begin()) - 1;
+    last = (unsigned) (std::upper_bound(beg.begin(), beg.end(), b+n-1)
+                       - beg.begin()) - 1;
+  }
+
+  void addLeaves_(blcluster* bl, mblock<T>** A, char kind, unsigned b0,
+                  std::vector<op>& seq) {
+    if (bl==NULL) return;
+    if (bl->isleaf()) {
+      mblock<T>* mbl = A[bl->getidx()];
+      if (mbl==NULL || (mbl->isLrM() && mbl->rank()==0)) return;
+      op o;
+      o.mbl = mbl;
+      o.kind = kind;
+      if (kind=='H') {
+        o.bx = bl->getb1()-b0;
+        o.by = bl->getb2()-b0;
+      } else {
+        o.bx = bl->getb2()-b0;
+        o.by = bl->getb1()-b0;
+      }
+      seq.push_back(o);
+    } else {
+      for (unsigned i=0; i<bl->getnrs(); ++i)
+        for (unsigned j=0; j<bl->getncs(); ++j)
+          addLeaves_(bl->getson(i, j), A, kind, b0, seq);
+    }
+  }
+
+  // the operations of the substitution in the sequential order
+  void genSeq_(blcluster* bl, mblock<T>** A, char type, unsigned b0,
+               std::vector<op>& seq) {
+    if (bl->isleaf()) {
+      op o;
+      o.mbl = A[bl->getidx()];
+      o.bx = o.by = bl->getb1()-b0;
+      o.kind = type;
+      seq.push_back(o);
+      beg.push_back(bl->getb1()-b0);
+      return;
+    }
+
+    const unsigned ns = bl->getnrs();
+    const bool fwd = (type=='L' || type=='u');
+    for (unsigned l=0; l<ns; ++l) {
+      const unsigned i = fwd ? l : ns-1-l;
+      if (fwd)
+        for (unsigned k=0; k<i; ++k) {
+          if (type=='L') addLeaves_(bl->getson(i, k), A, 'A', b0, seq);
+          else addLeaves_(bl->getson(k, i), A, 'H', b0, seq);
+        }
+      else
+        for (unsigned k=i+1; k<ns; ++k) {
+          if (type=='U') addLeaves_(bl->getson(i, k), A, 'A', b0, seq);
+          else addLeaves_(bl->getson(k, i), A, 'H', b0, seq);
+        }
+      genSeq_(bl->getson(i, i), A, type, b0, seq);
+    }
+  }
+
+  unsigned nx_(const op& o) const {
+    return (o.kind=='A') ? o.mbl->getn2() : o.mbl->getn1();
+  }
+  unsigned ny_(const op& o) const {
+    return (o.kind=='H') ? o.mbl->getn2() : o.mbl->getn1();
+  }
+
+  void exec_(const op& o, T* x) const {
+    const unsigned n = o.mbl->getn1();
+    switch (o.kind) {
+    case 'L': o.mbl->ltr_solve(1, x+o.by, n); break;
+    case 'l': o.mbl->ltrh_solve(1, x+o.by, n); break;
+    case 'U': o.mbl->utr_solve(1, x+o.by, n); break;
+    case 'u': o.mbl->utrh_solve(1, x+o.by, n); break;
+    case 'A': o.mbl->mltaVec((T) -1.0, x+o.bx, x+o.by); break;
+    default: o.mbl->mltahVec((T) -1.0, x+o.bx, x+o.by);
+    }
+  }
+
+  // executes operation i and the operations which become ready; one of
+  // them is continued in this task, the others are new tasks
+  void run_(unsigned i, T* x, unsigned* cnt) const {
+    while (i<nops) {
+      exec_(ops[i], x);
+      unsigned next = nops;
+      for (unsigned k=isucc[i]; k<isucc[i+1]; ++k) {
+        const unsigned s = succ[k];
+        unsigned c;
+#pragma omp atomic capture
+        c = --cnt[s];
+        if (c==0) {
+          if (next==nops) next = s;
+          else {
+#pragma omp task firstprivate(s)
+            run_(s, x, cnt);
+          }
+        }
+      }
+      i = next;
+    }
+  }
+
+public:
+  HSolvePlan() : nops(0), ops(NULL), npred(NULL), isucc(NULL), succ(NULL) { }
+  ~HSolvePlan() { clear(); }
+
+  void clear() {
+    delete [] ops;
+    delete [] npred;
+    delete [] isucc;
+    delete [] succ;
+    ops = NULL;
+    npred = isucc = succ = NULL;
+    nops = 0;
+    beg.clear();
+  }
+
+  bool empty() const { return ops==NULL; }
+
+  //! generates the plan for the triangular H-matrix A with block cluster
+  //! tree bl; type is 'L' (L x = b), 'l' (L^H x = b), 'U' (U x = b) or
+  //! 'u' (U^H x = b)
+  void init(blcluster* bl, mblock<T>** A, char type) {
+    assert(type=='L' || type=='l' || type=='U' || type=='u');
+    clear();
+
+    std::vector<op> seq;
+    genSeq_(bl, A, type, bl->getb1(), seq);
+    std::sort(beg.begin(), beg.end());
+    nops = seq.size();
+    ops = new op[nops];
+    assert(ops!=NULL);
+    for (unsigned i=0; i<nops; ++i) ops[i] = seq[i];
+
+    // dependencies via the last writer and the readers of each part
+    const unsigned nparts = beg.size();
+    std::vector<unsigned> lastw(nparts, nops), stamp(nops, nops);
+    std::vector<std::vector<unsigned> > readers(nparts);
+    std::vector<unsigned> from, to;
+    for (unsigned i=0; i<nops; ++i) {
+      const op& o = ops[i];
+      unsigned fx, lx, fy, ly, j;
+      parts_(o.by, ny_(o), fy, ly);
+      const bool upd = (o.kind=='A' || o.kind=='H');
+      if (upd) {
+        parts_(o.bx, nx_(o), fx, lx);
+        for (j=fx; j<=lx; ++j)
+          if (lastw[j]<nops && stamp[lastw[j]]!=i) {
+            stamp[lastw[j]] = i;
+            from.push_back(lastw[j]);
+            to.push_back(i);
+          }
+      }
+      for (j=fy; j<=ly; ++j) {
+        if (lastw[j]<nops && stamp[lastw[j]]!=i) {
+          stamp[lastw[j]] = i;
+          from.push_back(lastw[j]);
+          to.push_back(i);
+        }
+        for (unsigned r=0; r<readers[j].size(); ++r)
+          if (stamp[readers[j][r]]!=i) {
+            stamp[readers[j][r]] = i;
+            from.push_back(readers[j][r]);
+            to.push_back(i);
+          }
+        readers[j].clear();
+        lastw[j] = i;
+      }
+      if (upd)
+        for (j=fx; j<=lx; ++j) readers[j].push_back(i);
+    }
+
+    const unsigned nedges = from.size();
+    npred = new unsigned[nops];
+    isucc = new unsigned[nops+1];
+    succ = new unsigned[nedges+1];
+    assert(npred!=NULL && isucc!=NULL && succ!=NULL);
+    for (unsigned i=0; i<=nops; ++i) isucc[i] = 0;
+    for (unsigned i=0; i<nops; ++i) npred[i] = 0;
+    for (unsigned e=0; e<nedges; ++e) {
+      ++isucc[from[e]+1];
+      ++npred[to[e]];
+    }
+    for (unsigned i=0; i<nops; ++i) isucc[i+1] += isucc[i];
+    std::vector<unsigned> pos(isucc, isucc+nops);
+    for (unsigned e=0; e<nedges; ++e) succ[pos[from[e]]++] = to[e];
+  }
+
+  //! solves the triangular system, x contains the right hand side on entry
+  //! and the solution on exit
+  void solve(T* x) const {
+    assert(!empty());
+#ifdef _OPENMP
+    if (omp_get_max_threads()>1 && !omp_in_parallel()) {
+      unsigned* cnt = new unsigned[nops];
+      assert(cnt!=NULL);
+      for (unsigned i=0; i<nops; ++i) cnt[i] = npred[i];
+#pragma omp parallel
+#pragma omp single
+      for (unsigned i=0; i<nops; ++i)
+        if (npred[i]==0) {
+#pragma omp task firstprivate(i)
+          run_(i, x, cnt);
+        }
+      delete [] cnt;
+      return;
+    }
+#endif
+    for (unsigned i=0; i<nops; ++i) exec_(ops[i], x);
+  }
+};
+
+#endif
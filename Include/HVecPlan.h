@@ -0,0 +1,156 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#ifndef HVECPLAN_H
+#define HVECPLAN_H
+
+#include "mblock.h"
+#include "blcluster.h"
+#include "bllist.h"
+#include "lrmvec.h"
+#include "workspace.h"
+
+//! flat sequence of the leaves of an H-matrix for repeated matrix-vector
+//! products without traversing the block cluster tree.
+//! The leaves are stored in the Z-order of gen_BlSequence such that
+//! consecutive leaves share parts of x and y. The plan only stores the
+//! positions of the blocks; their type, rank and entries are read from A at
+//! each product, hence the blocks may be changed (addLrM, setPrec, ...)
+//! after init. The plan has to be regenerated only if the blocks themselves
+//! are replaced or freed. A copy of a plan is empty.
+template<class T> class HVecPlan
+{
+  struct leaf {
+    unsigned b1, b2, n1, n2;    // offsets and sizes of the block
+    unsigned idx;               // index of the block in A
+    bool offdiag;               // off-diagonal block of a hermitian matrix
+  };
+
+  mblock<T>** A;
+  unsigned nlvs, ntmp;          // ntmp bounds the ranks of the leaves
+  leaf* lvs;
+
+  // y += d A x for a single leaf; blocks in reduced precision and packed
+  // blocks are left to the mblock
+  void mltaVec_(const leaf& l, T d, T* x, T* y, T* wk) const {
+    mblock<T>* mbl = A[l.idx];
+    if (mbl->getPrec()!=0) mbl->mltaVec(d, x, y);
+    else if (mbl->isLrM()) {
+      const unsigned k = mbl->rank();
+      T* const data = mbl->getdata();
+      if (k==0) return;
+      if (k<=LRMVEC_KMAX)
+        mltaLrMVec_k(l.n1, l.n2, k, d, data, data+k*l.n1, x, y);
+      else if (k<=ntmp) {
+        blas::setzero(k, wk);
+        blas::gemhva(l.n2, k, (T) 1.0, data+k*l.n1, x, wk);
+        blas::gemva(l.n1, k, d, data, wk, y);
+      } else mbl->mltaVec(d, x, y);
+    } else if (mbl->isHeM() || mbl->isSyM() || mbl->isLtM() || mbl->isUtM())
+      mbl->mltaVec(d, x, y);
+    else blas::gemva(l.n1, l.n2, d, mbl->getdata(), x, y);
+  }
+
+  // y += d A^H x for a single leaf
+  void mltahVec_(const leaf& l, T d, T* x, T* y, T* wk) const {
+    mblock<T>* mbl = A[l.idx];
+    if (mbl->getPrec()!=0) mbl->mltahVec(d, x, y);
+    else if (mbl->isLrM()) {
+      const unsigned k = mbl->rank();
+      T* const data = mbl->getdata();
+      if (k==0) return;
+      if (k<=LRMVEC_KMAX)
+        mltaLrMVec_k(l.n2, l.n1, k, d, data+k*l.n1, data, x, y);
+      else if (k<=ntmp) {
+        blas::setzero(k, wk);
+        blas::gemhva(l.n1, k, (T) 1.0, data, x, wk);
+        blas::gemva(l.n2, k, d, data+k*l.n1, wk, y);
+      } else mbl->mltahVec(d, x, y);
+    } else if (mbl->isHeM() || mbl->isSyM() || mbl->isLtM() || mbl->isUtM())
+      mbl->mltahVec(d, x, y);
+    else blas::gemhva(l.n1, l.n2, d, mbl->getdata(), x, y);
+  }
+
+public:
+  HVecPlan() : A(NULL), nlvs(0), ntmp(0), lvs(NULL) { }
+  HVecPlan(const HVecPlan&) : A(NULL), nlvs(0), ntmp(0), lvs(NULL) { }
+  ~HVecPlan() { clear(); }
+
+  HVecPlan& operator=(const HVecPlan&) {
+    clear();
+    return *this;
+  }
+
+  void clear() {
+    delete [] lvs;
+    lvs = NULL;
+    A = NULL;
+    nlvs = ntmp = 0;
+  }
+
+  bool empty() const { return lvs==NULL; }
+
+  //! generates the plan for the H-matrix A with block cluster tree bl;
+  //! if herm, only the upper triangular part of the hermitian matrix is used
+  void init(blcluster* bl, mblock<T>** blcks, bool herm=false) {
+    clear();
+    A = blcks;
+
+    blcluster** BlList;
+    if (herm) gen_upBlSequence(bl, BlList, nlvs);
+    else {
+      nlvs = bl->nleaves();
+      gen_BlSequence(bl, BlList);
+    }
+
+    lvs = new leaf[nlvs];
+    assert(lvs!=NULL);
+
+    // the rank of a low-rank block does not exceed min(n1,n2)
+    for (unsigned i=0; i<nlvs; ++i) {
+      leaf& l = lvs[i];
+      l.b1 = BlList[i]->getb1();
+      l.b2 = BlList[i]->getb2();
+      l.n1 = BlList[i]->getn1();
+      l.n2 = BlList[i]->getn2();
+      l.idx = BlList[i]->getidx();
+      l.offdiag = herm && BlList[i]->isndbl();
+      ntmp = MAX(ntmp, MIN(l.n1, l.n2));
+    }
+    delete [] BlList;
+  }
+
+  //! y += d A x; the products may be computed concurrently, also in
+  //! nested parallel regions, since the scratch array for the coefficients
+  //! of the low-rank blocks is taken from the calling thread (mblockWork)
+  void amux(T d, T* x, T* y) const {
+    assert(!empty());
+    mblockWork<T> wsp(ntmp);
+    T* const wk = wsp.ptr();
+    for (const leaf* l=lvs; l<lvs+nlvs; ++l) {
+      mltaVec_(*l, d, x+l->b2, y+l->b1, wk);
+      if (l->offdiag) mltahVec_(*l, d, x+l->b1, y+l->b2, wk);
+    }
+  }
+
+  //! y += d A^H x
+  void amuxh(T d, T* x, T* y) const {
+    assert(!empty());
+    mblockWork<T> wsp(ntmp);
+    T* const wk = wsp.ptr();
+    for (const leaf* l=lvs; l<lvs+nlvs; ++l) {
+      mltahVec_(*l, d, x+l->b1, y+l->b2, wk);
+      if (l->offdiag) mltaVec_(*l, d, x+l->b2, y+l->b1, wk);
+    }
+  }
+};
+
+#endif
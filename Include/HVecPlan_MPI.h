@@ -0,0 +1,523 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#ifndef HVECPLAN_MPI_H
+#define HVECPLAN_MPI_H
+
+#include <limits.h>
+#include <algorithm>
+#include "parallel.h"
+
+//! communication plan for matrix-vector products with an H-matrix whose
+//! leaves are distributed over the processors of COMM_AHMED (processor q
+//! holds the blocks of blList[seq_part[q]],...,blList[seq_part[q+1]-1]).
+//! Also the vectors are distributed: processor q holds the entries
+//! ofs[q],...,ofs[q+1]-1. Each processor exchanges only the parts of x and y
+//! touched by its blocks directly with their owners (nonblocking), and
+//! multiplies each block as soon as the parts of x it needs have arrived,
+//! so that the communication overlaps with the computation.
+//! The plan only depends on the block structure; it has to be regenerated
+//! (init) if blList or seq_part change.
+template<class T> class HVecPlan_MPI
+{
+  enum { TAGX = 21, TAGY = 22 };
+
+  struct range {
+    unsigned beg, n;
+  };
+
+  struct blk {
+    mblock<T>** mbl;
+    unsigned x[2], y[2];        // offsets in xbuf and ybuf (second: offdiag)
+    bool offdiag;               // off-diagonal block of a hermitian matrix
+    unsigned nmiss;             // number of processors x is received from
+  };
+
+  unsigned rank, nproc, nblcks;
+  unsigned* ofs;                // distribution of the vectors
+  int *cnts, *displs;           // the same for Scatterv/Gatherv
+  blk* blks;
+
+  // x: parts received from q are stored in xbuf[xin[q]],...,xbuf[xin[q+1]-1]
+  // parts sent to q are the ranges xout[xoutptr[q]],...,xout[xoutptr[q+1]-1]
+  // own parts are copied from the ranges xown[0],...,xown[nxown-1]
+  unsigned *xin, *xoutptr, *xsofs, *xdepptr, *xdep, nxown;
+  range *xout, *xown;
+  T *xbuf, *xsbuf;
+
+  // y: parts sent to q are ybuf[yout[q]],...,ybuf[yout[q+1]-1], parts
+  // received from q are the ranges yin[yinptr[q]],...,yin[yinptr[q+1]-1]
+  unsigned *yout, *yinptr, *yrofs, *ydstptr, *ydst, *ypend0, nyown;
+  range *yin, *yown;
+  T *ybuf, *yrbuf;
+
+  // working arrays of amux
+  unsigned *miss, *ypend;
+  MPI::Request* reqs;
+
+  HVecPlan_MPI(const HVecPlan_MPI&);
+  HVecPlan_MPI& operator=(const HVecPlan_MPI&);
+
+  // the processor holding entry i
+  unsigned owner_(unsigned i) const {
+    return std::upper_bound(ofs, ofs+nproc+1, i) - ofs - 1;
+  }
+
+  // sorts and merges the ranges r, returns their number
+  static unsigned merge_(range* r, unsigned n) {
+    if (n==0) return 0;
+    unsigned long long* key = new unsigned long long[n];
+    assert(key!=NULL);
+    for (unsigned i=0; i<n; ++i)
+      key[i] = ((unsigned long long) r[i].beg<<32) | r[i].n;
+    std::sort(key, key+n);
+    for (unsigned i=0; i<n; ++i) {
+      r[i].beg = (unsigned) (key[i]>>32);
+      r[i].n = (unsigned) key[i];
+    }
+    delete [] key;
+    unsigned m = 0;
+    for (unsigned i=1; i<n; ++i) {
+      if (r[i].beg<=r[m].beg+r[m].n) {
+        const unsigned e = MAX(r[m].beg+r[m].n, r[i].beg+r[i].n);
+        r[m].n = e - r[m].beg;
+      } else r[++m] = r[i];
+    }
+    return m+1;
+  }
+
+  // offset of the range starting at beg in the buffer of the merged ranges r
+  static unsigned bufofs_(const range* r, const unsigned* rofs, unsigned nr,
+                          unsigned beg) {
+    unsigned lo = 0, hi = nr;
+    while (hi-lo>1) {
+      const unsigned mid = (lo+hi)/2;
+      if (r[mid].beg<=beg) lo = mid;
+      else hi = mid;
+    }
+    return rofs[lo] + beg - r[lo].beg;
+  }
+
+  // splits the merged ranges r at the boundaries of the distribution; the
+  // pieces of processor q are piece[ptr[q]],...,piece[ptr[q+1]-1], they are
+  // stored in the buffer at bofs[q],...,bofs[q+1]-1
+  void split_(const range* r, unsigned nr, range*& piece, unsigned*& ptr,
+              unsigned*& bofs) const {
+    unsigned np = 0;
+    for (unsigned k=0; k<nr; ++k)
+      np += owner_(r[k].beg+r[k].n-1) - owner_(r[k].beg) + 1;
+    piece = new range[np];
+    ptr = new unsigned[nproc+1];
+    bofs = new unsigned[nproc+1];
+    assert(piece!=NULL && ptr!=NULL && bofs!=NULL);
+
+    for (unsigned q=0; q<=nproc; ++q) ptr[q] = 0;
+    np = 0;
+    for (unsigned k=0; k<nr; ++k) {
+      const unsigned e = r[k].beg + r[k].n;
+      for (unsigned q=owner_(r[k].beg); q<nproc && ofs[q]<e; ++q) {
+        const unsigned b = MAX(r[k].beg, ofs[q]), f = MIN(e, ofs[q+1]);
+        if (b>=f) continue;
+        piece[np].beg = b;
+        piece[np++].n = f - b;
+        ++ptr[q+1];
+      }
+    }
+    for (unsigned q=0; q<nproc; ++q) ptr[q+1] += ptr[q];
+    bofs[0] = 0;
+    for (unsigned q=0; q<nproc; ++q) {
+      bofs[q+1] = bofs[q];
+      for (unsigned j=ptr[q]; j<ptr[q+1]; ++j) bofs[q+1] += piece[j].n;
+    }
+  }
+
+  // sends the ranges piece[ptr[q]],...,piece[ptr[q+1]-1] to processor q and
+  // receives the ranges requested from this processor (rptr, rpiece); the
+  // own ranges are not exchanged
+  void exchange_(const range* piece, const unsigned* ptr, range*& rpiece,
+                 unsigned*& rptr) const {
+    int *scnt = new int[4*nproc], *rcnt = scnt+nproc, *sdsp = rcnt+nproc,
+      *rdsp = sdsp+nproc;
+    assert(scnt!=NULL);
+    for (unsigned q=0; q<nproc; ++q) {
+      scnt[q] = (q==rank) ? 0 : 2*(ptr[q+1]-ptr[q]);
+      sdsp[q] = 2*ptr[q];
+    }
+    COMM_AHMED.Alltoall(scnt, 1, MPI::INT, rcnt, 1, MPI::INT);
+
+    rptr = new unsigned[nproc+1];
+    assert(rptr!=NULL);
+    rptr[0] = 0;
+    for (unsigned q=0; q<nproc; ++q) {
+      rdsp[q] = 2*rptr[q];
+      rptr[q+1] = rptr[q] + rcnt[q]/2;
+    }
+    rpiece = new range[rptr[nproc]+1];
+    assert(rpiece!=NULL);
+    COMM_AHMED.Alltoallv(piece, scnt, sdsp, MPI::UNSIGNED,
+                         rpiece, rcnt, rdsp, MPI::UNSIGNED);
+    delete [] scnt;
+  }
+
+  // y += d A x for block i, sends the parts of y which are complete
+  void mltaBlk_(unsigned i, T d) {
+    const blk& b = blks[i];
+    (*b.mbl)->mltaVec(d, xbuf+b.x[0], ybuf+b.y[0]);
+    if (b.offdiag) (*b.mbl)->mltahVec(d, xbuf+b.x[1], ybuf+b.y[1]);
+
+    const unsigned L = mpilen((T*) NULL);
+    for (unsigned j=ydstptr[i]; j<ydstptr[i+1]; ++j) {
+      const unsigned q = ydst[j];
+      if (--ypend[q]==0 && q!=rank)
+        reqs[3*nproc+q] = COMM_AHMED.Isend(ybuf+yout[q], L*(yout[q+1]-yout[q]),
+                                           mpitype((T*) NULL), q, TAGY);
+    }
+  }
+
+public:
+  HVecPlan_MPI() : nblcks(0), ofs(NULL), cnts(NULL), displs(NULL), blks(NULL),
+    xin(NULL), xoutptr(NULL), xsofs(NULL), xdepptr(NULL), xdep(NULL),
+    xout(NULL), xown(NULL), xbuf(NULL), xsbuf(NULL), yout(NULL),
+    yinptr(NULL), yrofs(NULL), ydstptr(NULL), ydst(NULL), ypend0(NULL),
+    yin(NULL), yown(NULL), ybuf(NULL), yrbuf(NULL), miss(NULL), ypend(NULL),
+    reqs(NULL) { }
+  ~HVecPlan_MPI() { clear(); }
+
+  void clear() {
+    delete [] ofs; delete [] cnts; delete [] displs; delete [] blks;
+    delete [] xin; delete [] xoutptr; delete [] xsofs; delete [] xdepptr;
+    delete [] xdep; delete [] xout; delete [] xown; delete [] xbuf;
+    delete [] xsbuf; delete [] yout; delete [] yinptr; delete [] yrofs;
+    delete [] ydstptr; delete [] ydst; delete [] ypend0; delete [] yin;
+    delete [] yown; delete [] ybuf; delete [] yrbuf; delete [] miss;
+    delete [] ypend; delete [] reqs;
+    ofs = NULL; cnts = displs = NULL; blks = NULL;
+    xin = xoutptr = xsofs = xdepptr = xdep = NULL; xout = xown = NULL;
+    xbuf = xsbuf = NULL; yout = yinptr = yrofs = ydstptr = ydst = NULL;
+    ypend0 = NULL; yin = yown = NULL; ybuf = yrbuf = NULL;
+    miss = ypend = NULL; reqs = NULL;
+    nblcks = 0;
+  }
+
+  bool empty() const { return ofs==NULL; }
+
+  //! generates the plan for the blocks A of this processor (see above);
+  //! if ofs_==NULL, the vectors are distributed evenly.
+  //! If herm, A is the upper triangular part of a hermitian matrix, i.e.
+  //! the off-diagonal blocks are also applied in transposed form.
+  //! init has to be called by all processors of COMM_AHMED
+  void init(mblock<T>** A, unsigned* seq_part, blcluster** blList,
+            unsigned* ofs_=NULL, bool herm=false) {
+    clear();
+    rank = COMM_AHMED.Get_rank();
+    nproc = COMM_AHMED.Get_size();
+
+    // distribution of the vectors
+    ofs = new unsigned[nproc+1];
+    cnts = new int[nproc];
+    displs = new int[nproc];
+    assert(ofs!=NULL && cnts!=NULL && displs!=NULL);
+    if (ofs_) for (unsigned q=0; q<=nproc; ++q) ofs[q] = ofs_[q];
+    else {
+      unsigned N = 0;
+      for (unsigned i=seq_part[0]; i<seq_part[nproc]; ++i)
+        N = MAX(N, MAX(blList[i]->getb1()+blList[i]->getn1(),
+                       blList[i]->getb2()+blList[i]->getn2()));
+      for (unsigned q=0; q<=nproc; ++q)
+        ofs[q] = (unsigned) (((unsigned long) N*q)/nproc);
+    }
+    const unsigned L = mpilen((T*) NULL);
+    for (unsigned q=0; q<nproc; ++q) {
+      cnts[q] = L*(ofs[q+1]-ofs[q]);
+      displs[q] = L*ofs[q];
+    }
+
+    // the ranges of x and y used by the blocks
+    const unsigned first = seq_part[rank];
+    nblcks = seq_part[rank+1] - first;
+    range *xr = new range[2*nblcks+1], *yr = new range[2*nblcks+1];
+    assert(xr!=NULL && yr!=NULL);
+    unsigned nx = 0, ny = 0;
+    for (unsigned i=0; i<nblcks; ++i) {
+      blcluster* bl = blList[first+i];
+      xr[nx].beg = bl->getb2(); xr[nx++].n = bl->getn2();
+      yr[ny].beg = bl->getb1(); yr[ny++].n = bl->getn1();
+      if (herm && bl->isndbl()) {
+        xr[nx].beg = bl->getb1(); xr[nx++].n = bl->getn1();
+        yr[ny].beg = bl->getb2(); yr[ny++].n = bl->getn2();
+      }
+    }
+    nx = merge_(xr, nx);
+    ny = merge_(yr, ny);
+    unsigned *xrofs = new unsigned[nx+1], *yrofs_ = new unsigned[ny+1];
+    assert(xrofs!=NULL && yrofs_!=NULL);
+    xrofs[0] = yrofs_[0] = 0;
+    for (unsigned k=0; k<nx; ++k) xrofs[k+1] = xrofs[k] + xr[k].n;
+    for (unsigned k=0; k<ny; ++k) yrofs_[k+1] = yrofs_[k] + yr[k].n;
+
+    // the buffer of x (y) is the concatenation of the merged ranges; since
+    // these are sorted, the parts of each processor are contiguous
+    range *xpiece, *ypiece;
+    unsigned *xptr, *yptr;
+    split_(xr, nx, xpiece, xptr, xin);
+    split_(yr, ny, ypiece, yptr, yout);
+    xbuf = new T[xin[nproc]+1];
+    ybuf = new T[yout[nproc]+1];
+    assert(xbuf!=NULL && ybuf!=NULL);
+
+    nxown = xptr[rank+1] - xptr[rank];
+    xown = new range[nxown+1];
+    nyown = yptr[rank+1] - yptr[rank];
+    yown = new range[nyown+1];
+    assert(xown!=NULL && yown!=NULL);
+    for (unsigned j=0; j<nxown; ++j) xown[j] = xpiece[xptr[rank]+j];
+    for (unsigned j=0; j<nyown; ++j) yown[j] = ypiece[yptr[rank]+j];
+
+    // tell the owners which parts are needed and which are sent
+    exchange_(xpiece, xptr, xout, xoutptr);
+    exchange_(ypiece, yptr, yin, yinptr);
+    delete [] xpiece; delete [] xptr;
+    delete [] ypiece; delete [] yptr;
+
+    xsofs = new unsigned[nproc+1];
+    yrofs = new unsigned[nproc+1];
+    assert(xsofs!=NULL && yrofs!=NULL);
+    xsofs[0] = yrofs[0] = 0;
+    for (unsigned q=0; q<nproc; ++q) {
+      xsofs[q+1] = xsofs[q];
+      for (unsigned j=xoutptr[q]; j<xoutptr[q+1]; ++j) xsofs[q+1] += xout[j].n;
+      yrofs[q+1] = yrofs[q];
+      for (unsigned j=yinptr[q]; j<yinptr[q+1]; ++j) yrofs[q+1] += yin[j].n;
+    }
+    xsbuf = new T[xsofs[nproc]+1];
+    yrbuf = new T[yrofs[nproc]+1];
+    assert(xsbuf!=NULL && yrbuf!=NULL);
+
+    // the blocks, the processors their parts of x come from and the
+    // processors their parts of y are sent to
+    blks = new blk[nblcks+1];
+    xdepptr = new unsigned[nproc+1];
+    ydstptr = new unsigned[nblcks+1];
+    ypend0 = new unsigned[nproc];
+    unsigned* stamp = new unsigned[nproc];
+    assert(blks!=NULL && xdepptr!=NULL && ydstptr!=NULL && ypend0!=NULL &&
+           stamp!=NULL);
+    for (unsigned q=0; q<nproc; ++q) {
+      xdepptr[q+1] = ypend0[q] = 0;
+      stamp[q] = UINT_MAX;
+    }
+    xdepptr[0] = ydstptr[0] = 0;
+
+    for (unsigned i=0; i<nblcks; ++i) {
+      blcluster* bl = blList[first+i];
+      blk& b = blks[i];
+      b.mbl = A + i;
+      b.offdiag = herm && bl->isndbl();
+      b.x[0] = bufofs_(xr, xrofs, nx, bl->getb2());
+      b.y[0] = bufofs_(yr, yrofs_, ny, bl->getb1());
+      if (b.offdiag) {
+        b.x[1] = bufofs_(xr, xrofs, nx, bl->getb1());
+        b.y[1] = bufofs_(yr, yrofs_, ny, bl->getb2());
+      }
+
+      b.nmiss = 0;
+      for (unsigned l=0; l<1u+b.offdiag; ++l) {
+        const unsigned beg = (l==0) ? bl->getb2() : bl->getb1();
+        const unsigned n = (l==0) ? bl->getn2() : bl->getn1();
+        for (unsigned q=owner_(beg); q<=owner_(beg+n-1); ++q)
+          if (q!=rank && ofs[q]<ofs[q+1] && stamp[q]!=2*i) {
+            stamp[q] = 2*i;
+            ++b.nmiss;
+            ++xdepptr[q+1];
+          }
+      }
+
+      ydstptr[i+1] = ydstptr[i];
+      for (unsigned l=0; l<1u+b.offdiag; ++l) {
+        const unsigned beg = (l==0) ? bl->getb1() : bl->getb2();
+        const unsigned n = (l==0) ? bl->getn1() : bl->getn2();
+        for (unsigned q=owner_(beg); q<=owner_(beg+n-1); ++q)
+          if (ofs[q]<ofs[q+1] && stamp[q]!=2*i+1) {
+            stamp[q] = 2*i+1;
+            ++ydstptr[i+1];
+            ++ypend0[q];
+          }
+      }
+    }
+    for (unsigned q=0; q<nproc; ++q) xdepptr[q+1] += xdepptr[q];
+
+    xdep = new unsigned[xdepptr[nproc]+1];
+    ydst = new unsigned[ydstptr[nblcks]+1];
+    unsigned* pos = new unsigned[nproc];
+    assert(xdep!=NULL && ydst!=NULL && pos!=NULL);
+    for (unsigned q=0; q<nproc; ++q) {
+      pos[q] = xdepptr[q];
+      stamp[q] = UINT_MAX;
+    }
+    for (unsigned i=0; i<nblcks; ++i) {
+      blcluster* bl = blList[first+i];
+      const bool offdiag = blks[i].offdiag;
+      for (unsigned l=0; l<1u+offdiag; ++l) {
+        const unsigned beg = (l==0) ? bl->getb2() : bl->getb1();
+        const unsigned n = (l==0) ? bl->getn2() : bl->getn1();
+        for (unsigned q=owner_(beg); q<=owner_(beg+n-1); ++q)
+          if (q!=rank && ofs[q]<ofs[q+1] && stamp[q]!=2*i) {
+            stamp[q] = 2*i;
+            xdep[pos[q]++] = i;
+          }
+      }
+      unsigned k = ydstptr[i];
+      for (unsigned l=0; l<1u+offdiag; ++l) {
+        const unsigned beg = (l==0) ? bl->getb1() : bl->getb2();
+        const unsigned n = (l==0) ? bl->getn1() : bl->getn2();
+        for (unsigned q=owner_(beg); q<=owner_(beg+n-1); ++q)
+          if (ofs[q]<ofs[q+1] && stamp[q]!=2*i+1) {
+            stamp[q] = 2*i+1;
+            ydst[k++] = q;
+          }
+      }
+    }
+    delete [] pos;
+    delete [] stamp;
+    delete [] xr; delete [] xrofs;
+    delete [] yr; delete [] yrofs_;
+
+    miss = new unsigned[nblcks+1];
+    ypend = new unsigned[nproc];
+    reqs = new MPI::Request[4*nproc];
+    assert(miss!=NULL && ypend!=NULL && reqs!=NULL);
+  }
+
+  //! the entries of the vectors held by this processor
+  unsigned beg() const { return ofs[rank]; }
+  unsigned nloc() const { return ofs[rank+1]-ofs[rank]; }
+
+  //! y += d A x, where x and y are the parts of the vectors held by this
+  //! processor; has to be called by all processors of COMM_AHMED
+  void amux(T d, T* x, T* y) {
+    assert(!empty());
+    const MPI::Datatype type = mpitype((T*) NULL);
+    const unsigned L = mpilen((T*) NULL);
+    MPI::Request *xr = reqs, *yr = reqs+nproc, *xs = yr+nproc, *ys = xs+nproc;
+    for (unsigned q=0; q<4*nproc; ++q) reqs[q] = MPI::REQUEST_NULL;
+
+    // post the receives first
+    for (unsigned q=0; q<nproc; ++q) {
+      if (q==rank) continue;
+      if (xin[q+1]>xin[q])
+        xr[q] = COMM_AHMED.Irecv(xbuf+xin[q], L*(xin[q+1]-xin[q]), type,
+                                 q, TAGX);
+      if (yrofs[q+1]>yrofs[q])
+        yr[q] = COMM_AHMED.Irecv(yrbuf+yrofs[q], L*(yrofs[q+1]-yrofs[q]),
+                                 type, q, TAGY);
+    }
+
+    // send the parts of x requested by the other processors
+    const unsigned b0 = ofs[rank];
+    for (unsigned q=0; q<nproc; ++q) {
+      if (xsofs[q+1]==xsofs[q]) continue;
+      T* p = xsbuf + xsofs[q];
+      for (unsigned j=xoutptr[q]; j<xoutptr[q+1]; ++j) {
+        blas::copy(xout[j].n, x+xout[j].beg-b0, p);
+        p += xout[j].n;
+      }
+      xs[q] = COMM_AHMED.Isend(xsbuf+xsofs[q], L*(xsofs[q+1]-xsofs[q]), type,
+                               q, TAGX);
+    }
+
+    // own parts of x
+    T* p = xbuf + xin[rank];
+    for (unsigned j=0; j<nxown; ++j) {
+      blas::copy(xown[j].n, x+xown[j].beg-b0, p);
+      p += xown[j].n;
+    }
+    blas::setzero(yout[nproc], ybuf);
+    for (unsigned q=0; q<nproc; ++q) ypend[q] = ypend0[q];
+
+    // blocks which need only local parts of x, then the others as soon
+    // as their parts have arrived
+    for (unsigned i=0; i<nblcks; ++i)
+      if ((miss[i] = blks[i].nmiss)==0) mltaBlk_(i, d);
+
+    int q;
+    while ((q=MPI::Request::Waitany(nproc, xr))!=MPI::UNDEFINED)
+      for (unsigned j=xdepptr[q]; j<xdepptr[q+1]; ++j)
+        if (--miss[xdep[j]]==0) mltaBlk_(xdep[j], d);
+
+    // add the own parts of y and those of the other processors
+    p = ybuf + yout[rank];
+    for (unsigned j=0; j<nyown; ++j) {
+      blas::add(yown[j].n, p, y+yown[j].beg-b0);
+      p += yown[j].n;
+    }
+    while ((q=MPI::Request::Waitany(nproc, yr))!=MPI::UNDEFINED) {
+      p = yrbuf + yrofs[q];
+      for (unsigned j=yinptr[q]; j<yinptr[q+1]; ++j) {
+        blas::add(yin[j].n, p, y+yin[j].beg-b0);
+        p += yin[j].n;
+      }
+    }
+
+    MPI::Request::Waitall(2*nproc, xs);
+  }
+
+  //! distributes the vector x held by processor root
+  void scatter(T* x, T* xloc, unsigned root=0) const {
+    const unsigned L = mpilen((T*) NULL);
+    COMM_AHMED.Scatterv(x, cnts, displs, mpitype((T*) NULL), xloc,
+                        L*nloc(), mpitype((T*) NULL), root);
+  }
+
+  //! collects the distributed vector yloc on processor root
+  void gather(T* yloc, T* y, unsigned root=0) const {
+    const unsigned L = mpilen((T*) NULL);
+    COMM_AHMED.Gatherv(yloc, L*nloc(), mpitype((T*) NULL), y, cnts, displs,
+                       mpitype((T*) NULL), root);
+  }
+};
+
+
+//! H-matrix distributed as in HVecPlan_MPI for the iterative solvers
+//! (PipeCG, PipeGMRes, ...), which then work on the parts of the vectors held
+//! by this processor (n = nloc()). The partial inner products are summed up
+//! by a nonblocking reduction, so that the solvers can overlap it with
+//! products and preconditioning. All processors of COMM_AHMED have to call
+//! the solver. The plan has to be regenerated (genPlan) if A is changed.
+template<class T> struct HMatrix_MPI : public Matrix<T> {
+  mblock<T>** blcks;
+  unsigned* seq_part;
+  blcluster** blList;
+  bool herm;
+  mutable HVecPlan_MPI<T> plan;
+  mutable MPI_Request req;
+
+  HMatrix_MPI(mblock<T>** A, unsigned* part, blcluster** list,
+              bool herm_=false) : Matrix<T>(), blcks(A), seq_part(part),
+    blList(list), herm(herm_), req(MPI_REQUEST_NULL) {
+    genPlan();
+  }
+
+  void genPlan(unsigned* ofs=NULL) {
+    plan.init(blcks, seq_part, blList, ofs, herm);
+    this->m = this->n = plan.nloc();
+  }
+
+  void amux(T d, T* x, T* y) const { plan.amux(d, x, y); }
+
+  void sum_start(unsigned n, T* v) const {
+    MPI_Iallreduce(MPI_IN_PLACE, v, mpilen((T*) NULL)*n,
+                   (MPI_Datatype) mpitype((T*) NULL), MPI_SUM,
+                   (MPI_Comm) COMM_AHMED, &req);
+  }
+  void sum_wait() const { MPI_Wait(&req, MPI_STATUS_IGNORE); }
+};
+
+#endif
@@ -83,6 +83,57 @@ void check_error(MATGEN_T& MatGen, bemblcluster<T1,T2>* bl, double eps,
 #endif
 
 
+// blocks which cannot be approximated by ACA are generated and compressed
+// by the randomized range finder; they are stored dense only if the
+// low-rank representation does not save memory. The ns rows of the block
+// which have been generated by ACA_check (sorted, entries in R) are not
+// generated again.
+template<class T, class MATGEN_T>
+void apprx_rrf(MATGEN_T& MatGen, mblock<T>* mbl, unsigned b1, unsigned n1,
+               unsigned b2, unsigned n2, double eps, unsigned maxk,
+               unsigned ns=0, unsigned* rows=NULL, T* R=NULL)
+{
+  T* A = new T[n1*n2];
+  assert(A!=NULL);
+  if (ns==0) MatGen.cmpbl(b1, n1, b2, n2, A);
+  else {
+    // ranges [lo,hi) of rows between the rows of the check
+    unsigned lmax = 0, lo = 0, s, i, j;
+    for (s=0; s<=ns; ++s) {
+      const unsigned hi = (s<ns) ? rows[s] : n1;
+      if (hi>lo+lmax) lmax = hi-lo;
+      if (s<ns) lo = hi+1;
+    }
+    T* const B = new T[lmax*n2+1];
+    assert(B!=NULL);
+    for (s=0, lo=0; s<=ns; ++s) {
+      const unsigned hi = (s<ns) ? rows[s] : n1;
+      if (hi>lo) {
+        MatGen.cmpbl(b1+lo, hi-lo, b2, n2, B);
+        for (j=0; j<n2; ++j)
+          for (i=lo; i<hi; ++i) A[i+j*n1] = B[i-lo+j*(hi-lo)];
+      }
+      if (s<ns) {
+        for (j=0; j<n2; ++j) A[hi+j*n1] = R[s*n2+j];
+        lo = hi+1;
+      }
+    }
+    delete [] B;
+  }
+
+  unsigned k;
+  T *U, *V;
+  if (RRF(n1, n2, A, eps, maxk, k, U, V, 2654435761ul*b1+b2)
+      && k*(n1+n2)<n1*n2)
+    mbl->cpyLrM_cmpr(k, U, n1, V, n2, eps, k);
+  else
+    mbl->cpyGeM(A);
+
+  delete [] V;
+  delete [] U;
+  delete [] A;
+}
+
 template<class T,class T1, class MATGEN_T>
 void apprx_sym(MATGEN_T& MatGen, mblock<T>* &mbl, bemblcluster<T1,T1>* bl,
 	       double eps, unsigned rankmax, const bool& cmplx_sym)
@@ -106,7 +157,20 @@ void apprx_sym(MATGEN_T& MatGen, mblock<T>* &mbl, bemblcluster<T1,T1>* bl,
 
     unsigned i0 = bl->getcl1()->geticom() - b1;
 
-    succ = ::ACAr(MatGen, b1, n1, b2, n2, eps, maxk, i0, k, U, V);
+    const unsigned nb = ACA_nbatch(MatGen);
+    if (nb>1) succ = ::ACAb(MatGen, b1, n1, b2, n2, eps, maxk, i0, k, U, V, nb);
+    else succ = ::ACAr(MatGen, b1, n1, b2, n2, eps, maxk, i0, k, U, V);
+
+    // a posteriori check of the heuristic pivoting (see ACA_ncheck)
+    const unsigned ns = MIN(ACA_ncheck(MatGen), n1);
+    unsigned* rows = NULL;
+    T* R = NULL;
+    if (succ && ns>0) {
+      rows = new unsigned[ns];
+      R = new T[ns*n2];
+      assert(rows!=NULL && R!=NULL);
+      succ = ACA_check(MatGen, b1, n1, b2, n2, k, U, V, eps, ns, rows, R);
+    }
 
     if (succ) {
       mbl->cpyLrM_cmpr(k, U, n1, V, n2, eps, k);      
@@ -116,6 +180,13 @@ void apprx_sym(MATGEN_T& MatGen, mblock<T>* &mbl, bemblcluster<T1,T1>* bl,
     }
     delete [] V;
     delete [] U;
+
+    if (!succ) {
+      apprx_rrf(MatGen, mbl, b1, n1, b2, n2, eps, maxk, R ? ns : 0, rows, R);
+      succ = true;
+    }
+    delete [] R;
+    delete [] rows;
   }
 
   if (!succ) {
@@ -153,7 +224,20 @@ void apprx_unsym(MATGEN_T& MatGen, mblock<T>* &mbl, bemblcluster<T1,T2>* bl,
     T *U, *V;
 
     unsigned i0 = bl->getcl1()->geticom() - b1;
-    succ = ::ACA(MatGen, b1, n1, b2, n2, eps, maxk, i0, k, U, V);
+    const unsigned nb = ACA_nbatch(MatGen);
+    if (nb>1) succ = ::ACAb(MatGen, b1, n1, b2, n2, eps, maxk, i0, k, U, V, nb);
+    else succ = ::ACA(MatGen, b1, n1, b2, n2, eps, maxk, i0, k, U, V);
+
+    // a posteriori check of the heuristic pivoting (see ACA_ncheck)
+    const unsigned ns = MIN(ACA_ncheck(MatGen), n1);
+    unsigned* rows = NULL;
+    T* R = NULL;
+    if (succ && ns>0) {
+      rows = new unsigned[ns];
+      R = new T[ns*n2];
+      assert(rows!=NULL && R!=NULL);
+      succ = ACA_check(MatGen, b1, n1, b2, n2, k, U, V, eps, ns, rows, R);
+    }
 
     if (succ) {
       mbl->cpyLrM_cmpr(k, U, n1, V, n2, eps, k);
@@ -163,6 +247,13 @@ void apprx_unsym(MATGEN_T& MatGen, mblock<T>* &mbl, bemblcluster<T1,T2>* bl,
     }
     delete [] V;
     delete [] U;
+
+    if (!succ) {
+      apprx_rrf(MatGen, mbl, b1, n1, b2, n2, eps, maxk, R ? ns : 0, rows, R);
+      succ = true;
+    }
+    delete [] R;
+    delete [] rows;
   }
 
   if (!succ) {
@@ -0,0 +1,186 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <assert.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//! storage for the entries of the blocks of one or several H-matrices.
+//! Arrays are taken from large chunks by bump allocation. Released arrays
+//! are kept in free lists (one for each power of two of the capacity) and
+//! are reused by later allocations, so truncations during the arithmetic do
+//! not enlarge the arena. All chunks are returned at once by the destructor
+//! or clear(); the blocks must have been deleted before.
+//! The arena may be used by several threads; each arena has its own lock.
+template<class T> class mblockArena
+{
+  struct chunk {
+    T* beg;
+    unsigned long size, used;
+  };
+
+  // each array is preceded by its capacity, which occupies HDR entries
+  enum { HDR = (sizeof(unsigned long)+sizeof(T)-1)/sizeof(T) };
+  enum { NBINS = 8*sizeof(unsigned long) };
+
+  std::vector<chunk> chunks;
+  std::vector<std::pair<T*, unsigned> > index;    // chunks sorted by address
+  std::vector<T*> bins[NBINS];
+  unsigned long chunksize;        // minimum size of the next chunk
+  unsigned long nreleased;        // entries in the free lists
+#ifdef _OPENMP
+  omp_lock_t lock;
+#endif
+
+  void lock_() {
+#ifdef _OPENMP
+    omp_set_lock(&lock);
+#endif
+  }
+
+  void unlock_() {
+#ifdef _OPENMP
+    omp_unset_lock(&lock);
+#endif
+  }
+
+  static unsigned long cap_(const T* p) {
+    unsigned long n;
+    memcpy(&n, (const void*) (p-HDR), sizeof(unsigned long));
+    return n;
+  }
+
+  // index of the highest bit of n
+  static unsigned log2_(unsigned long n) {
+    unsigned b = 0;
+    while (n>>=1) ++b;
+    return b;
+  }
+
+  T* bump_(unsigned long n) {
+    if (chunks.empty() || chunks.back().size-chunks.back().used<n+HDR)
+      newchunk_(n+HDR);
+    chunk& c = chunks.back();
+    T* p = c.beg + c.used + HDR;
+    c.used += n+HDR;
+    memcpy((void*) (p-HDR), &n, sizeof(unsigned long));
+    return p;
+  }
+
+  void newchunk_(unsigned long n) {
+    chunk c;
+    c.size = (n>chunksize) ? n : chunksize;
+    c.used = 0;
+    c.beg = new T[c.size];
+    assert(c.beg!=NULL);
+    index.insert(std::upper_bound(index.begin(), index.end(),
+                                  std::make_pair(c.beg, 0u)),
+                 std::make_pair(c.beg, (unsigned) chunks.size()));
+    chunks.push_back(c);
+    if (chunksize < (1ul<<26)) chunksize *= 2;
+  }
+
+  mblockArena(const mblockArena&);
+  mblockArena& operator=(const mblockArena&);
+
+public:
+  mblockArena(unsigned long n=1ul<<16) : chunksize(n), nreleased(0) {
+#ifdef _OPENMP
+    omp_init_lock(&lock);
+#endif
+  }
+
+  ~mblockArena() {
+    clear();
+#ifdef _OPENMP
+    omp_destroy_lock(&lock);
+#endif
+  }
+
+  //! returns all chunks
+  void clear() {
+    for (unsigned i=0; i<chunks.size(); ++i) delete [] chunks[i].beg;
+    chunks.clear();
+    index.clear();
+    for (unsigned b=0; b<NBINS; ++b) bins[b].clear();
+    nreleased = 0;
+  }
+
+  //! makes sure that the next n entries are allocated contiguously
+  void reserve(unsigned long n) {
+    lock_();
+    if (chunks.empty() || chunks.back().size-chunks.back().used<n)
+      newchunk_(n);
+    unlock_();
+  }
+
+  //! array of n>0 entries
+  T* alloc(unsigned long n) {
+    assert(n>0);
+    T* p = NULL;
+    lock_();
+    // smallest bin with capacities >= n
+    unsigned b = log2_(n);
+    if ((1ul<<b)<n) ++b;
+    for (; b<NBINS && p==NULL; ++b)
+      if (!bins[b].empty()) {
+        p = bins[b].back();
+        bins[b].pop_back();
+        nreleased -= cap_(p);
+      }
+    if (p==NULL) p = bump_(n);
+    unlock_();
+    return p;
+  }
+
+  //! releases p if it belongs to the arena, returns false otherwise
+  bool release(T* p) {
+    bool own = false;
+    lock_();
+    // last chunk which begins at or before p
+    typename std::vector<std::pair<T*, unsigned> >::const_iterator it
+      = std::upper_bound(index.begin(), index.end(),
+                         std::make_pair(p, (unsigned) -1));
+    if (it!=index.begin()) {
+      chunk& c = chunks[(--it)->second];
+      if (p<c.beg+c.size) {
+        own = true;
+        const unsigned long n = cap_(p);
+        if (p+n==c.beg+c.used) c.used -= n+HDR;     // last array
+        else {
+          bins[log2_(n)].push_back(p);
+          nreleased += n;
+        }
+      }
+    }
+    unlock_();
+    return own;
+  }
+
+  //! number of entries in all chunks
+  unsigned long size() const {
+    unsigned long n = 0;
+    for (unsigned i=0; i<chunks.size(); ++i) n += chunks[i].size;
+    return n;
+  }
+
+  //! number of entries in the free lists
+  unsigned long released() const { return nreleased; }
+};
+
+#endif
@@ -210,6 +210,10 @@ extern "C" {
                int*);
   void dsyev_(const char*, const char*, const unsigned*, double*,
               const unsigned*, double*, double*, const unsigned*, int*);
+  void dggev_(const char*, const char*, const unsigned*, double*,
+              const unsigned*, double*, const unsigned*, double*, double*,
+              double*, double*, const unsigned*, double*, const unsigned*,
+              double*, const unsigned*, int*);
   void dgeqrf_(const unsigned*, const unsigned*, double*, const unsigned*,
                double*, double*, int*, int*);
   void dgeqp3_(const unsigned*, const unsigned*, const double*,
@@ -503,6 +507,10 @@ extern "C" {
                int*);
   void zheev_(const char*, const char*, const unsigned*, dcomp*,
               const unsigned*, double*, dcomp*, const unsigned*, double*, int*);
+  void zggev_(const char*, const char*, const unsigned*, dcomp*,
+              const unsigned*, dcomp*, const unsigned*, dcomp*, dcomp*,
+              dcomp*, const unsigned*, dcomp*, const unsigned*, dcomp*,
+              const unsigned*, double*, int*);
   void ztpsv_(const char*, const char*, const char*, const unsigned*,
               const dcomp*, dcomp*, const unsigned*);
   void zgeqrf_(const unsigned*, const unsigned*, dcomp*, const unsigned*,
@@ -2158,6 +2166,30 @@ inline int svals(unsigned m, unsigned n, dcomp* A, double* S,
 }
 
 
+// eigenvalues alpha/beta and right eigenvectors VR of the generalized
+// eigenvalue problem A v = lambda B v, A and B are destroyed;
+// in the real case alpha = alphar + i alphai, the eigenvectors of a pair of
+// complex conjugate eigenvalues are VR_j +/- i VR_j+1
+inline int ggev(unsigned n, double* A, double* B, double* alphar,
+                double* alphai, double* beta, double* VR, unsigned nwk,
+                double* wk)
+{
+  int INF;
+  dggev_(JOB_STR, JOB_STR+4, &n, A, &n, B, &n, alphar, alphai, beta, NULL,
+         &n, VR, &n, wk, &nwk, &INF);
+  return INF;
+}
+inline int ggev(unsigned n, dcomp* A, dcomp* B, dcomp* alpha, dcomp* beta,
+                dcomp* VR, unsigned nwk, dcomp* wk)
+{
+  int INF;
+  double* rwk = new double[8*n];
+  zggev_(JOB_STR, JOB_STR+4, &n, A, &n, B, &n, alpha, beta, NULL, &n, VR,
+         &n, wk, &nwk, rwk, &INF);
+  delete [] rwk;
+  return INF;
+}
+
 // triangular factorisation
 inline int getrf(const unsigned n, double* A, unsigned* ipiv)
 {
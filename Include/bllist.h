@@ -20,6 +20,85 @@ extern void gen_lwBlSequence(blcluster*, blcluster**&, unsigned&);
 extern void gen_HilbertBlSeq(blcluster*, blcluster**&);
 extern void gen_NortonBlSeq(blcluster*, blcluster**&);
 extern void genBlSeqPart(blcluster*, unsigned, blcluster**&, unsigned*&,
-                         unsigned (*cost_fnct)(blcluster&)=NULL);
+                         unsigned (*cost_fnct)(blcluster&)=NULL,
+                         double tol=0.0);
+extern void genSeqPart(unsigned, unsigned long*, unsigned, unsigned*&);
+extern void genBlSeqPartLoc(blcluster**, unsigned, unsigned long*, unsigned,
+                            unsigned*&, double tol=0.0);
+extern unsigned cost_storage(blcluster&);
+extern unsigned cost_ACA(blcluster&);
+
+
+//! partition of the leaves of a block cluster tree into consecutive parts
+//! of a block sequence with (almost) equal cost
+//! part i consists of BlList[part[i]],...,BlList[part[i+1]-1];
+//! its blocks are contained in [beg1[i],end1[i]) x [beg2[i],end2[i]).
+//! The buffers of the products (see mltaGeHVec_omp) are kept in wsp, hence
+//! a partition must not be used by concurrent products.
+struct BlSeqPart {
+  unsigned nblcks, nparts;
+  blcluster** BlList;
+  unsigned *part, *beg1, *end1, *beg2, *end2;
+  char* wsp;
+  unsigned long nwsp;
+
+  BlSeqPart() : nblcks(0), nparts(0), BlList(NULL), part(NULL),
+                beg1(NULL), end1(NULL), beg2(NULL), end2(NULL),
+                wsp(NULL), nwsp(0) { }
+  ~BlSeqPart() { clear(); }
+
+  void clear() {
+    delete [] BlList;
+    delete [] part;
+    delete [] beg1;
+    delete [] end1;
+    delete [] beg2;
+    delete [] end2;
+    delete [] wsp;
+    BlList = NULL;
+    part = beg1 = end1 = beg2 = end2 = NULL;
+    wsp = NULL;
+    nblcks = nparts = 0;
+    nwsp = 0;
+  }
+
+  //! workspace of at least n bytes, which is kept for later products
+  void* workspace(unsigned long n) {
+    if (n>nwsp) {
+      delete [] wsp;
+      wsp = new char[n];
+      assert(wsp!=NULL);
+      nwsp = n;
+    }
+    return wsp;
+  }
+
+  //! computes the extents of the parts
+  void setExtents() {
+    beg1 = new unsigned[nparts];
+    end1 = new unsigned[nparts];
+    beg2 = new unsigned[nparts];
+    end2 = new unsigned[nparts];
+    assert(beg1!=NULL && end1!=NULL && beg2!=NULL && end2!=NULL);
+
+    for (unsigned i=0; i<nparts; ++i) {
+      beg1[i] = beg2[i] = (unsigned) -1;
+      end1[i] = end2[i] = 0;
+      for (unsigned j=part[i]; j<part[i+1]; ++j) {
+        blcluster* bl = BlList[j];
+        if (bl->getb1()<beg1[i]) beg1[i] = bl->getb1();
+        if (bl->getb1()+bl->getn1()>end1[i]) end1[i] = bl->getb1()+bl->getn1();
+        if (bl->getb2()<beg2[i]) beg2[i] = bl->getb2();
+        if (bl->getb2()+bl->getn2()>end2[i]) end2[i] = bl->getb2()+bl->getn2();
+      }
+      if (end1[i]==0) beg1[i] = beg2[i] = 0;       // empty part
+    }
+  }
+
+private:
+  BlSeqPart(const BlSeqPart&);
+  BlSeqPart& operator=(const BlSeqPart&);
+};
+
 #endif
 
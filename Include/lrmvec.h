@@ -0,0 +1,36 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#ifndef LRMVEC_H
+#define LRMVEC_H
+
+#include "cmplx.h"
+
+// maximum rank for which a kernel of fixed rank is available
+#define LRMVEC_KMAX 16
+
+// y += d U V^H x, where U is n1 x k and V is n2 x k (1<=k<=LRMVEC_KMAX).
+// The kernels are instantiated for each rank and the code for AVX2 and
+// AVX-512 is selected at runtime if the processor supports it.
+void mltaLrMVec_k(unsigned n1, unsigned n2, unsigned k, double d,
+                  const double* U, const double* V, const double* x,
+                  double* y);
+void mltaLrMVec_k(unsigned n1, unsigned n2, unsigned k, float d,
+                  const float* U, const float* V, const float* x, float* y);
+void mltaLrMVec_k(unsigned n1, unsigned n2, unsigned k, dcomp d,
+                  const dcomp* U, const dcomp* V, const dcomp* x, dcomp* y);
+void mltaLrMVec_k(unsigned n1, unsigned n2, unsigned k, scomp d,
+                  const scomp* U, const scomp* V, const scomp* x, scomp* y);
+
+// name of the instruction set used by mltaLrMVec_k
+const char* mltaLrMVec_isa();
+
+#endif
@@ -14,6 +14,8 @@
 
 #include "parallel.h"
 #include <cmath>
+#include "bllist.h"
+#include "H.h"
 #include "bemblcluster.h"
 #include "basmod.h"
 #include "mblock.h"
@@ -72,4 +74,55 @@ void matgenSyH_mpi(MATGEN_T& MatGen, bemblcluster<T1,T1>** blList,
   matgen_sym_mpi(MatGen, blList, seq_part, eps, rankmax, A, true);
 }
 
+// Distributed assembly without a root process: every processor builds the
+// (same) cluster and block cluster tree root, which needs only O(nblcks)
+// memory, and calls the following functions. The leaves are partitioned by
+// genBlSeqPart with the a-priori cost cost_fnct; afterwards blList is the
+// block sequence, seq_part the partition and A contains the blocks
+// blList[seq_part[rank]],...,blList[seq_part[rank+1]-1] of this processor.
+// No blocks are communicated. The getidx() of the leaves is overwritten
+// with their position in blList.
+
+template<class T, class T1, class T2, class MATGEN_T>
+void matgenGeH_mpi(MATGEN_T& MatGen, bemblcluster<T1,T2>* root, double eps,
+                   unsigned rankmax, blcluster**& blList, unsigned*& seq_part,
+                   mblock<T>**& A, unsigned (*cost_fnct)(blcluster&)=cost_ACA,
+                   double tol=0.0)
+{
+  const unsigned rank = COMM_AHMED.Get_rank(),
+    nproc = COMM_AHMED.Get_size();
+  genBlSeqPart(root, nproc, blList, seq_part, cost_fnct, tol);
+  allocmbls(seq_part[rank+1]-seq_part[rank], A);
+  matgenGeH_mpi(MatGen, (bemblcluster<T1,T2>**) blList, seq_part, eps,
+                rankmax, A);
+}
+
+template<class T, class T1, class MATGEN_T>
+void matgenHeH_mpi(MATGEN_T& MatGen, bemblcluster<T1,T1>* root, double eps,
+                   unsigned rankmax, blcluster**& blList, unsigned*& seq_part,
+                   mblock<T>**& A, unsigned (*cost_fnct)(blcluster&)=cost_ACA,
+                   double tol=0.0)
+{
+  const unsigned rank = COMM_AHMED.Get_rank(),
+    nproc = COMM_AHMED.Get_size();
+  genBlSeqPart(root, nproc, blList, seq_part, cost_fnct, tol);
+  allocmbls(seq_part[rank+1]-seq_part[rank], A);
+  matgenHeH_mpi(MatGen, (bemblcluster<T1,T1>**) blList, seq_part, eps,
+                rankmax, A);
+}
+
+template<class T, class T1, class MATGEN_T>
+void matgenSyH_mpi(MATGEN_T& MatGen, bemblcluster<T1,T1>* root, double eps,
+                   unsigned rankmax, blcluster**& blList, unsigned*& seq_part,
+                   mblock<T>**& A, unsigned (*cost_fnct)(blcluster&)=cost_ACA,
+                   double tol=0.0)
+{
+  const unsigned rank = COMM_AHMED.Get_rank(),
+    nproc = COMM_AHMED.Get_size();
+  genBlSeqPart(root, nproc, blList, seq_part, cost_fnct, tol);
+  allocmbls(seq_part[rank+1]-seq_part[rank], A);
+  matgenSyH_mpi(MatGen, (bemblcluster<T1,T1>**) blList, seq_part, eps,
+                rankmax, A);
+}
+
 #endif
@@ -13,10 +13,14 @@
 #define MATGEN_OMP
 
 #include <cmath>
+#include <algorithm>
+#include <functional>
+#include <utility>
 #include "bemblcluster.h"
 #include "basmod.h"
 #include "mblock.h"
 #include "apprx.h"
+#include "workspace.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -33,14 +37,68 @@
 // T scale(unsigned b1, unsigned n1, unsigned b2, unsigned n2)
 //      is the expected size of the entries in this block
 
+// The blocks are approximated in the order of decreasing estimated cost
+// such that expensive blocks do not delay the end of the assembly.
+// The cost is the number of entries to be generated. The rank of
+// admissible blocks is estimated from eps, since the ACA has to compute
+// k rows and columns and orthogonalize them.
+inline unsigned long _matgen_cost(blcluster* bl, double eps, unsigned rankmax,
+                                  bool sym)
+{
+  const unsigned long n1 = bl->getn1(), n2 = bl->getn2();
+  if (bl->isadm()) {
+    unsigned long k = rankmax;            // only bounded by rankmax if eps==0
+    if (eps>=1.0) k = 1;
+    else if (eps>0.0) k = MIN(k, (unsigned long) ceil(-2.0*log(eps)));
+    k = MIN(k, MIN(n1, n2));
+    return (n1+n2)*k*(k+2)/2;
+  }
+  if (sym && bl->isdbl()) return n1*(n1+1)/2;
+  return n1*n2;
+}
+
+// sort the list of blocks by decreasing cost
+inline void _matgen_sort(unsigned nblcks, blcluster** BlList, double eps,
+                         unsigned rankmax, bool sym)
+{
+  std::pair<unsigned long, unsigned>* c =
+    new std::pair<unsigned long, unsigned>[nblcks];
+  assert(c!=NULL);
+  blcluster** tmp = new blcluster*[nblcks];
+  assert(tmp!=NULL);
+
+  for (unsigned i=0; i<nblcks; ++i) {
+    c[i].first = _matgen_cost(BlList[i], eps, rankmax, sym);
+    c[i].second = i;
+    tmp[i] = BlList[i];
+  }
+  std::stable_sort(c, c+nblcks,
+                   std::greater<std::pair<unsigned long, unsigned> >());
+  for (unsigned i=0; i<nblcks; ++i) BlList[i] = tmp[c[i].second];
+
+  delete [] tmp;
+  delete [] c;
+}
+
+// progress is counted after a block has been finished
+inline void _matgen_progress(unsigned& co, unsigned nblcks)
+{
+  unsigned i;
+#pragma omp atomic capture
+  i = co++;
+
+  char st[100];
+  sprintf(st, "Approximating using %d threads ... ", omp_get_num_threads());
+#pragma omp critical (matgen_progress)
+  progressbar(std::cout, st, i, nblcks, 20, true);
+}
+
 template<class T,class T1,class T2, class MATGEN_T> static
 void _thr(MATGEN_T& MatGen, unsigned& co, unsigned nblcks,
 	  bemblcluster<T1,T2>* bl, double eps, unsigned rankmax, mblock<T>** A)
 {
-  char st[100];
-  sprintf(st, "Approximating using %d threads ... ", omp_get_num_threads());
-  progressbar(std::cout, st, co++, nblcks, 20, true);
   apprx_unsym(MatGen, A[bl->getidx()], bl, eps, rankmax);
+  _matgen_progress(co, nblcks);
 }
 
 
@@ -49,10 +107,8 @@ void _thr_sym(MATGEN_T& MatGen, unsigned& co, unsigned nblcks,
 	      bemblcluster<T1,T1>* bl, double eps, unsigned rankmax,
 	      mblock<T>** A, const bool& cmplx_sym)
 {
-  char st[100];
-  sprintf(st, "Approximating using %d threads ... ", omp_get_num_threads());
-  progressbar(std::cout, st, co++, nblcks, 20, true);
   apprx_sym(MatGen, A[bl->getidx()], bl, eps, rankmax, cmplx_sym);
+  _matgen_progress(co, nblcks);
 }
 
 
@@ -63,13 +119,18 @@ void matgenGeH_omp(MATGEN_T& MatGen, unsigned nblcks, bemblcluster<T1,T2>* bl,
   // generate the list of blocks
   blcluster** BlList;
   gen_BlSequence(bl, BlList);
+  _matgen_sort(nblcks, BlList, eps, rankmax, false);
 
   unsigned counter = 0;
 
-#pragma omp parallel for schedule(dynamic)
-  for (int i=0; i<(int) nblcks; i++)
-    _thr(MatGen, counter, nblcks, (bemblcluster<T1,T2>*)BlList[i], eps,
-	 rankmax, A);
+#pragma omp parallel
+  {
+#pragma omp for schedule(dynamic,1)
+    for (int i=0; i<(int) nblcks; i++)
+      _thr(MatGen, counter, nblcks, (bemblcluster<T1,T2>*)BlList[i], eps,
+           rankmax, A);
+    releaseWork();
+  }
 
   delete [] BlList;
 }
@@ -82,12 +143,17 @@ void matgen_sym_omp(MATGEN_T& MatGen, unsigned nblcks, bemblcluster<T1,T1>* bl,
   // generate the list of blocks
   blcluster** BlList;
   gen_BlSequence(bl, BlList);
+  _matgen_sort(nblcks, BlList, eps, rankmax, true);
 
   unsigned counter = 0;
-#pragma omp parallel for schedule(dynamic)
-  for (int i=0; i<(int) nblcks; i++)
-    _thr_sym(MatGen, counter, nblcks, (bemblcluster<T1,T1>*)BlList[i],
-             eps, rankmax, A, cmplx_sym);
+#pragma omp parallel
+  {
+#pragma omp for schedule(dynamic,1)
+    for (int i=0; i<(int) nblcks; i++)
+      _thr_sym(MatGen, counter, nblcks, (bemblcluster<T1,T1>*)BlList[i],
+               eps, rankmax, A, cmplx_sym);
+    releaseWork();
+  }
 
   delete [] BlList;
 }
@@ -28,6 +28,25 @@ template<class T> struct Matrix {
   {  amux(d, x, y);  }
 
   virtual void precond_apply(T*) const { }            // apply preconditioner
+
+  // Y += d*AX for p columns, the default applies amux to each column
+  virtual void amuxGeM(T d, unsigned p, T* X, unsigned ldX,
+                       T* Y, unsigned ldY) const {
+    for (unsigned l=0; l<p; ++l) amux(d, X+l*ldX, Y+l*ldY);
+  }
+
+  // apply preconditioner to p columns
+  virtual void precond_applyGeM(unsigned p, T* X, unsigned ldX) const {
+    for (unsigned l=0; l<p; ++l) precond_apply(X+l*ldX);
+  }
+
+  // sum up the n partial inner products v over the processors if the
+  // vectors are distributed; the solvers start the reduction, continue
+  // with work which does not depend on it and wait for it before v is used.
+  // The default applies to vectors held as a whole.
+  virtual void sum_start(unsigned, T*) const { }
+  virtual void sum_wait() const { }
+
   virtual ~Matrix() { }
 };
 
@@ -302,11 +321,14 @@ double cntrctrate(Matrix<T>& A, Matrix<T>& B, const unsigned it_num = 10)
 #include "mblock.h"
 #include "blcluster.h"
 #include "H.h" //mltaGeHVec, mltaGeHhVec, mltaHeHVec, mltaSyHVec
+#include "HVecPlan.h"
 
 //note that blclTree must not be deleted before call of destructor
+//genPlan() has to be called again if blcks or its blocks are replaced
 template<class T> struct HeHMatrix : public Matrix<T> {
   mblock<T>** blcks;
   blcluster* blclTree;
+  HVecPlan<T> plan;
 
   HeHMatrix(unsigned n, blcluster* tree = NULL) : Matrix<T>(n, n),
     blcks(NULL), blclTree(tree) { }
@@ -315,8 +337,18 @@ template<class T> struct HeHMatrix : public Matrix<T> {
     freembls(blclTree, blcks);
   }
 
+  // flatten the block structure for subsequent products
+  void genPlan() {
+    plan.init(blclTree, blcks, true);
+  }
+
   void amux(T d, T* x, T* y) const {
-    mltaHeHVec(d, blclTree, blcks, x, y);
+    if (plan.empty()) mltaHeHVec(d, blclTree, blcks, x, y);
+    else plan.amux(d, x, y);
+  }
+
+  void amuxGeM(T d, unsigned p, T* X, unsigned ldX, T* Y, unsigned ldY) const {
+    mltaHeHGeM(d, blclTree, blcks, p, X, ldX, Y, ldY);
   }
 
   void precond_apply(T* x) const { }
@@ -349,9 +381,11 @@ template<class T> struct SyHMatrix : public Matrix<T > {
 
 
 //note that blclTree must not be deleted before call of destructor
+//genPlan() has to be called again if blcks or its blocks are replaced
 template<class T> struct GeHMatrix : public Matrix<T> {
   mblock<T>** blcks;
   blcluster* blclTree;
+  HVecPlan<T> plan;
 
   GeHMatrix(unsigned n1, unsigned n2, blcluster* tree = NULL) :
       Matrix<T>(n1, n2), blcks(NULL), blclTree(tree) { }
@@ -360,11 +394,21 @@ template<class T> struct GeHMatrix : public Matrix<T> {
     freembls(blclTree, blcks);
   }
 
+  // flatten the block structure for subsequent products
+  void genPlan() {
+    plan.init(blclTree, blcks);
+  }
+
   void amux(T d, T* x, T* y) const {
-    mltaGeHVec(d, blclTree, blcks, x, y);
+    if (plan.empty()) mltaGeHVec(d, blclTree, blcks, x, y);
+    else plan.amux(d, x, y);
   }
   void atmux(T d, T* x, T* y) const {
-    mltaGeHhVec(conj(d), blclTree, blcks, x, y);
+    if (plan.empty()) mltaGeHhVec(conj(d), blclTree, blcks, x, y);
+    else plan.amuxh(conj(d), x, y);
+  }
+  void amuxGeM(T d, unsigned p, T* X, unsigned ldX, T* Y, unsigned ldY) const {
+    mltaGeHGeM(d, blclTree, blcks, p, X, ldX, Y, ldY);
   }
   void precond_apply(T* x) const { }
 };
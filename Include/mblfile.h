@@ -0,0 +1,240 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#ifndef MBLFILE_H
+#define MBLFILE_H
+
+#include <string.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include "mblock.h"
+#include "blcluster.h"
+#include "bllist.h"
+#include "H.h"
+
+// Binary container for the blocks of an H-matrix
+//
+//   header     mblfileHdr
+//   index      one mblfileEntry for each leaf
+//   payloads   the entries of each block (see mblock::storage) in the
+//              order of gen_BlSequence, each starting at a multiple of
+//              MBLFILE_ALIGN
+//
+// Since the payloads are aligned, the file can be mapped into memory and
+// the blocks use the mapped entries directly (mapmbls). Blocks which are
+// stored in reduced precision (see setPrecH) keep their precision, which
+// gives an error-bounded lossy compression of the file.
+
+#define MBLFILE_MAGIC "AHMEDHM"
+#define MBLFILE_VERSION 1
+#define MBLFILE_ALIGN 64
+#define MBLFILE_NOBLOCK 6            // status of a leaf without block
+
+struct mblfileHdr {
+  char magic[8];
+  unsigned version;
+  unsigned endian;                   // 0x01020304 in the byte order of
+                                     // the writing machine
+  unsigned sizeT, sizeR;             // sizeof(T) and of its real type
+  unsigned nblcks;
+  unsigned bmin;
+  double eta;
+  unsigned long long idxoff;         // offset of the index
+  unsigned long long size;           // size of the file
+};
+
+struct mblfileEntry {
+  unsigned long long off;            // offset of the payload
+  unsigned long long bytes;          // size of the payload
+  unsigned n1, n2;
+  unsigned status;                   // see mblock::status
+  unsigned rank;
+  unsigned prec;                     // see mblock::getPrec
+  unsigned pad;
+};
+
+//! a file mapped into memory (read into memory if mmap is not available).
+//! The pages are mapped read-only, so that the out-of-core routines can
+//! return them to the operating system at any time (see oocH.cpp). Blocks
+//! which use the mapping must not be changed in place; detachmbls copies
+//! them to memory of their own. The blocks which use the mapping have to
+//! be deleted or detached before the mblFile.
+class mblFile
+{
+  char* base;
+  unsigned long len;
+  bool mapped;
+
+  mblFile(const mblFile&);
+  mblFile& operator=(const mblFile&);
+
+public:
+  mblFile() : base(NULL), len(0), mapped(false) { }
+  ~mblFile() { close(); }
+
+  //! maps the file fname, returns false if it cannot be opened
+  bool open(const char* fname);
+
+  //! unmaps the file
+  void close();
+
+  char* ptr() const { return base; }
+  unsigned long size() const { return len; }
+};
+
+// checks the header of the mapped file for blocks of type T
+template<class T> static const mblfileHdr* mblfileCheck_(const mblFile& f)
+{
+  const mblfileHdr* hdr = (const mblfileHdr*) f.ptr();
+  if (f.size()<sizeof(mblfileHdr) ||
+      strncmp(hdr->magic, MBLFILE_MAGIC, sizeof(hdr->magic))!=0) {
+    std::cerr << "Not an H-matrix file" << std::endl;
+    exit(1);
+  }
+  if (hdr->version!=MBLFILE_VERSION || hdr->endian!=0x01020304) {
+    std::cerr << "Unsupported version or byte order of H-matrix file"
+              << std::endl;
+    exit(1);
+  }
+  if (hdr->sizeT!=sizeof(T) ||
+      hdr->sizeR!=sizeof(typename num_traits<T>::abs_type)) {
+    std::cerr << "H-matrix file contains a different type" << std::endl;
+    exit(1);
+  }
+  if (hdr->size!=f.size() ||
+      hdr->idxoff+hdr->nblcks*sizeof(mblfileEntry)>f.size()) {
+    std::cerr << "H-matrix file is truncated" << std::endl;
+    exit(1);
+  }
+  return hdr;
+}
+
+// size of the payload of the block described by e (see mblock::nvals)
+template<class T> static
+unsigned long long mblfileBytes_(const mblfileEntry& e)
+{
+  const unsigned long long n1 = e.n1, n2 = e.n2;
+  const unsigned long long nvals = (e.status==0) ? (n1+n2)*e.rank
+    : (e.status==4) ? n1*n2 : n1*(n1+1)/2;
+  return nvals*mblock<T>::bytesPrec(e.prec);
+}
+
+//! writes the blocks of the H-matrix A to the file fname
+template<class T> void savembls_bin(const double eta, const unsigned bmin,
+                                    blcluster* bl, mblock<T>** A,
+                                    const char* fname)
+{
+  assert(A!=NULL);
+  const unsigned n = bl->nleaves();
+  mblfileHdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  strcpy(hdr.magic, MBLFILE_MAGIC);
+  hdr.version = MBLFILE_VERSION;
+  hdr.endian = 0x01020304;
+  hdr.sizeT = sizeof(T);
+  hdr.sizeR = sizeof(typename num_traits<T>::abs_type);
+  hdr.nblcks = n;
+  hdr.bmin = bmin;
+  hdr.eta = eta;
+  hdr.idxoff = sizeof(mblfileHdr);
+
+  // the index; the payloads are stored in the order of gen_BlSequence
+  mblfileEntry* idx = new mblfileEntry[n];
+  assert(idx!=NULL);
+  memset(idx, 0, n*sizeof(mblfileEntry));
+  blcluster** BlList;
+  gen_BlSequence(bl, BlList);
+  unsigned long long off = hdr.idxoff + n*sizeof(mblfileEntry);
+  for (unsigned l=0; l<n; ++l) {
+    const unsigned i = BlList[l]->getidx();
+    mblock<T>* mbl = A[i];
+    if (mbl==NULL) {
+      idx[i].status = MBLFILE_NOBLOCK;
+      continue;
+    }
+    idx[i].n1 = mbl->getn1();
+    idx[i].n2 = mbl->getn2();
+    idx[i].status = mbl->status();
+    idx[i].rank = mbl->isLrM() ? mbl->rank() : 0;
+    idx[i].prec = mbl->getPrec();
+    idx[i].bytes = (unsigned long long) mbl->nvals()
+      * mblock<T>::bytesPrec(idx[i].prec);
+    off = (off+MBLFILE_ALIGN-1)/MBLFILE_ALIGN*MBLFILE_ALIGN;
+    idx[i].off = off;
+    off += idx[i].bytes;
+  }
+  hdr.size = off;
+
+  std::ofstream os(fname, std::ios::binary);
+  if (!os) {
+    std::cerr << "OutputStream not found" << std::endl;
+    exit(1);
+  }
+  os.write((char*) &hdr, sizeof(hdr));
+  os.write((char*) idx, n*sizeof(mblfileEntry));
+
+  const char zeros[MBLFILE_ALIGN] = { 0 };
+  unsigned long long pos = hdr.idxoff + n*sizeof(mblfileEntry);
+  for (unsigned l=0; l<n; ++l) {
+    const unsigned i = BlList[l]->getidx();
+    if (idx[i].status==MBLFILE_NOBLOCK) continue;
+    os.write(zeros, idx[i].off-pos);
+    os.write((const char*) A[i]->storage(), idx[i].bytes);
+    pos = idx[i].off + idx[i].bytes;
+  }
+  delete [] BlList;
+  delete [] idx;
+
+  if (!os) {
+    std::cerr << "Error while saving mbls" << std::endl;
+    exit(1);
+  }
+}
+
+//! generates the blocks of the H-matrix stored in the mapped file f; the
+//! blocks use the entries in the mapping (see mblock::attach) and are
+//! read-only until they are detached (see detachmbls).
+//! mapmbls does not need allocmbls
+template<class T> void mapmbls(const mblFile& f, double& eta, unsigned& bmin,
+                               mblock<T>** &A)
+{
+  const mblfileHdr* hdr = mblfileCheck_<T>(f);
+  eta = hdr->eta;
+  bmin = hdr->bmin;
+  const unsigned n = hdr->nblcks;
+  const mblfileEntry* idx = (const mblfileEntry*) (f.ptr()+hdr->idxoff);
+
+  allocmbls(n, A);
+  for (unsigned i=0; i<n; ++i) {
+    const mblfileEntry& e = idx[i];
+    if (e.status==MBLFILE_NOBLOCK) continue;
+    if (e.status>5 || e.prec>2 || (e.status!=0 && e.status!=4 &&
+                                   e.n1!=e.n2) ||
+        e.bytes!=mblfileBytes_<T>(e) || e.bytes>f.size() ||
+        e.off>f.size()-e.bytes || e.off%MBLFILE_ALIGN!=0) {
+      std::cerr << "Error while loading mbls" << std::endl;
+      exit(1);
+    }
+    A[i] = new mblock<T>(e.n1, e.n2);
+    A[i]->attach(e.status, e.rank, e.prec, f.ptr()+e.off);
+  }
+}
+
+//! copies the n blocks of A which use a mapping to memory of their own,
+//! after which they may be changed and the mblFile may be closed
+template<class T> void detachmbls(unsigned n, mblock<T>** A)
+{
+  for (unsigned i=0; i<n; ++i)
+    if (A[i]!=NULL) A[i]->detach();
+}
+
+#endif
@@ -25,6 +25,17 @@
 #include "preserveVec.h"
 #include "cluster.h"
 #include "basmod.h"
+#include "arena.h"
+
+// low-rank updates U V^H of a block which have not been truncated yet
+template<class T> struct mblockAcc {
+  T *U, *V;             // n1 x cap and n2 x cap
+  unsigned k, cap;      // rank and capacity
+  unsigned kmax;        // largest rank of a single update
+  double eps;           // accuracy and maximum rank of the truncation
+  unsigned kgoal;
+  bool rsvd;            // truncation by randomized SVD
+};
 
 template<class T> class mblock
 {
@@ -34,6 +45,12 @@ template<class T> class mblock
 
 protected:
   T *data;                // if low-rank-repr. UV^H (twice MAX_RANK columns)
+  mblockArena<T>* arena;  // storage of data, NULL if taken from the heap
+  mblockAcc<T>* acc;      // pending updates, NULL if not accumulating
+  union {                 // entries in reduced precision (see setPrec)
+    float* s;
+    unsigned short* b;
+  } lpdata;
   unsigned n1, n2;        // n1 number of rows, n2 number of columns
   unsigned bl_rank;       // the rank of this block
 
@@ -43,8 +60,38 @@ protected:
     unsigned is_SyM : 1;        // for dense matrices: is symmetric ?
     unsigned is_LtM : 1;        // for dense matrices: is lower triangular ?
     unsigned is_UtM : 1;        // for dense matrices: is upper triangular ?
+    unsigned prec : 2;          // 0 T, 1 single, 2 bfloat16 (see setPrec)
+    unsigned is_ext : 1;        // entries are not owned (see attach)
   } info;
 
+  // storage for n entries, taken from the arena if the block is attached
+  T* alloc_(unsigned long n) {
+    T* p = (arena!=NULL && n>0) ? arena->alloc(n) : new T[n];
+    assert(p!=NULL);
+    return p;
+  }
+
+  void free_(T* p) {
+    if (p!=NULL && !info.is_ext && (arena==NULL || !arena->release(p)))
+      delete [] p;
+    freeLp_();
+  }
+
+  // the entries in reduced precision are dropped
+  void freeLp_() {
+    if (!info.is_ext) {
+      if (info.prec==1) delete [] lpdata.s;
+      else if (info.prec==2) delete [] lpdata.b;
+    }
+    lpdata.s = NULL;
+    info.prec = info.is_ext = 0;
+  }
+
+  // multiplication routines for blocks stored in reduced precision;
+  // op is one of the functions below
+  bool mltaLp_(char op, T d, unsigned p, T* X, unsigned ldX,
+               T* Y, unsigned ldY) const;
+
   // a low-rank matrix U V^H is stored columnwise : (U,V)
   // a dense matrix is stored column by column
   // a dense symmetric/hermitian matrix is stored as an upper triangular matrix
@@ -61,6 +108,18 @@ protected:
   // append low-rank matrix to this low-rank matrix
   void append(unsigned k, T* U, unsigned ldU, T* V, unsigned ldV);
 
+  // add low-rank matrix to the pending updates
+  void addAcc_(unsigned k, T* U, unsigned ldU, T* V, unsigned ldV,
+               double eps, unsigned kgoal);
+
+  // add the pending updates with truncation
+  void truncAcc_();
+
+  // add low-rank matrix to this low-rank matrix with truncation by a
+  // randomized SVD, returns false if nothing was done
+  bool addtrll_rsvd_(unsigned k, T* U, unsigned ldU, T* V, unsigned ldV,
+                     double delta, unsigned kgoal, unsigned l);
+
   // add low-rank matrix to this low-rank matrix with truncation
   // returns remainder
   void addtrll_rmnd(unsigned, T*, unsigned, T*, unsigned,
@@ -140,10 +199,31 @@ protected:
     blas::hemva(n1, d, data, x, y);
   }  
 
+  // unpack a packed matrix (hermitian 'H', symmetric 'S' or upper
+  // triangular 'U') to the full n1 x n1 matrix A
+  void unpack_(char op, T* A) const {
+    assert(isGeM() && n1==n2);
+    T* p = data;
+    for (unsigned j=0; j<n1; ++j) {
+      for (unsigned i=0; i<j; ++i) {
+        A[i+j*n1] = *p;
+        A[j+i*n1] = (op=='H') ? conj(*p) : (op=='S') ? *p : (T) 0.0;
+        ++p;
+      }
+      A[j*(n1+1)] = *p++;
+    }
+  }
+
+  // Y += d A X, Y += d A^H X, Y += d A^T X for a packed matrix A
+  // for more than one column A is unpacked such that BLAS-3 can be used
+  void mltaPckGeM_(char op, char trans, T d, unsigned p, T* X, unsigned ldX,
+                   T* Y, unsigned ldY) const;
+
   // multiply hermitian packed by dense: Y += d A X (A is herm. dense)
   void mltaHeMGeM(T d, unsigned p, T* X, unsigned ldX,
                         T* Y, unsigned ldY) const {
-    for (unsigned l=0; l<p; ++l) mltaHeMVec(d, X+ldX*l, Y+ldY*l);
+    if (p>1) mltaPckGeM_('H', 'N', d, p, X, ldX, Y, ldY);
+    else for (unsigned l=0; l<p; ++l) mltaHeMVec(d, X+ldX*l, Y+ldY*l);
   }
 
   // multiply sym packed by vector: y += d A x (A is sym. dense)
@@ -155,7 +235,8 @@ protected:
   // multiply sym packed by dense: Y += d A X (A is sym. dense)
   void mltaSyMGeM(T d, unsigned p, T* X, unsigned ldX,
                         T* Y, unsigned ldY) const {
-    for (unsigned l=0; l<p; ++l) mltaSyMVec(d, X+ldX*l, Y+ldY*l);
+    if (p>1) mltaPckGeM_('S', 'N', d, p, X, ldX, Y, ldY);
+    else for (unsigned l=0; l<p; ++l) mltaSyMVec(d, X+ldX*l, Y+ldY*l);
   }
 
   // multiply transposed of herm. packed by vector: y += d A^T x (A is herm. dense)
@@ -171,7 +252,8 @@ protected:
   // multiply transposed of herm packed by dense: Y += d A^T X (A is herm. dense)
   void mltaHeMtGeM(T d, unsigned p, T* X, unsigned ldX,
                         T* Y, unsigned ldY) const {
-    for (unsigned l=0; l<p; ++l) mltaHeMtVec(d, X+ldX*l, Y+ldY*l);
+    if (p>1) mltaPckGeM_('H', 'T', d, p, X, ldX, Y, ldY);
+    else for (unsigned l=0; l<p; ++l) mltaHeMtVec(d, X+ldX*l, Y+ldY*l);
   }
   
   // multiply herm transp of sym. packed by vector: y += d A^H x (A is sym. dense)
@@ -187,7 +269,8 @@ protected:
   // multiply herm trans of sym packed by dense: y += d A^H x (A is sym. dense)
   void mltaSyMhGeM(T d, unsigned p, T* X, unsigned ldX,
 		   T* Y, unsigned ldY) const {
-    for (unsigned l=0; l<p; ++l) mltaSyMhVec(d, X+ldX*l, Y+ldY*l);
+    if (p>1) mltaPckGeM_('S', 'H', d, p, X, ldX, Y, ldY);
+    else for (unsigned l=0; l<p; ++l) mltaSyMhVec(d, X+ldX*l, Y+ldY*l);
   }
   
   
@@ -207,7 +290,8 @@ protected:
   // multiply upper triangular by dense: Y += d A X (A is utr)
   void mltaUtMGeM(T d, unsigned p, T* X, unsigned ldX,
                         T* Y, unsigned ldY) const {
-    for (unsigned l=0; l<p; ++l) mltaUtMVec(d, X+ldX*l, Y+ldY*l);
+    if (p>1) mltaPckGeM_('U', 'N', d, p, X, ldX, Y, ldY);
+    else for (unsigned l=0; l<p; ++l) mltaUtMVec(d, X+ldX*l, Y+ldY*l);
   }
 
   // multiply herm transp of lower triangular by vector: y += d (PL)^H x = d L^H P^{-1} x
@@ -225,7 +309,8 @@ protected:
   // multiply herm transposed of upper triang by dense: Y += d A^H X (A is utr)
   void mltaUtMhGeM(T d, unsigned p, T* X, unsigned ldX,
 		   T* Y, unsigned ldY) const {
-    for (unsigned l=0; l<p; ++l) mltaUtMhVec(d, X+ldX*l, Y+ldY*l);
+    if (p>1) mltaPckGeM_('U', 'H', d, p, X, ldX, Y, ldY);
+    else for (unsigned l=0; l<p; ++l) mltaUtMhVec(d, X+ldX*l, Y+ldY*l);
   }
 
   // multiply transposed of lower triang by vector: y += d (PL)^T x = d L^T P^{-1} x
@@ -258,7 +343,8 @@ protected:
   // multiply transposed of upper triangular by dense: Y += d A^T X (A is utr)
   void mltaUtMtGeM(T d, unsigned p, T* X, unsigned ldX,
 		   T* Y, unsigned ldY) const {
-    for (unsigned l=0; l<p; ++l) mltaUtMtVec(d, X+ldX*l, Y+ldY*l);
+    if (p>1) mltaPckGeM_('U', 'T', d, p, X, ldX, Y, ldY);
+    else for (unsigned l=0; l<p; ++l) mltaUtMtVec(d, X+ldX*l, Y+ldY*l);
   }
 
   
@@ -274,12 +360,21 @@ public:
   mblock(unsigned m, unsigned n) : n1(m), n2(n) {
     bl_rank = info.is_HeM = info.is_SyM = info.is_LtM = info.is_UtM = 0;
     info.is_LrM = 1;
+    info.prec = info.is_ext = 0;
     data = NULL;
+    lpdata.s = NULL;
+    arena = NULL;
+    acc = NULL;
   }
 
   // Destruktor
   ~mblock() {
-    delete[] data;
+    free_(data);
+    if (acc!=NULL) {
+      delete [] acc->U;
+      delete [] acc->V;
+      delete acc;
+    }
   }
 
   // number of values in data
@@ -292,7 +387,7 @@ public:
 
   // return size of this mblock
   unsigned long size() const {
-    return sizeof(T)*nvals() + sizeof(mblock<T>);
+    return bytesPrec(info.prec)*nvals() + sizeof(mblock<T>);
   };
 
   // *************************************************************************
@@ -334,7 +429,7 @@ public:
   }
 
   void freedata() {
-    delete[] data;
+    free_(data);
     data = NULL;
     info.is_LrM = 1;
     bl_rank = 0;
@@ -344,56 +439,197 @@ public:
     return data;
   }
 
+  //! moves the entries to the arena a (to the heap if a==NULL);
+  //! later allocations of this block are taken from a, too
+  void setArena(mblockArena<T>* a) {
+    if (a==arena) return;
+    mblockArena<T>* const old = arena;
+    T* const p = data;
+    arena = a;
+    if (p!=NULL) {
+      const unsigned long n = nvals();
+      data = alloc_(n);
+      blas::copy(n, p, data);
+      if (info.is_ext) info.is_ext = 0;
+      else if (old==NULL || !old->release(p)) delete [] p;
+    }
+  }
+
+  mblockArena<T>* getArena() const {
+    return arena;
+  }
+
+  //! low-rank updates of this low-rank block are collected by addLrM and
+  //! are truncated at once by flushAcc (or earlier if the sum of their
+  //! ranks exceeds the rank of the block); if rsvd, a randomized SVD is used
+  void initAcc(bool rsvd=false) {
+    if (acc!=NULL || !isLrM()) return;
+    acc = new mblockAcc<T>;
+    acc->U = acc->V = NULL;
+    acc->k = acc->cap = acc->kmax = acc->kgoal = 0;
+    acc->eps = 0.0;
+    acc->rsvd = rsvd;
+  }
+
+  //! type of the block as in save (0 low-rank, 1 hermitian, 2 lower and
+  //! 3 upper triangular, 4 dense, 5 symmetric)
+  unsigned status() const {
+    if (isLrM()) return 0;
+    if (isHeM()) return 1;
+    if (isLtM()) return 2;
+    if (isUtM()) return 3;
+    if (isSyM()) return 5;
+    return 4;
+  }
+
+  //! the entries in the precision getPrec(), nvals() numbers
+  const void* storage() const {
+    return (info.prec==0) ? (const void*) data
+      : (info.prec==1) ? (const void*) lpdata.s : (const void*) lpdata.b;
+  }
+
+  //! the entries are not owned by the block (see attach)
+  bool isAttached() const {
+    return info.is_ext;
+  }
+
+  //! the block of type st (see status) and rank k uses the entries p in
+  //! precision prec without copying them; p is not released by the block.
+  //! Before the block is changed in place it has to be detached if p must
+  //! not be overwritten (e.g. a read-only mapping, see mblFile)
+  void attach(unsigned st, unsigned k, unsigned prec, void* p) {
+    assert(st<=5 && prec<=2);
+    free_(data);
+    data = NULL;
+    info.is_LrM = info.is_HeM = info.is_SyM = info.is_LtM = info.is_UtM = 0;
+    bl_rank = 0;
+    if (st==0) {
+      info.is_LrM = 1;
+      bl_rank = k;
+    } else if (st==1) info.is_HeM = 1;
+    else if (st==2) info.is_LtM = 1;
+    else if (st==3) info.is_UtM = 1;
+    else if (st==5) info.is_SyM = 1;
+    if (nvals()==0) return;
+    if (prec==0) data = (T*) p;
+    else if (prec==1) lpdata.s = (float*) p;
+    else lpdata.b = (unsigned short*) p;
+    info.prec = prec;
+    info.is_ext = 1;
+  }
+
+  //! copies the entries of an attached block to storage of its own
+  void detach() {
+    if (!info.is_ext) return;
+    typedef typename num_traits<T>::abs_type R;
+    const unsigned long n = nvals(), nr = n*(sizeof(T)/sizeof(R));
+    if (info.prec==0) {
+      T* const p = alloc_(n);
+      blas::copy(n, data, p);
+      data = p;
+    } else if (info.prec==1) {
+      float* const s = new float[nr];
+      assert(s!=NULL);
+      memcpy(s, lpdata.s, nr*sizeof(float));
+      lpdata.s = s;
+    } else {
+      unsigned short* const b = new unsigned short[nr];
+      assert(b!=NULL);
+      memcpy(b, lpdata.b, nr*sizeof(unsigned short));
+      lpdata.b = b;
+    }
+    info.is_ext = 0;
+  }
+
+  //! stores the entries in reduced precision p (0 T, 1 single, 2 bfloat16
+  //! with single precision arithmetic); single is available only if T is
+  //! double or dcomp. A block in reduced precision can only be multiplied
+  //! by vectors and matrices (mltaVec, mltaGeM, ...), where the entries are
+  //! converted on the fly. Before other operations the block has to be
+  //! restored with setPrec(0).
+  void setPrec(unsigned p);
+
+  unsigned getPrec() const {
+    return info.prec;
+  }
+
+  //! bytes per entry in precision p
+  static unsigned bytesPrec(unsigned p) {
+    const unsigned r = sizeof(T)/sizeof(typename num_traits<T>::abs_type);
+    return (p==0) ? sizeof(T) : (p==1) ? r*sizeof(float)
+      : r*sizeof(unsigned short);
+  }
+
+  bool isAcc() const {
+    return acc!=NULL;
+  }
+
+  //! the pending updates are truncated by a randomized SVD (see initAcc)
+  bool isAccRsvd() const {
+    return acc!=NULL && acc->rsvd;
+  }
+
+  //! adds the pending updates and stops the accumulation
+  void flushAcc() {
+    if (acc!=NULL) {
+      truncAcc_();
+      delete [] acc->U;
+      delete [] acc->V;
+      delete acc;
+      acc = NULL;
+    }
+  }
+
   void setrank(const unsigned k) {
-    delete[] data;
+    free_(data);
     bl_rank = k;
     info.is_LrM = 1;
     if (k) {
-      data = new T[k*(n1+n2)];
+      data = alloc_(k*(n1+n2));
       assert(data!=NULL);
     } else data = NULL;
   }
 
   void setGeM() {
-    delete[] data;
+    free_(data);
     info.is_LrM = info.is_HeM = info.is_SyM = info.is_LtM = info.is_UtM = 0;
-    data = new T[n1*n2];
+    data = alloc_(n1*n2);
     assert(data!=NULL);
   }
 
   void setHeM() {
     assert(n1==n2);
-    delete[] data;
+    free_(data);
     info.is_LrM = info.is_SyM = info.is_UtM = info.is_LtM = 0;
     info.is_HeM = 1;
-    data = new T[n1*(n1+1)/2];
+    data = alloc_(n1*(n1+1)/2);
     assert(data!=NULL);
   }
 
   void setSyM() {
     assert(n1==n2);
-    delete[] data;
+    free_(data);
     info.is_LrM = info.is_HeM = info.is_UtM = info.is_LtM = 0;
     info.is_SyM = 1;
-    data = new T[n1*(n1+1)/2];
+    data = alloc_(n1*(n1+1)/2);
     assert(data!=NULL);
   }
 
   void setLtM() {
     assert(n1==n2);
-    delete[] data;
+    free_(data);
     info.is_LrM = info.is_HeM = info.is_SyM = info.is_UtM = 0;
     info.is_LtM = 1;
-    data = new T[n1*(n1+1)/2];
+    data = alloc_(n1*(n1+1)/2);
     assert(data!=NULL);
   }
 
   void setUtM() {
     assert(n1==n2);
-    delete[] data;
+    free_(data);
     info.is_LrM = info.is_HeM = info.is_SyM = info.is_LtM = 0;
     info.is_UtM = 1;
-    data = new T[n1*(n1+1)/2];
+    data = alloc_(n1*(n1+1)/2);
     assert(data!=NULL);
   }
 
@@ -736,6 +972,7 @@ public:
 
   void save(std::ofstream& os) {
     // 0 isLrM, 1 isGeM, 2 isLtM, 3 isUtM, 4 dense
+    assert(info.prec==0);         // see savembls_bin for reduced precision
     os.write((char*) &n1, sizeof(unsigned));
     os.write((char*) &n2, sizeof(unsigned));
     unsigned status, rankt;
@@ -1094,6 +1331,8 @@ private:
                    T* Y, unsigned ldY) const;
   double nrmF2_() const;
   void ltrh_solve_left_(unsigned, T*, unsigned) const;
+  void setPrec_(unsigned);
+  void expandLp_(T*) const;
 };
 
 template<class T>
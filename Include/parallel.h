@@ -45,6 +45,31 @@ extern void mltaGeHVec_MPI(scomp, mblock<scomp>**, scomp*, scomp*,
 			  unsigned, unsigned*, blcluster**);
 extern void mltaHeHVec_MPI(double, mblock<double>**, double*, double*,
 			     unsigned, unsigned*, blcluster**);
+extern void mltaHeHVec_MPI(float, mblock<float>**, float*, float*,
+			     unsigned, unsigned*, blcluster**);
+extern void mltaHeHVec_MPI(dcomp, mblock<dcomp>**, dcomp*, dcomp*,
+			     unsigned, unsigned*, blcluster**);
+extern void mltaHeHVec_MPI(scomp, mblock<scomp>**, scomp*, scomp*,
+			     unsigned, unsigned*, blcluster**);
+
+// MPI datatype and number of its entries for one entry of type T
+inline MPI::Datatype mpitype(double*) { return MPI::DOUBLE; }
+inline MPI::Datatype mpitype(float*) { return MPI::FLOAT; }
+inline MPI::Datatype mpitype(dcomp*) { return MPI::DOUBLE; }
+inline MPI::Datatype mpitype(scomp*) { return MPI::FLOAT; }
+inline unsigned mpilen(double*) { return 1; }
+inline unsigned mpilen(float*) { return 1; }
+inline unsigned mpilen(dcomp*) { return 2; }
+inline unsigned mpilen(scomp*) { return 2; }
+
+extern void rebalanceH_MPI(blcluster**, unsigned*, mblock<double>**&,
+			   bool herm=false, double tol=0.05);
+extern void rebalanceH_MPI(blcluster**, unsigned*, mblock<float>**&,
+			   bool herm=false, double tol=0.05);
+extern void rebalanceH_MPI(blcluster**, unsigned*, mblock<dcomp>**&,
+			   bool herm=false, double tol=0.05);
+extern void rebalanceH_MPI(blcluster**, unsigned*, mblock<scomp>**&,
+			   bool herm=false, double tol=0.05);
 
 #define COUT(X) if (COMM_AHMED.Get_rank()==0) std::cout << X;
 
@@ -1163,7 +1163,8 @@ void createLowRankMatNB_OLD(const double eps, const unsigned m, const unsigned k
   delete [] invY_;
   }*/
 
-// A=U1 V1H, U1 mxk1 V1 nxk1 and B=data, data mxk2xn
+// A=U1 V1H, U1 mxk1 V1 nxk1 and B=U2 V2H, B (U2,V2) with k2 columns;
+// the truncation of A+B is returned in data, which is allocated by new
 template<class T>
 void addLowRankNB(const double eps, const unsigned kgoal, const unsigned m,
                   const unsigned k1, const unsigned k2,
@@ -1173,19 +1174,17 @@ void addLowRankNB(const double eps, const unsigned kgoal, const unsigned m,
                   contLowLevel<T>* haarInfo, 
 		  const T* const X, const unsigned ldX,
                   const T* const Y_, const unsigned ldY_,
-                  unsigned& khat, T*& data)
+                  const T* const B, unsigned& khat, T*& data)
 {
   const unsigned ksum = k1+k2;
   T* Unew = new T[m*ksum];
   T* Vnew = new T[n*ksum];
   for (unsigned i=0; i<k1; i++)
     blas::copy(m,&U1[i*ldU1],&Unew[i*m]);
-  blas::copy(m*k2,data,&Unew[m*k1]);
+  blas::copy(m*k2,B,&Unew[m*k1]);
   for (unsigned i=0; i<k1; i++)
     blas::copy(n,&V1[i*ldV1],&Vnew[i*n]);
-  blas::copy(n*k2,&data[m*k2],&Vnew[n*k1]);
-  delete [] data;
-  data = NULL;
+  blas::copy(n*k2,&B[m*k2],&Vnew[n*k1]);
   createLowRankMatHouseholderNB(eps, kgoal, m, ksum, n, Unew, Vnew, haarInfo,
                                 X, ldX, Y_, ldY_, khat, data);
   delete [] Unew;
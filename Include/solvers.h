@@ -9,6 +9,9 @@
 */
 
 
+#ifndef SOLVERS_H
+#define SOLVERS_H
+
 #include "matrix.h"
 
 extern unsigned GMRes(const Matrix<double>&, double* const, double* const,
@@ -31,6 +34,64 @@ extern unsigned CG(const Matrix<double>&, double* const, double* const,
 extern unsigned CG(const Matrix<dcomp>&, dcomp* const, dcomp* const,
                    double&, unsigned&);
 
+extern unsigned BlockGMRes(const Matrix<double>&, unsigned, double* const,
+                           double* const, double&, const unsigned, unsigned&);
+extern unsigned BlockGMRes(const Matrix<dcomp>&, unsigned, dcomp* const,
+                           dcomp* const, double&, const unsigned, unsigned&);
+
+extern unsigned BlockCG(const Matrix<double>&, unsigned, double* const,
+                        double* const, double&, unsigned&);
+extern unsigned BlockCG(const Matrix<dcomp>&, unsigned, dcomp* const,
+                        dcomp* const, double&, unsigned&);
+
+extern unsigned PipeCG(const Matrix<double>&, double* const, double* const,
+                       double&, unsigned&);
+extern unsigned PipeCG(const Matrix<dcomp>&, dcomp* const, dcomp* const,
+                       double&, unsigned&);
+
+extern unsigned PipeGMRes(const Matrix<double>&, double* const, double* const,
+                          double&, const unsigned, unsigned&);
+extern unsigned PipeGMRes(const Matrix<dcomp>&, dcomp* const, dcomp* const,
+                          double&, const unsigned, unsigned&);
+
+extern unsigned sGMRes(const Matrix<double>&, double* const, double* const,
+                       double&, const unsigned, const unsigned, unsigned&);
+extern unsigned sGMRes(const Matrix<dcomp>&, dcomp* const, dcomp* const,
+                       double&, const unsigned, const unsigned, unsigned&);
+
+// recycled subspace of GCRODR, which is kept between consecutive solves:
+// A M U = C with C^H C = I, where M is the preconditioner. changed() has to
+// be called if A or M has changed since the last solve.
+template<class T> struct RecycleSpace {
+  unsigned n, k;                // dimension, number of vectors
+  T *U, *C;
+  bool valid;                   // C = A M U holds
+
+  RecycleSpace() : n(0), k(0), U(NULL), C(NULL), valid(false) { }
+  ~RecycleSpace() { clear(); }
+
+  void clear() {
+    delete [] U;                // C is stored behind U
+    U = C = NULL;
+    n = k = 0;
+    valid = false;
+  }
+  void changed() { valid = false; }
+  bool empty() const { return k==0; }
+
+private:
+  RecycleSpace(const RecycleSpace&);
+  RecycleSpace& operator=(const RecycleSpace&);
+};
+
+extern unsigned GCRODR(const Matrix<double>&, double* const, double* const,
+                       double&, const unsigned, const unsigned, unsigned&,
+                       RecycleSpace<double>&);
+extern unsigned GCRODR(const Matrix<dcomp>&, dcomp* const, dcomp* const,
+                       double&, const unsigned, const unsigned, unsigned&,
+                       RecycleSpace<dcomp>&);
+
 extern unsigned MinRes(const Matrix<double>&, double* const, double* const,
                        double&, unsigned&);
 
+#endif
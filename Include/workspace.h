@@ -0,0 +1,57 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include "cmplx.h"
+
+//! scratch array for the QR and SVD based truncations of the blocks.
+//! Each thread keeps one array for each type. It grows to the largest size
+//! requested so far and is reused by the subsequent truncations, so that
+//! no memory is allocated during the arithmetic once the largest blocks
+//! have been treated. If the array of the thread is already in use (nested
+//! calls), a temporary array is allocated instead.
+//! The threads of the parallel factorizations and of the parallel assembly
+//! free their arrays at the end of the parallel region (see releaseWork);
+//! otherwise the arrays are kept until release is called.
+template<class T> class mblockWork
+{
+  T* p;
+  bool own;             // p is a temporary array
+
+  mblockWork(const mblockWork&);
+  mblockWork& operator=(const mblockWork&);
+
+public:
+  explicit mblockWork(unsigned long n);
+  ~mblockWork();
+
+  T* ptr() const { return p; }
+
+  //! enlarges the array of the calling thread to n entries
+  static void reserve(unsigned long n);
+
+  //! enlarges the array of the calling thread such that blocks of size
+  //! n1 x n2 can be truncated to rank k (e.g. MAX_RANK)
+  static void reserve(unsigned n1, unsigned n2, unsigned k);
+
+  //! frees the array of the calling thread
+  static void release();
+
+  //! number of entries in the array of the calling thread
+  static unsigned long size();
+};
+
+//! frees the arrays of all types of the calling thread
+extern void releaseWork();
+
+#endif
@@ -64,6 +64,11 @@ unsigned ClusterAlg::isNeighbour(ClusterAlg* const other, unsigned &nnodes0,
   if (this == other) return nbrs_size;
   
   unsigned beg (other->getnbeg()), end (other->getnend());
+#if (defined(VIRTUAL_DEPTH_WEIGHT) || defined(UNWEIGHTED)) && !defined(NEIGHBOUR_SIZE_WEIGHT)
+  // only the existence of an edge is needed, scan the smaller cluster
+  if (end-beg > nend-nbeg) 
+    return other->isNeighbour((ClusterAlg*) this, nnodes1, nnodes0);
+#endif
 #ifdef NEIGHBOUR_SIZE_WEIGHT
   bool *is_ngbr_0 (new bool [nend-nbeg]);
   bool *is_ngbr_1 (new bool [end-beg]);
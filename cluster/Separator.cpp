@@ -81,15 +81,18 @@ void Separator::subdivide(unsigned bmin)
 
 	  nsons = 2;
 	  sons = (cluster**) new ClusterAlg*[nsons];
-	  // constructing child nodes for index cluster tree
-	  sons[0] = new Separator(this, nbeg, isep, op_perm, po_perm,
-				  depth+1, adj_mat, l_adj0);
-	  sons[1] = new Separator(this, isep, nend, op_perm, po_perm,
-				  depth+1, adj_mat, l_adj1);
-	  
-	  // recursive subdivision
-	  ((ClusterAlg*)sons[0])->subdivide(bmin);
-	  ((ClusterAlg*)sons[1])->subdivide(bmin);	  
+	  // constructing child nodes for index cluster tree and recursive
+	  // subdivision, as tasks for large sons (see cluster_alg)
+	  const unsigned beg[3] = { nbeg, isep, nend };
+	  AdjMat* l_adj[2] = { l_adj0, l_adj1 };
+	  for (unsigned k=0; k<nsons; k++) {
+#pragma omp task if (beg[k+1]-beg[k]>=CLTASK_MIN)
+	    {
+	      sons[k] = new Separator(this, beg[k], beg[k+1], op_perm, po_perm,
+				      depth+1, adj_mat, l_adj[k]);
+	      ((ClusterAlg*)sons[k])->subdivide(bmin);
+	    }
+	  }
 	} else {
 	  delete _local_adj_mat;
 	  _local_adj_mat = NULL;
@@ -199,22 +202,40 @@ void Separator::computeNeighbor()
     }
   }
 
-  // get children of the neighbors of father and test neighborhood
+  // get children of the neighbors of father and test neighborhood;
+  // the tests only read the adjacency matrix and are done in parallel if
+  // the clusters are large, the neighbors are added in the same order
   const std::list<Neighbor> previous_neighbours = parent->getNeighbor();
-  std::list<Neighbor>::const_iterator it = previous_neighbours.begin();
-  while (it != previous_neighbours.end()) {
+  std::list<Neighbor>::const_iterator it;
+  unsigned ncand = 0;
+  unsigned long work = 0;
+  for (it=previous_neighbours.begin(); it!=previous_neighbours.end(); ++it)
+    ncand += (*it).ngbr->getns();
+  ClusterAlg** cand = new ClusterAlg*[ncand];
+  unsigned* cut = new unsigned[3*ncand];
+  ncand = 0;
+  for (it=previous_neighbours.begin(); it!=previous_neighbours.end(); ++it) {
     const unsigned ns = (*it).ngbr->getns();
     for (unsigned k=0; k<ns; ++k) {
-      unsigned nnodes0 = 0, nnodes1 = 0;
       ClusterAlg* pk = (ClusterAlg*) (it->ngbr)->getson(k);
-      const unsigned size_edge_cut = isNeighbour(pk, nnodes0, nnodes1);
-      if (size_edge_cut > 0) {
-        addNeighborElement(Neighbor(pk, size_edge_cut, nnodes0));
-        pk->addNeighborElement(Neighbor(this, size_edge_cut, nnodes1));
-      }
+      work += (pk->size()<size()) ? pk->size() : size();
+      cand[ncand++] = pk;
+    }
+  }
+
+#pragma omp parallel for schedule(dynamic) if (work>=CLTASK_MIN)
+  for (int k=0; k<(int) ncand; ++k)
+    cut[3*k] = isNeighbour(cand[k], cut[3*k+1], cut[3*k+2]);
+
+  for (unsigned k=0; k<ncand; ++k) {
+    const unsigned size_edge_cut = cut[3*k];
+    if (size_edge_cut > 0) {
+      addNeighborElement(Neighbor(cand[k], size_edge_cut, cut[3*k+1]));
+      cand[k]->addNeighborElement(Neighbor(this, size_edge_cut, cut[3*k+2]));
     }
-    ++it;
   }
+  delete [] cut;
+  delete [] cand;
 
   for (unsigned k=0; k<nsons; ++k) ((Separator*)sons[k])->computeNeighbor();
 }
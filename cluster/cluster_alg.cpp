@@ -89,25 +89,29 @@ void cluster_alg::subdivide(unsigned bmin)
       nsons = (isep2==nend) ? 2 : 3;
       sons = (cluster**) new ClusterAlg*[nsons];
       
-      // constructing child nodes for index cluster tree
-      sons[0] = (cluster*) new cluster_alg(this, nbeg, isep1, op_perm,
-					   po_perm, depth+1, adj_mat, l_adj0);
-      ((ClusterAlg*) sons[0])->setVirtualDepth(depth+1);
-
-      sons[1] = (cluster*) new cluster_alg(this, isep1, isep2, op_perm,
-					   po_perm, depth+1, adj_mat, l_adj1);
-      ((ClusterAlg*) sons[1])->setVirtualDepth(depth+1);
-
-      if (isep2!=nend) {
-	sons[2] = (cluster*) new Separator(this, isep2, nend, op_perm,
-					   po_perm, depth+1, adj_mat, l_adj2);
-	((ClusterAlg*) sons[2])->setVirtualDepth(depth+1);
+      // constructing child nodes for index cluster tree and continue
+      // recursion; the sons use disjoint parts of op_perm and po_perm, so
+      // large sons (diameter and separator) are computed as OpenMP tasks,
+      // which are completed at the end of the parallel region in
+      // createClusterTree
+      const unsigned beg[4] = { nbeg, isep1, isep2, nend };
+      AdjMat* l_adj[3] = { l_adj0, l_adj1, l_adj2 };
+      for (unsigned k=0; k<nsons; k++) {
+#pragma omp task if (beg[k+1]-beg[k]>=CLTASK_MIN)
+	{
+	  ClusterAlg* son;
+	  if (k<2)
+	    son = new cluster_alg(this, beg[k], beg[k+1], op_perm, po_perm,
+				  depth+1, adj_mat, l_adj[k]);
+	  else
+	    son = new Separator(this, beg[k], beg[k+1], op_perm, po_perm,
+				depth+1, adj_mat, l_adj[k]);
+	  son->setVirtualDepth(depth+1);
+	  sons[k] = (cluster*) son;
+	  son->subdivide(bmin);
+	}
       }
 
-      // continue recursion
-      for (unsigned k=0; k<nsons; k++)
-	((ClusterAlg*) sons[k])->subdivide(bmin);
-
     } else {
       delete _local_adj_mat;
       _local_adj_mat = NULL;
@@ -219,6 +223,8 @@ void cluster_alg::createClusterTree(unsigned bmin, unsigned* aop_perm,
     
   // create cluster tree
   double time = cputime(0.0); // debug
+#pragma omp parallel
+#pragma omp single
   subdivide(bmin);
   time = cputime(time); // debug
   std::cout << "subdivide: " << time << "s." << std::endl; // debug
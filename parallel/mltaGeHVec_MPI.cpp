@@ -12,8 +12,7 @@
 #include <mpi.h>
 #include "mblock.h"
 #include "H.h"
-
-extern MPI::Intracomm COMM_AHMED;
+#include "parallel.h"
 
 static void dimsx_(blcluster** bl, unsigned nbl, unsigned& beg, unsigned& n)
 {
@@ -42,190 +41,99 @@ static void dimsy_(blcluster** bl, unsigned nbl, unsigned& beg, unsigned& n)
 }
 
 
-void mltaGeHVec_MPI(double d, mblock<double>** A, double* x, double* y,
-                   unsigned p, unsigned *seq_part, blcluster** blList)
-{
-  unsigned rank = COMM_AHMED.Get_rank();
-  unsigned info[3];  // nblcks, beg2, n2
-
-  if (rank == 0)
-  {
-
-    for (unsigned j=1; j<p; j++)
-    {
-      info[0] = seq_part[j+1] - seq_part[j];
-      dimsx_(blList+seq_part[j], info[0], info[1], info[2]);
-      COMM_AHMED.Send(info, 3, MPI::UNSIGNED, j, 1);
-      COMM_AHMED.Send(x+info[1], info[2], MPI::DOUBLE, j, 2);
-    }
+// y += d A x, where x and y are held by processor 0 and the blocks of A
+// are distributed according to seq_part. x is broadcast and the
+// contributions of the processors are summed up by a reduction, so that
+// processor 0 neither sends nor adds the parts of the other processors one
+// after the other. If the vectors can be kept distributed, HVecPlan_MPI
+// avoids the global communication.
+// If herm, A is the upper triangular part of a hermitian matrix.
 
-    // compute for processor 0
-    for (unsigned i=seq_part[0]; i<seq_part[1]; ++i)
-    {
-      unsigned idx = i-seq_part[0];
-      A[idx]->mltaVec(d, x+blList[i]->getb2(), y+blList[i]->getb1());
+template<class T> static
+void mltaGeHVec_MPI_(T d, mblock<T>** A, T* x, T* y, unsigned p,
+                     unsigned *seq_part, blcluster** blList, bool herm)
+{
+  const unsigned rank = COMM_AHMED.Get_rank();
+  const MPI::Datatype type = mpitype((T*) NULL);
+  const unsigned L = mpilen((T*) NULL);
+
+  unsigned beg1, n1, beg2, n2;
+  dimsy_(blList+seq_part[0], seq_part[p]-seq_part[0], beg1, n1);
+  dimsx_(blList+seq_part[0], seq_part[p]-seq_part[0], beg2, n2);
+  const unsigned N = MAX(beg1+n1, beg2+n2);
+
+  T* xp = (rank==0) ? x : new T[N];
+  T* tmp = new T[N];
+  assert(xp!=NULL && tmp!=NULL);
+  blas::setzero(N, tmp);
+
+  COMM_AHMED.Bcast(xp, L*N, type, 0);
+
+  if (rank<p)
+    for (unsigned i=seq_part[rank]; i<seq_part[rank+1]; ++i) {
+      const unsigned idx = i-seq_part[rank];
+      const unsigned b1 = blList[i]->getb1(), b2 = blList[i]->getb2();
+      A[idx]->mltaVec(d, xp+b2, tmp+b1);
+      if (herm && blList[i]->isndbl()) A[idx]->mltahVec(d, xp+b1, tmp+b2);
     }
 
-    for (unsigned j=1; j<p; ++j)
-    {
-      unsigned dimsy[2];
-      COMM_AHMED.Recv(dimsy, 2, MPI::UNSIGNED, j, 3);
-
-      double* tmp = new double[dimsy[1]];
-      COMM_AHMED.Recv(tmp, dimsy[1], MPI::DOUBLE, j, 4);
-
-      blas::add(dimsy[1], tmp, y+dimsy[0]);
-
-      delete [] tmp;
-    }
+  if (rank==0) {
+    COMM_AHMED.Reduce(MPI::IN_PLACE, tmp, L*N, type, MPI::SUM, 0);
+    blas::add(N, tmp, y);
+  } else {
+    COMM_AHMED.Reduce(tmp, NULL, L*N, type, MPI::SUM, 0);
+    delete [] xp;
   }
-  else
-  {
-
-    COMM_AHMED.Recv(info, 3, MPI::UNSIGNED, 0, 1);
+  delete [] tmp;
+}
 
-    // receive required part of x
-    double* xp = new double[info[2]];
-    COMM_AHMED.Recv(xp, info[2], MPI::DOUBLE, 0, 2);
 
-    unsigned dimsy[2];
-    dimsy_(blList+seq_part[rank], info[0], dimsy[0], dimsy[1]);
-    double* tmp = new double[dimsy[1]];
-    blas::setzero(dimsy[1], tmp);
+// Instanzen
 
-    for (unsigned i=seq_part[rank]; i<seq_part[rank+1]; ++i)
-    {
-      unsigned idx = i-seq_part[rank];
-      A[idx]->mltaVec(d, xp+blList[i]->getb2()-info[1],
-			tmp+blList[i]->getb1()-dimsy[0]);
-    }
+void mltaGeHVec_MPI(double d, mblock<double>** A, double* x, double* y,
+                    unsigned p, unsigned *seq_part, blcluster** blList)
+{
+  mltaGeHVec_MPI_(d, A, x, y, p, seq_part, blList, false);
+}
 
-    COMM_AHMED.Send(dimsy, 2, MPI::UNSIGNED, 0, 3);
-    COMM_AHMED.Send(tmp, dimsy[1], MPI::DOUBLE, 0, 4);
+void mltaGeHVec_MPI(float d, mblock<float>** A, float* x, float* y,
+                    unsigned p, unsigned *seq_part, blcluster** blList)
+{
+  mltaGeHVec_MPI_(d, A, x, y, p, seq_part, blList, false);
+}
 
-    delete [] tmp;
-    delete [] xp;
-  }
+void mltaGeHVec_MPI(dcomp d, mblock<dcomp>** A, dcomp* x, dcomp* y,
+                    unsigned p, unsigned *seq_part, blcluster** blList)
+{
+  mltaGeHVec_MPI_(d, A, x, y, p, seq_part, blList, false);
 }
 
+void mltaGeHVec_MPI(scomp d, mblock<scomp>** A, scomp* x, scomp* y,
+                    unsigned p, unsigned *seq_part, blcluster** blList)
+{
+  mltaGeHVec_MPI_(d, A, x, y, p, seq_part, blList, false);
+}
 
 void mltaHeHVec_MPI(double d, mblock<double>** A, double* x, double* y,
-                      unsigned p, unsigned *seq_part, blcluster** blList)
+                    unsigned p, unsigned *seq_part, blcluster** blList)
 {
-  unsigned rank = COMM_AHMED.Get_rank();
-  unsigned info[3];  // nblcks, beg2, n2
-
-  if (rank == 0)
-  {
-
-    for (unsigned j=1; j<p; j++)
-    {
-      info[0] = seq_part[j+1] - seq_part[j];
-      dimsx_(blList+seq_part[j], info[0], info[1], info[2]);
-      COMM_AHMED.Send(info, 3, MPI::UNSIGNED, j, 1);
-      COMM_AHMED.Send(x+info[1], info[2], MPI::DOUBLE, j, 2);
-    }
-
-    // compute for processor 0
-    for (unsigned i=seq_part[0]; i<seq_part[1]; ++i)
-    {
-      unsigned idx = i-seq_part[0];
-      A[idx]->mltaVec(d, x+blList[i]->getb2(), y+blList[i]->getb1());
-    }
-
-    for (unsigned j=1; j<p; ++j)
-    {
-      unsigned dimsy[2];
-      COMM_AHMED.Recv(dimsy, 2, MPI::UNSIGNED, j, 3);
-
-      double* tmp = new double[dimsy[1]];
-      COMM_AHMED.Recv(tmp, dimsy[1], MPI::DOUBLE, j, 4);
-
-      blas::add(dimsy[1], tmp, y+dimsy[0]);
-
-      delete [] tmp;
-    }
-
-    // do transposed
-
-    for (unsigned j=1; j<p; j++)
-    {
-      info[0] = seq_part[j+1] - seq_part[j];
-      dimsy_(blList+seq_part[j], info[0], info[1], info[2]);
-      COMM_AHMED.Send(info, 3, MPI::UNSIGNED, j, 5);
-      COMM_AHMED.Send(x+info[1], info[2], MPI::DOUBLE, j, 6);
-    }
-
-    // compute for processor 0
-    for (unsigned i=seq_part[0]; i<seq_part[1]; ++i)
-      if (blList[i]->isndbl())
-      {
-        unsigned idx = i-seq_part[0];
-        A[idx]->mltahVec(d, x+blList[i]->getb1(), y+blList[i]->getb2());
-      }
-
-    for (unsigned j=1; j<p; ++j)
-    {
-      unsigned dimsy[2];
-      COMM_AHMED.Recv(dimsy, 2, MPI::UNSIGNED, j, 7);
-
-      double* tmp = new double[dimsy[1]];
-      COMM_AHMED.Recv(tmp, dimsy[1], MPI::DOUBLE, j, 8);
-
-      blas::add(dimsy[1], tmp, y+dimsy[0]);
-
-      delete [] tmp;
-    }
-  }
-  else
-  {
-    COMM_AHMED.Recv(info, 3, MPI::UNSIGNED, 0, 1);
-
-    // receive required part of x
-    double* xp = new double[info[2]];
-    COMM_AHMED.Recv(xp, info[2], MPI::DOUBLE, 0, 2);
-
-    unsigned dimsy[2];
-    dimsy_(blList+seq_part[rank], info[0], dimsy[0], dimsy[1]);
-    double* tmp = new double[dimsy[1]];
-    blas::setzero(dimsy[1], tmp);
-
-    for (unsigned i=seq_part[rank]; i<seq_part[rank+1]; ++i)
-    {
-      unsigned idx = i-seq_part[rank];
-      A[idx]->mltaVec(d, xp+blList[i]->getb2()-info[1],
-                            tmp+blList[i]->getb1()-dimsy[0]);
-    }
-
-    COMM_AHMED.Send(dimsy, 2, MPI::UNSIGNED, 0, 3);
-    COMM_AHMED.Send(tmp, dimsy[1], MPI::DOUBLE, 0, 4);
-
-    delete [] tmp;
-    delete [] xp;
-
-    // do transposed
-    COMM_AHMED.Recv(info, 3, MPI::UNSIGNED, 0, 5);
-
-    // receive required part of x
-    xp = new double[info[2]];
-    COMM_AHMED.Recv(xp, info[2], MPI::DOUBLE, 0, 6);
-
-    dimsx_(blList+seq_part[rank], info[0], dimsy[0], dimsy[1]);
-    tmp = new double[dimsy[1]];
-    blas::setzero(dimsy[1], tmp);
+  mltaGeHVec_MPI_(d, A, x, y, p, seq_part, blList, true);
+}
 
-    for (unsigned i=seq_part[rank]; i<seq_part[rank+1]; ++i)
-      if (blList[i]->isndbl())
-      {
-        unsigned idx = i-seq_part[rank];
-        A[idx]->mltahVec(d, xp+blList[i]->getb1()-info[1],
-			   tmp+blList[i]->getb2()-dimsy[0]);
-      }
+void mltaHeHVec_MPI(float d, mblock<float>** A, float* x, float* y,
+                    unsigned p, unsigned *seq_part, blcluster** blList)
+{
+  mltaGeHVec_MPI_(d, A, x, y, p, seq_part, blList, true);
+}
 
-    COMM_AHMED.Send(dimsy, 2, MPI::UNSIGNED, 0, 7);
-    COMM_AHMED.Send(tmp, dimsy[1], MPI::DOUBLE, 0, 8);
+void mltaHeHVec_MPI(dcomp d, mblock<dcomp>** A, dcomp* x, dcomp* y,
+                    unsigned p, unsigned *seq_part, blcluster** blList)
+{
+  mltaGeHVec_MPI_(d, A, x, y, p, seq_part, blList, true);
+}
 
-    delete [] tmp;
-    delete [] xp;
-  }
+void mltaHeHVec_MPI(scomp d, mblock<scomp>** A, scomp* x, scomp* y,
+                    unsigned p, unsigned *seq_part, blcluster** blList)
+{
+  mltaGeHVec_MPI_(d, A, x, y, p, seq_part, blList, true);
 }
@@ -9,6 +9,7 @@
 */
 
 
+#include <limits.h>
 #include "blcluster.h"
 #include "basmod.h"
 
@@ -23,15 +24,17 @@ extern void gen_NortonBlSeq(blcluster*, blcluster**&);
 // IEEE Trans. Comp. 44 (11), 1995
 //
 
-static unsigned MaxCostMinPart_(unsigned n, unsigned* cost, unsigned p)
+template<class C> static
+C MaxCostMinPart_(unsigned n, C* cost, unsigned p)
 {
   if (p<2) {
-    unsigned sum = 0;
+    C sum = 0;
     for (unsigned i=0; i<n; ++i) sum += cost[i];
     return sum;
   }
 
-  unsigned j, *g0 = new unsigned[n], *g1 = new unsigned[n];
+  unsigned j;
+  C *g0 = new C[n], *g1 = new C[n];
 
   g0[n-1] = cost[n-1];
   for (unsigned i=n-1; i>=p; i--) g0[i-1] = g0[i] + cost[i-1];
@@ -40,7 +43,7 @@ static unsigned MaxCostMinPart_(unsigned n, unsigned* cost, unsigned p)
 
     g1[n-k] = MAX(cost[n-k], g0[n-k+1]);
     j = n-k;
-    unsigned fij = cost[n-k];
+    C fij = cost[n-k];
 
     for (unsigned i=n-k-1; i+k>=p; --i) {
       fij += cost[i];
@@ -61,7 +64,7 @@ static unsigned MaxCostMinPart_(unsigned n, unsigned* cost, unsigned p)
     swap(g0, g1);
   }
 
-  unsigned max = g0[0];
+  C max = g0[0];
   delete [] g1;
   delete [] g0;
   return max;
@@ -86,29 +89,36 @@ static unsigned cost_symm_default_(blcluster& bl)
     return bl.isadm() ? kavg*(bl.getn1()+bl.getn2()) : bl.getn1()*bl.getn2();
 }
 
+// modelled cost of the matrix-vector product with a block (its storage)
+unsigned cost_storage(blcluster& bl)
+{
+  return cost_default_(bl);
+}
 
-void genBlSeqPart(blcluster* bl, unsigned nproc, blcluster**& BlList,
-                  unsigned*& part, unsigned (*cost_fnct)(blcluster&))
+// modelled cost of the approximation of a block by ACA: k steps with
+// O(k(n1+n2)) operations each
+unsigned cost_ACA(blcluster& bl)
 {
-  unsigned i;
-  // generate block sequence
-  gen_HilbertBlSeq(bl, BlList);
-  //gen_NortonBlSeq(bl, BlList);
+  const unsigned kavg = 10; // average rank
 
-  // compute cost of each block
-  unsigned nbl = bl->nleaves();
-  unsigned* cost = new unsigned[nbl];
-  if (cost_fnct==NULL) cost_fnct = cost_symm_default_;
-  for (i=0; i<nbl; ++i) cost[i] = cost_fnct(*BlList[i]);
+  return bl.isadm() ? kavg*kavg*(bl.getn1()+bl.getn2())
+    : bl.getn1()*bl.getn2();
+}
 
-  const unsigned max = MaxCostMinPart_(nbl, cost, nproc);
+
+// split a sequence of nbl items with the given cost into nproc consecutive
+// parts such that the maximum cost of the parts is minimal;
+// part i consists of the items part[i],...,part[i+1]-1
+template<class C> static
+void genSeqPart_(unsigned nbl, C* cost, unsigned nproc, unsigned* part)
+{
+  const C max = MaxCostMinPart_(nbl, cost, nproc);
 
   // now compute partition using the cost of the maximum interval
-  part = new unsigned[nproc+1];
   part[0] = 0;
 
-  unsigned idx = 1, sum = cost[0];
-  i = 0;
+  unsigned i = 0, idx = 1;
+  C sum = cost[0];
 
   while (idx<nbl) {
     if (sum+cost[idx] <= max) sum += cost[idx];
@@ -119,8 +129,104 @@ void genBlSeqPart(blcluster* bl, unsigned nproc, blcluster**& BlList,
     ++idx;
   }
 
+  // less than nproc intervals may have been required
+  while (i<nproc) part[++i] = nbl;
+}
+
+
+void genSeqPart(unsigned nbl, unsigned long* cost, unsigned nproc,
+                unsigned*& part)
+{
+  assert(nproc>0 && nproc<=nbl);
+  part = new unsigned[nproc+1];
+  genSeqPart_(nbl, cost, nproc, part);
+}
+
+
+// split the block sequence BlList into nproc consecutive parts whose cost
+// does not exceed (1+tol) times the minimal maximum cost. Among the
+// admissible positions, each cut is chosen such that the part ending there
+// touches the smallest ranges of x and y per cost, i.e. the parts are
+// compact and exchange little data in the parallel matrix-vector product.
+// Each part contains at least one item (nproc<=nbl), even if the slack of
+// tol would allow the preceding parts to take all of them.
+template<class C> static
+void genBlSeqPartLoc_(blcluster** BlList, unsigned nbl, C* cost,
+                      unsigned nproc, unsigned* part, double tol)
+{
+  const C max = MaxCostMinPart_(nbl, cost, nproc);
+  const unsigned long long bound = max + (unsigned long long) (tol*max);
+
+  unsigned long long* sum = new unsigned long long[nbl+1];
+  unsigned* need = new unsigned[nbl+1];
+  assert(sum!=NULL && need!=NULL);
+
+  sum[0] = 0;
+  for (unsigned i=0; i<nbl; ++i) sum[i+1] = sum[i] + cost[i];
+
+  // need[c] is the minimal number of parts for the items c,...,nbl-1
+  need[nbl] = 0;
+  for (unsigned c=nbl, e=nbl; c-->0; ) {
+    while (sum[e]-sum[c]>bound) --e;
+    need[c] = need[e] + 1;
+  }
+
+  part[0] = 0;
+  unsigned s = 0;
+  for (unsigned i=1; i<nproc; ++i) {
+    unsigned best = s, beg1 = UINT_MAX, end1 = 0, beg2 = UINT_MAX, end2 = 0;
+    double dbest = 0.0;
+    const unsigned last = nbl-(nproc-i);        // leave one for each part
+    for (unsigned c=s+1; c<=last && sum[c]-sum[s]<=bound; ++c) {
+      blcluster* bl = BlList[c-1];
+      beg1 = MIN(beg1, bl->getb1());
+      end1 = MAX(end1, bl->getb1()+bl->getn1());
+      beg2 = MIN(beg2, bl->getb2());
+      end2 = MAX(end2, bl->getb2()+bl->getn2());
+      if (need[c]>nproc-i) continue;       // the rest would not fit
+
+      const double d = (double) (end1-beg1+end2-beg2) / (sum[c]-sum[s]+1);
+      if (best==s || d<dbest) {
+        best = c;
+        dbest = d;
+      }
+    }
+    part[i] = s = best;
+  }
   part[nproc] = nbl;
 
+  delete [] need;
+  delete [] sum;
+}
+
+
+void genBlSeqPartLoc(blcluster** BlList, unsigned nbl, unsigned long* cost,
+                     unsigned nproc, unsigned*& part, double tol)
+{
+  assert(nproc>0 && nproc<=nbl);
+  part = new unsigned[nproc+1];
+  genBlSeqPartLoc_(BlList, nbl, cost, nproc, part, tol);
+}
+
+
+void genBlSeqPart(blcluster* bl, unsigned nproc, blcluster**& BlList,
+                  unsigned*& part, unsigned (*cost_fnct)(blcluster&),
+                  double tol)
+{
+  unsigned i;
+  // generate block sequence
+  gen_HilbertBlSeq(bl, BlList);
+  //gen_NortonBlSeq(bl, BlList);
+
+  // compute cost of each block
+  unsigned nbl = bl->nleaves();
+  unsigned* cost = new unsigned[nbl];
+  if (cost_fnct==NULL) cost_fnct = cost_symm_default_;
+  for (i=0; i<nbl; ++i) cost[i] = cost_fnct(*BlList[i]);
+
+  part = new unsigned[nproc+1];
+  genBlSeqPartLoc_(BlList, nbl, cost, nproc, part, tol);
+
   /*
   std::cout << "genBlSeqPart: ";
   for (unsigned i=0; i<nproc; ++i) {
@@ -143,4 +249,3 @@ void genBlSeqPart(blcluster* bl, unsigned nproc, blcluster**& BlList,
 
   delete [] cost;
 }
-
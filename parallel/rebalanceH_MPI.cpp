@@ -0,0 +1,192 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#include <mpi.h>
+#include "mblock.h"
+#include "H.h"
+#include "parallel.h"
+
+// Redistributes the blocks of an H-matrix over the processors according to
+// their present cost, e.g. after a recompression has changed the ranks.
+// blList is the block sequence (see gen_BlSequence) the partition seq_part
+// refers to, A contains the blocks blList[seq_part[rank]],...,
+// blList[seq_part[rank+1]-1] of this processor. The cost of a block is the
+// number of its stored entries (twice for off-diagonal blocks if herm, since
+// they are also applied in transposed form). The new partition is computed
+// by genBlSeqPartLoc with tolerance tol; seq_part and A are overwritten with
+// the new partition and the new blocks of this processor. Only blocks whose
+// owner changes are sent.
+
+enum { TAG_HDR = 31, TAG_DATA = 32 };
+
+// the entries are sent in chunks of at most CHUNK bytes, since the counts
+// of MPI are of type int
+static const unsigned long CHUNK = 1ul<<30;
+
+static unsigned nchunks_(unsigned long bytes)
+{
+  return (unsigned) ((bytes+CHUNK-1)/CHUNK);
+}
+
+// number of entries of a block with header h (see below)
+static unsigned long nvals_(const unsigned* h)
+{
+  if (h[2]==0) return (unsigned long) h[3]*(h[0]+h[1]);
+  if (h[2]==4) return (unsigned long) h[0]*h[1];
+  return (unsigned long) h[0]*(h[0]+1)/2;
+}
+
+// creates a block from the header h = {n1, n2, status, rank, prec} and the
+// entries p in precision prec
+template<class T> static mblock<T>* recvBlock_(const unsigned* h, void* p)
+{
+  mblock<T>* mbl = new mblock<T>(h[0], h[1]);
+  assert(mbl!=NULL);
+  if (h[4]) {
+    mbl->attach(h[2], h[3], h[4], p);
+    mbl->setPrec(0);                   // takes a copy
+    mbl->setPrec(h[4]);
+  } else {
+    T* A = (T*) p;
+    switch (h[2]) {
+    case 0: mbl->cpyLrM(h[3], A, A+h[3]*h[0]); break;
+    case 1: mbl->cpyHeM(A); break;
+    case 2: mbl->cpyLtM(A); break;
+    case 3: mbl->cpyUtM(A); break;
+    case 5: mbl->cpySyM(A); break;
+    default: mbl->cpyGeM(A);
+    }
+  }
+  return mbl;
+}
+
+template<class T> static
+void rebalanceH_MPI_(blcluster** blList, unsigned* seq_part,
+                     mblock<T>**& A, bool herm, double tol)
+{
+  const unsigned rank = COMM_AHMED.Get_rank(),
+    nproc = COMM_AHMED.Get_size();
+  assert(seq_part[0]==0);
+  const unsigned nbl = seq_part[nproc];
+  const unsigned beg = seq_part[rank], n = seq_part[rank+1]-beg;
+
+  // the cost of all blocks
+  unsigned long* cost = new unsigned long[nbl];
+  unsigned long* mycost = new unsigned long[n+1];
+  int *cnts = new int[2*nproc], *displs = cnts+nproc;
+  assert(cost!=NULL && mycost!=NULL && cnts!=NULL);
+  for (unsigned i=0; i<n; ++i) {
+    mycost[i] = A[i]->nvals() + 1;
+    if (herm && blList[beg+i]->isndbl()) mycost[i] *= 2;
+  }
+  for (unsigned q=0; q<nproc; ++q) {
+    cnts[q] = seq_part[q+1] - seq_part[q];
+    displs[q] = seq_part[q];
+  }
+  COMM_AHMED.Allgatherv(mycost, n, MPI::UNSIGNED_LONG, cost, cnts, displs,
+                        MPI::UNSIGNED_LONG);
+  delete [] cnts;
+  delete [] mycost;
+
+  unsigned* part;
+  genBlSeqPartLoc(blList, nbl, cost, nproc, part, tol);
+  delete [] cost;
+
+  // keep the blocks which remain on this processor
+  const unsigned nbeg = part[rank], nn = part[rank+1]-nbeg;
+  mblock<T>** B;
+  allocmbls(nn, B);
+  for (unsigned i=MAX(beg, nbeg); i<MIN(beg+n, nbeg+nn); ++i) {
+    B[i-nbeg] = A[i-beg];
+    A[i-beg] = NULL;
+  }
+
+  // send the others to their new owners
+  unsigned nreq = 0, q = 0;
+  for (unsigned i=0; i<n; ++i)
+    if (A[i]!=NULL)
+      nreq += 1 + nchunks_(A[i]->nvals()*
+                           mblock<T>::bytesPrec(A[i]->getPrec()));
+  unsigned* hdr = new unsigned[5*n+1];
+  MPI::Request* req = new MPI::Request[nreq+1];
+  assert(hdr!=NULL && req!=NULL);
+  nreq = 0;
+  for (unsigned i=beg; i<beg+n; ++i) {
+    mblock<T>* mbl = A[i-beg];
+    if (mbl==NULL) continue;
+    while (part[q+1]<=i) ++q;
+    unsigned* h = hdr + 5*(i-beg);
+    h[0] = mbl->getn1();
+    h[1] = mbl->getn2();
+    h[2] = mbl->status();
+    h[3] = mbl->isLrM() ? mbl->rank() : 0;
+    h[4] = mbl->getPrec();
+    req[nreq++] = COMM_AHMED.Isend(h, 5, MPI::UNSIGNED, q, TAG_HDR);
+    const unsigned long bytes = mbl->nvals()*mblock<T>::bytesPrec(h[4]);
+    const char* p = (const char*) mbl->storage();
+    for (unsigned long k=0; k<bytes; k+=CHUNK)
+      req[nreq++] = COMM_AHMED.Isend(p+k, (int) MIN(CHUNK, bytes-k),
+                                     MPI::BYTE, q, TAG_DATA);
+  }
+
+  // receive the new blocks in the order they are sent
+  q = 0;
+  for (unsigned i=nbeg; i<nbeg+nn; ++i) {
+    if (B[i-nbeg]!=NULL) continue;
+    while (seq_part[q+1]<=i) ++q;
+    unsigned h[5];
+    COMM_AHMED.Recv(h, 5, MPI::UNSIGNED, q, TAG_HDR);
+    const unsigned long bytes = nvals_(h)*mblock<T>::bytesPrec(h[4]);
+    char* p = new char[bytes+1];
+    assert(p!=NULL);
+    for (unsigned long k=0; k<bytes; k+=CHUNK)
+      COMM_AHMED.Recv(p+k, (int) MIN(CHUNK, bytes-k), MPI::BYTE, q,
+                      TAG_DATA);
+    B[i-nbeg] = recvBlock_<T>(h, p);
+    delete [] p;
+  }
+
+  MPI::Request::Waitall(nreq, req);
+  delete [] req;
+  delete [] hdr;
+
+  freembls(n, A);
+  A = B;
+  for (unsigned j=0; j<=nproc; ++j) seq_part[j] = part[j];
+  delete [] part;
+}
+
+
+// Instanzen
+
+void rebalanceH_MPI(blcluster** blList, unsigned* seq_part,
+                    mblock<double>**& A, bool herm, double tol)
+{
+  rebalanceH_MPI_(blList, seq_part, A, herm, tol);
+}
+
+void rebalanceH_MPI(blcluster** blList, unsigned* seq_part,
+                    mblock<float>**& A, bool herm, double tol)
+{
+  rebalanceH_MPI_(blList, seq_part, A, herm, tol);
+}
+
+void rebalanceH_MPI(blcluster** blList, unsigned* seq_part,
+                    mblock<dcomp>**& A, bool herm, double tol)
+{
+  rebalanceH_MPI_(blList, seq_part, A, herm, tol);
+}
+
+void rebalanceH_MPI(blcluster** blList, unsigned* seq_part,
+                    mblock<scomp>**& A, bool herm, double tol)
+{
+  rebalanceH_MPI_(blList, seq_part, A, herm, tol);
+}
@@ -0,0 +1,217 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#include <cmath>
+#include <algorithm>
+#include "matrix.h"
+#include "blas.h"
+
+// BlockCG solves the hermitian positive definite linear systems AX=B
+// with p right-hand sides using the block Conjugate Gradient method
+// (D.P. O'Leary, Linear Algebra Appl. 29, 1980) in its breakdown-free form
+// (H. Ji, Y. Li, Numer. Algorithms 74, 2017): the search directions are
+// orthonormalized and linearly dependent directions are dropped.
+// All active systems are advanced by a single product with A per step.
+// Columns which have converged are removed from the block.
+//
+// B and X are N x p with leading dimension N (N=A.n).
+//
+// The return value indicates convergence of all columns within nsteps
+// (input) iterations (0), or no convergence within nsteps iterations (1).
+//
+// Upon successful return, output arguments have the following values:
+//
+//      X  --  approximate solution to AX = B
+// nsteps  --  the number of iterations performed before the
+//             tolerance was reached
+//    eps  --  the maximum relative residual after the final iteration
+
+
+// solve the m x m system M Y = R (p columns) using Gaussian elimination
+// with partial pivoting, M is overwritten; returns false if M is singular
+template<class T> static
+bool gesolve_(unsigned m, T* M, unsigned p, T* R)
+{
+  double nrmM = 0.0;
+  for (unsigned i=0; i<m*m; ++i) nrmM = MAX(nrmM, abs2(M[i]));
+
+  for (unsigned k=0; k<m; ++k) {
+    unsigned piv = k;
+    for (unsigned i=k+1; i<m; ++i)
+      if (abs2(M[i+k*m])>abs2(M[piv+k*m])) piv = i;
+    if (abs2(M[piv+k*m])<=D_PREC*D_PREC*nrmM) return false;
+
+    if (piv!=k) {
+      for (unsigned j=0; j<m; ++j) std::swap(M[k+j*m], M[piv+j*m]);
+      for (unsigned j=0; j<p; ++j) std::swap(R[k+j*m], R[piv+j*m]);
+    }
+
+    for (unsigned i=k+1; i<m; ++i) {
+      const T e = M[i+k*m] / M[k+k*m];
+      for (unsigned j=k+1; j<m; ++j) M[i+j*m] -= e * M[k+j*m];
+      for (unsigned j=0; j<p; ++j) R[i+j*m] -= e * R[k+j*m];
+    }
+  }
+
+  for (unsigned j=0; j<p; ++j)
+    for (unsigned k=m; k-->0; ) {
+      T e = R[k+j*m];
+      for (unsigned i=k+1; i<m; ++i) e -= M[k+i*m] * R[i+j*m];
+      R[k+j*m] = e / M[k+k*m];
+    }
+
+  return true;
+}
+
+
+// orthonormalize the m columns of P by modified Gram-Schmidt (twice);
+// columns which are linearly dependent on the previous ones are dropped,
+// the number of remaining columns is returned
+template<class T> static
+unsigned orth_(unsigned N, unsigned m, T* P)
+{
+  unsigned r = 0;
+  for (unsigned j=0; j<m; ++j) {
+    T* pj = P + j*N;
+    const double nrm0 = blas::nrm2(N, pj);
+    for (unsigned s=0; s<2; ++s)
+      for (unsigned i=0; i<r; ++i)
+        blas::axpy(N, -blas::scpr(N, P+i*N, pj), P+i*N, pj);
+
+    const double nrm = blas::nrm2(N, pj);
+    if (nrm>1e6*D_PREC*nrm0) {
+      blas::scal(N, (T) (1.0/nrm), pj);
+      if (r<j) blas::copy(N, pj, P+r*N);
+      ++r;
+    }
+  }
+  return r;
+}
+
+
+template<class T> static
+unsigned BlockCG_(const Matrix<T>& A, unsigned p, T* const B, T* const X,
+                  double& eps, unsigned& nsteps)
+{
+  const unsigned N = A.n;
+  unsigned j, k, m = 0;
+  double maxres = 0.0;
+
+  double* nrmb = new double[p];
+  unsigned* idx = new unsigned[p];                 // active columns
+  T *R = new T[5*N*p], *Xa = R + N*p, *P = Xa + N*p, *Q = P + N*p,
+    *Z = Q + N*p;
+  T *alpha = new T[3*p*p], *PQ = alpha + p*p, *M = PQ + p*p;
+  assert(nrmb!=NULL && idx!=NULL && R!=NULL && alpha!=NULL);
+
+  // R = B - AX
+  blas::copy(N*p, B, R);
+  A.amuxGeM((T) -1.0, p, X, N, R, N);
+
+  for (j=0; j<p; ++j) {
+    nrmb[j] = blas::nrm2(N, B+j*N);
+    if (nrmb[j]<D_PREC) {
+      blas::setzero(N, X+j*N);
+      continue;
+    }
+    const double res = blas::nrm2(N, R+j*N)/nrmb[j];
+    if (res>eps) {
+      blas::copy(N, R+j*N, R+m*N);
+      blas::copy(N, X+j*N, Xa+m*N);
+      idx[m++] = j;
+    } else maxres = MAX(maxres, res);
+  }
+
+  // P = orth(C R)
+  blas::copy(N*m, R, P);
+  A.precond_applyGeM(m, P, N);
+  unsigned r = orth_(N, m, P);
+
+  unsigned l = 0;
+  while (m>0 && r>0 && l<nsteps) {
+    ++l;
+
+    // Q = AP, PQ = P^H Q
+    blas::setzero(N*r, Q);
+    A.amuxGeM((T) 1.0, r, P, N, Q, N);
+    blas::gemhm(N, r, r, (T) 1.0, P, N, Q, N, PQ, r);
+
+    // alpha = PQ^{-1} P^H R
+    blas::gemhm(N, r, m, (T) 1.0, P, N, R, N, alpha, r);
+    blas::copy(r*r, PQ, M);
+    if (!gesolve_(r, M, m, alpha)) break;
+
+    // X += P alpha, R -= Q alpha
+    blas::gemma(N, r, m, (T) 1.0, P, N, alpha, r, Xa, N);
+    blas::gemma(N, r, m, (T) -1.0, Q, N, alpha, r, R, N);
+
+    // remove converged columns
+    unsigned mnew = 0;
+    for (k=0; k<m; ++k) {
+      const double res = blas::nrm2(N, R+k*N)/nrmb[idx[k]];
+      if (res<=eps) {
+        blas::copy(N, Xa+k*N, X+idx[k]*N);
+        maxres = MAX(maxres, res);
+      } else {
+        if (mnew<k) {
+          blas::copy(N, R+k*N, R+mnew*N);
+          blas::copy(N, Xa+k*N, Xa+mnew*N);
+          idx[mnew] = idx[k];
+        }
+        ++mnew;
+      }
+    }
+    m = mnew;
+
+#ifndef NDEBUG
+    std::cout << "Step " << l << ", active columns=" << m << std::endl;
+#endif
+
+    if (m==0) break;
+
+    // Z = C R, beta = PQ^{-1} Q^H Z, P = orth(Z - P beta)
+    blas::copy(N*m, R, Z);
+    A.precond_applyGeM(m, Z, N);
+    blas::gemhm(N, r, m, (T) 1.0, Q, N, Z, N, alpha, r);
+    if (!gesolve_(r, PQ, m, alpha)) break;
+    blas::gemma(N, r, m, (T) -1.0, P, N, alpha, r, Z, N);
+    blas::copy(N*m, Z, P);
+    r = orth_(N, m, P);
+  }
+
+  // unconverged columns
+  for (k=0; k<m; ++k) {
+    blas::copy(N, Xa+k*N, X+idx[k]*N);
+    maxres = MAX(maxres, blas::nrm2(N, R+k*N)/nrmb[idx[k]]);
+  }
+
+  eps = maxres;
+  nsteps = l;
+
+  delete [] alpha;
+  delete [] R;
+  delete [] idx;
+  delete [] nrmb;
+  return (m>0) ? 1 : 0;
+}
+
+
+unsigned BlockCG(const Matrix<double>& A, unsigned p, double* const B,
+                 double* const X, double& eps, unsigned& nsteps)
+{
+  return BlockCG_(A, p, B, X, eps, nsteps);
+}
+
+unsigned BlockCG(const Matrix<dcomp>& A, unsigned p, dcomp* const B,
+                 dcomp* const X, double& eps, unsigned& nsteps)
+{
+  return BlockCG_(A, p, B, X, eps, nsteps);
+}
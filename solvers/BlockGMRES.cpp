@@ -0,0 +1,242 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+//*****************************************************************
+// Iterative template routine -- block GMRES
+//
+// BlockGMRes solves the unsymmetric linear systems AX = B with p
+// right-hand sides using the block Generalized Minimum Residual method
+// with restart after m block steps. All active systems are advanced by a
+// single product with A per step. Columns which have converged are removed
+// from the block at the next restart.
+//
+// B and X are N x p with leading dimension N (N=A.n).
+//
+// The return value indicates convergence of all columns within nsteps
+// (input) iterations (0), or no convergence within nsteps iterations or a
+// failure of LAPACK (1).
+//
+// Upon successful return, output arguments have the following values:
+//
+//      X  --  approximate solution to AX = B
+// nsteps  --  the number of iterations performed before the
+//             tolerance was reached
+//    eps  --  the maximum relative residual after the final iteration
+//
+//*****************************************************************
+#include <cmath>
+#include "blas.h"
+#include "matrix.h"
+
+// orthonormalize the k columns of W, the triangular factor is stored in S
+// regular is set to false if W is (numerically) rank deficient
+// returns false if LAPACK fails
+template<class T> static
+bool qr_(unsigned N, unsigned k, T* W, T* S, unsigned ldS, T* tau,
+         unsigned nwk, T* wk, bool& regular)
+{
+  double nrmW = 0.0;
+  for (unsigned j=0; j<k; ++j) nrmW = MAX(nrmW, blas::nrm2(N, W+j*N));
+
+  if (blas::geqrf(N, k, W, tau, nwk, wk)!=0) return false;
+
+  regular = true;
+  for (unsigned j=0; j<k; ++j) {
+    for (unsigned i=0; i<=j; ++i) S[i+j*ldS] = W[i+j*N];
+    for (unsigned i=j+1; i<k; ++i) S[i+j*ldS] = (T) 0.0;
+    if (abs2(W[j+j*N])<=D_PREC*D_PREC*nrmW*nrmW) regular = false;
+  }
+
+  return blas::orgqr(N, k, W, tau, nwk, wk)==0;
+}
+
+// solve the least squares problem min |G - H Y| with the ((i+1)k) x (ik)
+// block Hessenberg matrix H; G is overwritten with Q^H G, i.e. the norms
+// of the last k rows are the residual norms; H is overwritten with R
+// returns false if LAPACK fails
+template<class T> static
+bool lsq_(unsigned n1, unsigned n2, T* H, unsigned ldH, unsigned k, T* G,
+          unsigned ldG, T* tau, unsigned nwk, T* wk)
+{
+  return blas::geqrf(n1, n2, H, ldH, tau, nwk, wk)==0
+    && blas::ormqrh(n1, k, n2, H, ldH, tau, G, ldG, nwk, wk)==0;
+}
+
+// back substitution R Y = G for the upper n x n part of H
+template<class T> static
+void utrsolve_(unsigned n, T* H, unsigned ldH, unsigned k, T* G,
+               unsigned ldG)
+{
+  for (unsigned j=0; j<k; ++j)
+    for (unsigned l=n; l-->0; ) {
+      T e = G[l+j*ldG];
+      for (unsigned i=l+1; i<n; ++i) e -= H[l+i*ldH] * G[i+j*ldG];
+      G[l+j*ldG] = (abs2(H[l+l*ldH])>0.0) ? e / H[l+l*ldH] : (T) 0.0;
+    }
+}
+
+template<class T> static
+unsigned BlockGMRes_(const Matrix<T>& A, unsigned p, T* const B, T* const X,
+                     double& eps, const unsigned m, unsigned& nsteps)
+{
+  const unsigned N = A.n, ldH = (m+1)*p;
+  unsigned i, j, k = 0, l = 0;
+  double maxres = 0.0;
+  bool failed = false;                             // LAPACK failed
+
+  double* nrmb = new double[p];
+  unsigned* idx = new unsigned[p];                 // active columns
+  T *V = new T[N*((m+1)*p+2*p)];                   // N x (m+1)p
+  T *Xa = V + N*(m+1)*p, *W = Xa + N*p;            // N x p
+  T *H = new T[ldH*(2*m+3)*p];                    // (m+1)p x mp
+  T *Hc = H + ldH*m*p;                             // (m+1)p x (m+1)p
+  T *G = Hc + ldH*(m+1)*p;                         // (m+1)p x p
+  T *Y = G + ldH*p;                                // mp x p
+  const unsigned nwk = 64*ldH;
+  T *tau = new T[ldH+nwk], *wk = tau + ldH;
+  assert(nrmb!=NULL && idx!=NULL && V!=NULL && H!=NULL && tau!=NULL);
+
+  for (j=0; j<p; ++j) {
+    nrmb[j] = blas::nrm2(N, B+j*N);
+    if (nrmb[j]<D_PREC) blas::setzero(N, X+j*N);
+    else {
+      blas::copy(N, X+j*N, Xa+k*N);
+      idx[k++] = j;
+    }
+  }
+
+  while (k>0) {
+
+    // R = B - AX for the active columns, stored in V_0
+    for (j=0; j<k; ++j) blas::copy(N, B+idx[j]*N, V+j*N);
+    A.amuxGeM((T) -1.0, k, Xa, N, V, N);
+
+    // remove converged columns
+    unsigned knew = 0;
+    for (j=0; j<k; ++j) {
+      const double res = blas::nrm2(N, V+j*N)/nrmb[idx[j]];
+      if (res<=eps) {
+        blas::copy(N, Xa+j*N, X+idx[j]*N);
+        maxres = MAX(maxres, res);
+      } else {
+        if (knew<j) {
+          blas::copy(N, V+j*N, V+knew*N);
+          blas::copy(N, Xa+j*N, Xa+knew*N);
+          idx[knew] = idx[j];
+        }
+        ++knew;
+      }
+    }
+    k = knew;
+    if (k==0 || l>=nsteps) break;
+
+    // V_0 S = R
+    bool regular;
+    blas::setzero(ldH*k, G);
+    if (!qr_(N, k, V, G, ldH, tau, nwk, wk, regular)) {
+      failed = true;
+      break;
+    }
+    blas::setzero(ldH*m*k, H);
+
+    bool conv = false;
+    unsigned ni = 0;
+    for (i=0; i<m && l<nsteps && !conv; ++i) {
+      ++l;
+      T *Vi = V + i*k*N, *Vn = Vi + k*N;
+
+      // V_{i+1} = A M V_i
+      blas::copy(N*k, Vi, W);
+      A.precond_applyGeM(k, W, N);
+      blas::setzero(N*k, Vn);
+      A.amuxGeM((T) 1.0, k, W, N, Vn, N);
+
+      // block Gram-Schmidt (twice)
+      for (unsigned r=0; r<2; ++r) {
+        blas::gemhm(N, (i+1)*k, k, (T) 1.0, V, N, Vn, N, Hc, (i+1)*k);
+        blas::gemma(N, (i+1)*k, k, (T) -1.0, V, N, Hc, (i+1)*k, Vn, N);
+        for (j=0; j<k; ++j)
+          blas::add((i+1)*k, Hc+j*(i+1)*k, H+(i*k+j)*ldH);
+      }
+
+      if (!qr_(N, k, Vn, H+(i+1)*k+i*k*ldH, ldH, tau, nwk, wk, regular)) {
+        failed = true;
+        break;
+      }
+
+      // least squares problem
+      const unsigned n1 = (i+2)*k, n2 = (i+1)*k;
+      for (j=0; j<n2; ++j) blas::copy(n1, H+j*ldH, Hc+j*ldH);
+      for (j=0; j<k; ++j) blas::copy(n1, G+j*ldH, Hc+(n2+j)*ldH);
+      if (!lsq_(n1, n2, Hc, ldH, k, Hc+n2*ldH, ldH, tau, nwk, wk)) {
+        failed = true;
+        break;
+      }
+
+      // Y is kept for the update if a later step fails
+      for (j=0; j<k; ++j) blas::copy(n2, Hc+(n2+j)*ldH, Y+j*ldH);
+      utrsolve_(n2, Hc, ldH, k, Y, ldH);
+      ni = i+1;
+
+      double res = 0.0;
+      for (j=0; j<k; ++j)
+        res = MAX(res, blas::nrm2(k, Hc+n2+(n2+j)*ldH)/nrmb[idx[j]]);
+
+#ifndef NDEBUG
+      std::cout << "Step " << l << ", resid=" << res << std::endl;
+#endif
+
+      if (res<=eps || !regular) conv = true;
+    }
+
+    // X += M V Y
+    blas::setzero(N*k, W);
+    blas::gemma(N, ni*k, k, (T) 1.0, V, N, Y, ldH, W, N);
+    A.precond_applyGeM(k, W, N);
+    blas::add(N*k, W, Xa);
+    if (failed) break;
+  }
+
+  // unconverged columns
+  if (failed) {
+    for (j=0; j<k; ++j) blas::copy(N, B+idx[j]*N, V+j*N);
+    A.amuxGeM((T) -1.0, k, Xa, N, V, N);
+  }
+  for (j=0; j<k; ++j) {
+    blas::copy(N, Xa+j*N, X+idx[j]*N);
+    maxres = MAX(maxres, blas::nrm2(N, V+j*N)/nrmb[idx[j]]);
+  }
+
+  eps = maxres;
+  nsteps = l;
+
+  delete [] tau;
+  delete [] H;
+  delete [] V;
+  delete [] idx;
+  delete [] nrmb;
+  return (k>0) ? 1 : 0;
+}
+
+
+unsigned BlockGMRes(const Matrix<double>& A, unsigned p, double* const B,
+                    double* const X, double& eps, const unsigned m,
+                    unsigned& nsteps)
+{
+  return BlockGMRes_(A, p, B, X, eps, m, nsteps);
+}
+
+unsigned BlockGMRes(const Matrix<dcomp>& A, unsigned p, dcomp* const B,
+                    dcomp* const X, double& eps, const unsigned m,
+                    unsigned& nsteps)
+{
+  return BlockGMRes_(A, p, B, X, eps, m, nsteps);
+}
@@ -0,0 +1,419 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+//*****************************************************************
+// Iterative template routine -- GCRO-DR
+//
+// GCRODR solves the unsymmetric linear system Ax = b using GMRES with
+// deflated restarting and subspace recycling (M.L. Parks, E. de Sturler,
+// G. Mackey, D.D. Johnson, S. Maiti, SIAM J. Sci. Comput. 28, 2006) with
+// right preconditioning. Each cycle of at most m steps keeps the
+// harmonic Ritz vectors of A M belonging to the k eigenvalues of smallest
+// modulus and continues with m-k Arnoldi steps on the orthogonal
+// complement of their images. The space Y (see solvers.h) is kept between
+// calls, so that a sequence of related systems (e.g. a frequency sweep)
+// starts with the space of the previous solve. If A or the preconditioner
+// has changed, Y.changed() has to be called before; the images are then
+// recomputed with k products. Passing a new (empty) space in each call
+// results in deflated restarting within the single run.
+// All inner products are summed up by A.sum_start, so the routine can also
+// be applied to distributed vectors (see HMatrix_MPI).
+//
+// The return value indicates convergence within nsteps (input)
+// iterations (0), or no convergence within nsteps iterations or a failure
+// of LAPACK (1). If LAPACK fails while the recycled space is updated, the
+// previous space is kept.
+//
+// Upon successful return, output arguments have the following values:
+//
+//      x  --  approximate solution to Ax = b
+// nsteps  --  the number of iterations performed before the
+//             tolerance was reached
+//    eps  --  the residual after the final iteration
+//
+//*****************************************************************
+#include <cmath>
+#include "blas.h"
+#include "matrix.h"
+#include "solvers.h"
+
+// |v| summed up over all processors
+template<class T> static
+double nrm2_(const Matrix<T>& A, unsigned N, T* v)
+{
+  T t = blas::scpr(N, v, v);
+  A.sum_start(1, &t);
+  A.sum_wait();
+  return sqrt(Re(t));
+}
+
+// solve the least squares problem min |g - H y| with the (n+1) x n
+// matrix H; g is overwritten with Q^H g, i.e. |g_n| is the residual norm;
+// H is overwritten with R; returns false if LAPACK fails
+template<class T> static
+bool lsq_(unsigned n, T* H, unsigned ldH, T* g, T* tau, unsigned nwk, T* wk)
+{
+  return blas::geqrf(n+1, n, H, ldH, tau, nwk, wk)==0
+    && blas::ormqrh(n+1, 1, n, H, ldH, tau, g, n+1, nwk, wk)==0;
+}
+
+// back substitution R y = g for the upper n x n part of H
+template<class T> static
+void utrsolve_(unsigned n, T* H, unsigned ldH, T* g)
+{
+  for (unsigned l=n; l-->0; ) {
+    T e = g[l];
+    for (unsigned i=l+1; i<n; ++i) e -= H[l+i*ldH] * g[i];
+    g[l] = (abs2(H[l+l*ldH])>0.0) ? e / H[l+l*ldH] : (T) 0.0;
+  }
+}
+
+// X = X R^{-1} for the N x k matrix X and the upper triangular R
+template<class T> static
+void rtrsolve_(unsigned N, unsigned k, T* X, T* R, unsigned ldR)
+{
+  for (unsigned i=0; i<k; ++i) {
+    T* xi = X + i*N;
+    for (unsigned l=0; l<i; ++l) blas::axpy(N, -R[l+i*ldR], X+l*N, xi);
+    blas::scal(N, (T) 1.0/R[i+i*ldR], xi);
+  }
+}
+
+// sort the indices idx by increasing th
+static void sort_(unsigned n, double* th, unsigned* idx)
+{
+  for (unsigned i=0; i<n; ++i) idx[i] = i;
+  for (unsigned i=1; i<n; ++i) {
+    const unsigned e = idx[i];
+    unsigned l = i;
+    for (; l>0 && th[idx[l-1]]>th[e]; --l) idx[l] = idx[l-1];
+    idx[l] = e;
+  }
+}
+
+// the eigenvectors of Ae v = theta Be v (n x n) belonging to the k values
+// theta of smallest modulus are stored in P (n x k'), k' is returned;
+// in the real case the real and imaginary part of a complex eigenvector
+// are taken, so k' may be k+1 (but not larger than n-1)
+static unsigned harmRitz_(unsigned n, double* Ae, double* Be, unsigned k,
+                          double* P)
+{
+  const unsigned nwk = 16*n;
+  double *ar = new double[4*n+n*n+nwk], *ai = ar + n, *be = ai + n,
+    *th = be + n, *VR = th + n, *wk = VR + n*n;
+  unsigned* idx = new unsigned[n];
+  assert(ar!=NULL && idx!=NULL);
+
+  unsigned kk = 0;
+  if (blas::ggev(n, Ae, Be, ar, ai, be, VR, nwk, wk)==0) {
+    for (unsigned i=0; i<n; ++i)
+      th[i] = (be[i]!=0.0) ? sqrt(ar[i]*ar[i]+ai[i]*ai[i])/fabs(be[i])
+        : HUGE_VAL;
+    sort_(n, th, idx);
+
+    for (unsigned l=0; l<n && kk<k; ++l) {
+      const unsigned i = idx[l];
+      if (ai[i]==0.0) blas::copy(n, VR+i*n, P+(kk++)*n);
+      else if (ai[i]>0.0) {                // pair i, i+1
+        if (kk+2>k+1 || kk+2>n-1) break;
+        blas::copy(2*n, VR+i*n, P+kk*n);
+        kk += 2;
+      }
+      // the second of a pair is taken with the first, whose modulus is equal
+    }
+  }
+
+  delete [] idx;
+  delete [] ar;
+  return kk;
+}
+
+static unsigned harmRitz_(unsigned n, dcomp* Ae, dcomp* Be, unsigned k,
+                          dcomp* P)
+{
+  const unsigned nwk = 16*n;
+  dcomp *al = new dcomp[2*n+n*n+nwk], *be = al + n, *VR = be + n,
+    *wk = VR + n*n;
+  double* th = new double[n];
+  unsigned* idx = new unsigned[n];
+  assert(al!=NULL && th!=NULL && idx!=NULL);
+
+  unsigned kk = 0;
+  if (blas::ggev(n, Ae, Be, al, be, VR, nwk, wk)==0) {
+    for (unsigned i=0; i<n; ++i)
+      th[i] = (abs2(be[i])>0.0) ? abs(al[i])/abs(be[i]) : HUGE_VAL;
+    sort_(n, th, idx);
+    for (kk=0; kk<k && kk<n; ++kk) blas::copy(n, VR+idx[kk]*n, P+kk*n);
+  }
+
+  delete [] idx;
+  delete [] th;
+  delete [] al;
+  return kk;
+}
+
+// recompute C = A M U after A or M has changed: C is orthonormalized and U
+// is transformed accordingly; linearly dependent columns are removed
+template<class T> static
+void recompute_(const Matrix<T>& A, RecycleSpace<T>& Y, T* xh, T* c)
+{
+  const unsigned N = Y.n;
+  T *U = Y.U, *C = Y.C;
+  T* R = new T[Y.k*Y.k];
+  assert(R!=NULL);
+  blas::setzero(Y.k*Y.k, R);
+
+  unsigned r = 0;
+  for (unsigned i=0; i<Y.k; ++i) {
+    if (r<i) blas::copy(N, U+i*N, U+r*N);
+    T *ur = U + r*N, *cr = C + r*N;
+    blas::copy(N, ur, xh);
+    A.precond_apply(xh);
+    blas::setzero(N, cr);
+    A.amux((T) 1.0, xh, cr);
+
+    const double nrm0 = nrm2_(A, N, cr);
+    for (unsigned l=0; l<2 && r>0; ++l) {
+      blas::gemhm(N, r, 1, (T) 1.0, C, N, cr, N, c, r);
+      A.sum_start(r, c);
+      A.sum_wait();
+      blas::gemva(N, r, (T) -1.0, C, c, cr);
+      blas::add(r, c, R+r*Y.k);
+    }
+    const double nrm = nrm2_(A, N, cr);
+    if (nrm>1e6*D_PREC*nrm0) {
+      R[r+r*Y.k] = nrm;
+      blas::scal(N, (T) (1.0/nrm), cr);
+      ++r;
+    } else blas::setzero(r, R+r*Y.k);
+  }
+
+  rtrsolve_(N, r, U, R, Y.k);
+  Y.k = r;
+  Y.valid = true;
+  delete [] R;
+}
+
+template<class T> static
+unsigned GCRODR_(const Matrix<T>& A, T* const b, T* const x, double& eps,
+                 const unsigned m, const unsigned k, unsigned& nsteps,
+                 RecycleSpace<T>& Y)
+{
+  const unsigned N = A.n, ldG = m+1;
+  assert(k+1<m);
+  unsigned i, j, l = 0;
+  double resid;
+  bool failed = false;                             // LAPACK failed
+
+  if (Y.n!=N) Y.clear();
+  if (Y.k>k+1) Y.k = k+1;
+
+  T *V = new T[N*(m+2)];                           // N x (m+1)
+  T *xh = V + N*(m+1);                             // N
+  T *G = new T[ldG*(3*m+k+3)+m*(2*m+k+2)];
+  T *Gc = G + ldG*m;                               // (m+1) x m
+  T *WV = Gc + ldG*m;                              // (m+1) x m
+  T *g = WV + ldG*m;                               // m+1
+  T *c = g + ldG;                                  // (m+1) x (k+2)
+  T *P = c + ldG*(k+2);                            // m x (k+1)
+  T *D = P + m*(k+1);                              // m
+  T *Ae = D + m, *Be = Ae + m*m;                   // m x m
+  const unsigned nwk = 64*ldG;
+  T *tau = new T[ldG+nwk], *wk = tau + ldG;
+  assert(V!=NULL && G!=NULL && tau!=NULL);
+
+  // r = b - Ax, stored in V_0, summing up |b| in the meantime
+  T t = blas::scpr(N, b, b);
+  A.sum_start(1, &t);
+  blas::copy(N, b, V);
+  A.amux((T) -1.0, x, V);
+  A.sum_wait();
+
+  const double normb = sqrt(Re(t));
+  if (normb==0.0) {
+    blas::setzero(N, x);
+    eps = 0.0;
+    nsteps = 0;
+    delete [] tau;
+    delete [] G;
+    delete [] V;
+    return 0;
+  }
+
+  if (Y.k>0 && !Y.valid) recompute_(A, Y, xh, c);
+
+  for (;;) {
+    const unsigned kk = Y.k;
+    T *U = Y.U, *C = Y.C;
+
+    // x += M U C^H r, r -= C C^H r
+    if (kk>0) {
+      blas::gemhm(N, kk, 1, (T) 1.0, C, N, V, N, c, kk);
+      A.sum_start(kk, c);
+      A.sum_wait();
+      blas::setzero(N, xh);
+      blas::gemva(N, kk, (T) 1.0, U, c, xh);
+      A.precond_apply(xh);
+      blas::add(N, xh, x);
+      blas::gemva(N, kk, (T) -1.0, C, c, V);
+    }
+
+    const double beta = nrm2_(A, N, V);
+    if ((resid=beta/normb)<=eps || l>=nsteps || failed) break;
+    blas::scal(N, (T) (1.0/beta), V);
+
+    // A M U D = C D with D = diag(1/|u_i|) is the first block of G
+    for (i=0; i<kk; ++i) c[i] = blas::scpr(N, U+i*N, U+i*N);
+    A.sum_start(kk, c);
+    A.sum_wait();
+    blas::setzero(ldG*m, G);
+    for (i=0; i<kk; ++i) G[i+i*ldG] = D[i] = (T) (1.0/sqrt(Re(c[i])));
+
+    // Arnoldi process with (I - C C^H) A M
+    for (j=0; j<m-kk && l<nsteps; ) {
+      T *w = V + (j+1)*N, *h = G + (kk+j)*ldG;
+      blas::copy(N, V+j*N, xh);
+      A.precond_apply(xh);
+      blas::setzero(N, w);
+      A.amux((T) 1.0, xh, w);
+
+      // classical Gram-Schmidt (twice) with C and V
+      for (unsigned r=0; r<2; ++r) {
+        blas::gemhm(N, kk, 1, (T) 1.0, C, N, w, N, c, kk);
+        blas::gemhm(N, j+1, 1, (T) 1.0, V, N, w, N, c+kk, j+1);
+        A.sum_start(kk+j+1, c);
+        A.sum_wait();
+        blas::gemva(N, kk, (T) -1.0, C, c, w);
+        blas::gemva(N, j+1, (T) -1.0, V, c+kk, w);
+        blas::add(kk+j+1, c, h);
+      }
+      const double hnrm = nrm2_(A, N, w);
+      h[kk+j+1] = hnrm;
+      if (hnrm>0.0) blas::scal(N, (T) (1.0/hnrm), w);
+      ++j;
+      ++l;
+
+      // min |beta e_kk - G y|
+      for (i=0; i<kk+j; ++i) blas::copy(kk+j+1, G+i*ldG, Gc+i*ldG);
+      blas::setzero(kk+j+1, g);
+      g[kk] = beta;
+      if (!lsq_(kk+j, Gc, ldG, g, tau, nwk, wk)) {
+        failed = true;
+        break;
+      }
+      resid = abs(g[kk+j])/normb;
+
+#ifndef NDEBUG
+      std::cout << "Step " << l << ", resid=" << resid << std::endl;
+#endif
+
+      if (resid<=eps || hnrm==0.0) break;
+    }
+    const unsigned mm = kk+j;
+
+    if (failed) {
+      // r = b - Ax, the solve ends with it
+      blas::copy(N, b, V);
+      A.amux((T) -1.0, x, V);
+      continue;
+    }
+
+    // x += M [U D, V] y
+    utrsolve_(mm, Gc, ldG, g);
+    for (i=0; i<kk; ++i) g[i] *= D[i];
+    blas::setzero(N, xh);
+    blas::gemva(N, kk, (T) 1.0, U, g, xh);
+    blas::gemva(N, j, (T) 1.0, V, g+kk, xh);
+    A.precond_apply(xh);
+    blas::add(N, xh, x);
+
+    // harmonic Ritz vectors: G^H G z = theta G^H W^H [U D, V] z with
+    // W = [C, V] and W^H [U D, V] = [C^H U D, 0; V^H U D, I]
+    blas::setzero((mm+1)*mm, WV);
+    if (kk>0) {
+      blas::gemhm(N, kk, kk, (T) 1.0, C, N, U, N, c, mm+1);
+      blas::gemhm(N, j+1, kk, (T) 1.0, V, N, U, N, c+kk, mm+1);
+      A.sum_start((mm+1)*kk, c);
+      A.sum_wait();
+      for (i=0; i<kk; ++i) {
+        blas::copy(mm+1, c+i*(mm+1), WV+i*(mm+1));
+        blas::scal(mm+1, D[i], WV+i*(mm+1));
+      }
+    }
+    for (i=0; i<j; ++i) WV[kk+i+(kk+i)*(mm+1)] = (T) 1.0;
+    blas::gemhm(mm+1, mm, mm, (T) 1.0, G, ldG, WV, mm+1, Be, mm);
+    blas::gemhm(mm+1, mm, mm, (T) 1.0, G, ldG, G, ldG, Ae, mm);
+    unsigned kn = (k>0 && mm>1) ? harmRitz_(mm, Ae, Be, MIN(k, mm-1), P) : 0;
+
+    if (kn>0) {
+      // G P = Q R, new U = [U D, V] P R^{-1}, new C = W Q; if LAPACK
+      // fails, the space is kept
+      T* Q = Ae;
+      blas::setzero((mm+1)*kn, Q);
+      blas::gemma(mm+1, mm, kn, (T) 1.0, G, ldG, P, mm, Q, mm+1);
+      bool ok = blas::geqrf(mm+1, kn, Q, tau, nwk, wk)==0;
+      const unsigned ldR = kn;
+      double rmax = 0.0;
+      if (!ok) kn = 0;
+      for (i=0; i<kn; ++i) rmax = MAX(rmax, abs(Q[i+i*(mm+1)]));
+      for (i=0; i<kn && abs(Q[i+i*(mm+1)])>1e6*D_PREC*rmax; ++i)
+        blas::copy(i+1, Q+i*(mm+1), Be+i*ldR);
+      kn = i;
+      ok = ok && blas::orgqr(mm+1, kn, Q, tau, nwk, wk)==0;
+
+      if (ok) {
+        T *Un = new T[2*N*kn], *Cn = Un + N*kn;
+        assert(Un!=NULL);
+        blas::setzero(2*N*kn, Un);
+        for (i=0; i<kk; ++i) blas::scal(kn, D[i], P+i, mm);
+        blas::gemma(N, kk, kn, (T) 1.0, U, N, P, mm, Un, N);
+        blas::gemma(N, j, kn, (T) 1.0, V, N, P+kk, mm, Un, N);
+        rtrsolve_(N, kn, Un, Be, ldR);
+        blas::gemma(N, kk, kn, (T) 1.0, C, N, Q, mm+1, Cn, N);
+        blas::gemma(N, j+1, kn, (T) 1.0, V, N, Q+kk, mm+1, Cn, N);
+
+        Y.clear();
+        Y.n = N;
+        Y.k = kn;
+        Y.U = Un;
+        Y.C = Cn;
+        Y.valid = true;
+      }
+    }
+
+    // r = b - Ax
+    blas::copy(N, b, V);
+    A.amux((T) -1.0, x, V);
+  }
+
+  const unsigned ret = (resid<=eps) ? 0 : 1;
+  eps = resid;
+  nsteps = l;
+  delete [] tau;
+  delete [] G;
+  delete [] V;
+  return ret;
+}
+
+
+unsigned GCRODR(const Matrix<double>& A, double* const b, double* const x,
+                double& eps, const unsigned m, const unsigned k,
+                unsigned& nsteps, RecycleSpace<double>& Y)
+{
+  return GCRODR_(A, b, x, eps, m, k, nsteps, Y);
+}
+
+unsigned GCRODR(const Matrix<dcomp>& A, dcomp* const b, dcomp* const x,
+                double& eps, const unsigned m, const unsigned k,
+                unsigned& nsteps, RecycleSpace<dcomp>& Y)
+{
+  return GCRODR_(A, b, x, eps, m, k, nsteps, Y);
+}
@@ -0,0 +1,150 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+#include <cmath>
+#include "matrix.h"
+#include "blas.h"
+
+// PipeCG solves the hermitian positive definite linear system Ax=b using
+// the pipelined preconditioned Conjugate Gradient method (P. Ghysels,
+// W. Vanroose, Parallel Comput. 40, 2014). The recurrences are rearranged
+// such that the three inner products of a step are independent of the
+// product with A and the preconditioner of the same step. They are summed
+// up by a single reduction (A.sum_start), which overlaps with
+// precond_apply and amux if the vectors are distributed (see HMatrix_MPI).
+// Since the residual is known one step later than in CG, one additional
+// product with A is computed.
+//
+// The return value indicates convergence within nsteps (input)
+// iterations (0), or no convergence within nsteps iterations (1).
+//
+// Upon successful return, output arguments have the following values:
+//
+//      x  --  approximate solution to Ax = b
+// nsteps  --  the number of iterations performed before the
+//             tolerance was reached
+//    eps  --  the residual after the final iteration
+
+
+template<class T> static
+unsigned PipeCG_(const Matrix<T>& A, T* const b, T* const x, double& eps,
+                 unsigned& nsteps)
+{
+  const unsigned N = A.n;
+  T *r = new T[9*N], *u = r + N, *w = u + N, *mw = w + N, *nw = mw + N,
+    *z = nw + N, *q = z + N, *s = q + N, *p = s + N;
+  assert(r!=NULL);
+
+  // r = b - Ax, summing up |b| in the meantime
+  T dots[3];
+  dots[0] = blas::scpr(N, b, b);
+  A.sum_start(1, dots);
+  blas::copy(N, b, r);
+  A.amux((T) -1.0, x, r);
+  A.sum_wait();
+
+  const double nrmb = sqrt(Re(dots[0]));
+  if (nrmb<D_PREC) {
+    blas::setzero(N, x);
+    eps = 0.0;
+    nsteps = 0;
+    delete [] r;
+    return 0;
+  }
+
+  // u = C r, w = Au
+  blas::copy(N, r, u);
+  A.precond_apply(u);
+  blas::setzero(N, w);
+  A.amux((T) 1.0, u, w);
+
+  T alpha, alpha1 = (T) 0.0, gamma1 = (T) 0.0;
+  double resid;
+  for (unsigned l=0; ; ++l) {
+
+    // gamma = r * u, delta = w * u, |r|^2
+    dots[0] = blas::scpr(N, r, u);
+    dots[1] = blas::scpr(N, w, u);
+    dots[2] = blas::scpr(N, r, r);
+    A.sum_start(3, dots);
+
+    // m = C w, n = Am
+    if (l<nsteps) {
+      blas::copy(N, w, mw);
+      A.precond_apply(mw);
+      blas::setzero(N, nw);
+      A.amux((T) 1.0, mw, nw);
+    }
+
+    A.sum_wait();
+    resid = sqrt(Re(dots[2]));
+
+#ifndef NDEBUG
+    std::cout << "Step " << l << ", resid=" << resid/nrmb << std::endl;
+#endif
+
+    if (resid<=eps*nrmb) {
+      eps = resid/nrmb;
+      nsteps = l;
+      delete [] r;
+      return 0;
+    }
+    if (l==nsteps) break;
+
+    const T gamma = dots[0], delta = dots[1];
+    if (l>0) {
+      const T beta = gamma / gamma1;
+      alpha = gamma / (delta - beta*gamma/alpha1);
+
+      // z = n + beta z, q = m + beta q, s = w + beta s, p = u + beta p
+      blas::scal(N, beta, z);
+      blas::add(N, nw, z);
+      blas::scal(N, beta, q);
+      blas::add(N, mw, q);
+      blas::scal(N, beta, s);
+      blas::add(N, w, s);
+      blas::scal(N, beta, p);
+      blas::add(N, u, p);
+    } else {
+      alpha = gamma / delta;
+      blas::copy(N, nw, z);
+      blas::copy(N, mw, q);
+      blas::copy(N, w, s);
+      blas::copy(N, u, p);
+    }
+
+    // x += alpha p, r -= alpha s, u -= alpha q, w -= alpha z
+    blas::axpy(N, alpha, p, x);
+    blas::axpy(N, -alpha, s, r);
+    blas::axpy(N, -alpha, q, u);
+    blas::axpy(N, -alpha, z, w);
+
+    gamma1 = gamma;
+    alpha1 = alpha;
+  }
+
+  eps = resid/nrmb;
+  delete [] r;
+  return 1;
+}
+
+
+unsigned PipeCG(const Matrix<double>& A, double* const b, double* const x,
+                double& eps, unsigned& nsteps)
+{
+  return PipeCG_(A, b, x, eps, nsteps);
+}
+
+unsigned PipeCG(const Matrix<dcomp>& A, dcomp* const b, dcomp* const x,
+                double& eps, unsigned& nsteps)
+{
+  return PipeCG_(A, b, x, eps, nsteps);
+}
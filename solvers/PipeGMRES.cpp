@@ -0,0 +1,241 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+//*****************************************************************
+// Iterative template routine -- pipelined GMRES
+//
+// PipeGMRes solves the unsymmetric linear system Ax = b using the
+// pipelined p(1)-GMRES method (P. Ghysels, T.J. Ashby, K. Meerbergen,
+// W. Vanroose, SIAM J. Sci. Comput. 35, 2013) with right preconditioning
+// and restart after m steps. Besides the basis v_0, v_1, ... the images
+// z_{k+1} = AM v_k are kept. The new vector z_i is orthogonalized by
+// classical Gram-Schmidt and its norm is estimated from |z_i| and its
+// coefficients, so all inner products of a step are summed up by a single
+// reduction (A.sum_start). It overlaps with precond_apply and amux of z_i,
+// from which the image z_{i+1} of the new basis vector follows by a
+// recurrence. The same reduction contains |v_{i-1}|, by which the estimated
+// norm of the previous step is corrected. This pays off if the vectors are
+// distributed (see HMatrix_MPI). If the norm of the orthogonalized vector
+// cancels, the cycle ends and the method restarts with the true residual.
+//
+// The return value indicates convergence within nsteps (input)
+// iterations (0), or no convergence within nsteps iterations or a failure
+// of LAPACK (1).
+//
+// Upon successful return, output arguments have the following values:
+//
+//      x  --  approximate solution to Ax = b
+// nsteps  --  the number of iterations performed before the
+//             tolerance was reached
+//    eps  --  the residual after the final iteration
+//
+//*****************************************************************
+#include <cmath>
+#include "blas.h"
+#include "matrix.h"
+
+// solve the least squares problem min |g - H y| with the (n+1) x n
+// Hessenberg matrix H; g is overwritten with Q^H g, i.e. |g_n| is the
+// residual norm; H is overwritten with R; returns false if LAPACK fails
+template<class T> static
+bool lsq_(unsigned n, T* H, unsigned ldH, T* g, T* tau, unsigned nwk, T* wk)
+{
+  return blas::geqrf(n+1, n, H, ldH, tau, nwk, wk)==0
+    && blas::ormqrh(n+1, 1, n, H, ldH, tau, g, n+1, nwk, wk)==0;
+}
+
+// back substitution R y = g for the upper n x n part of H
+template<class T> static
+void utrsolve_(unsigned n, T* H, unsigned ldH, T* g)
+{
+  for (unsigned l=n; l-->0; ) {
+    T e = g[l];
+    for (unsigned i=l+1; i<n; ++i) e -= H[l+i*ldH] * g[i];
+    g[l] = (abs2(H[l+l*ldH])>0.0) ? e / H[l+l*ldH] : (T) 0.0;
+  }
+}
+
+template<class T> static
+unsigned PipeGMRes_(const Matrix<T>& A, T* const b, T* const x, double& eps,
+                    const unsigned m, unsigned& nsteps)
+{
+  const unsigned N = A.n, ldH = m+1;
+  unsigned i, j = 0, k;
+  double resid;
+  bool failed = false;                             // LAPACK failed
+
+  T *V = new T[N*(2*m+4)];                         // N x (m+1)
+  T *Z = V + N*(m+1);                              // N x (m+1), z_0 unused
+  T *w = Z + N*(m+1), *xh = w + N;                 // N
+  T *H = new T[2*ldH*m+2*ldH+1];
+  T *Hc = H + ldH*m;                               // (m+1) x m
+  T *g = Hc + ldH*m;                               // m+1
+  T *c = g + ldH;                                  // m+2
+  const unsigned nwk = 64*ldH;
+  T *tau = new T[ldH+nwk], *wk = tau + ldH;
+  assert(V!=NULL && H!=NULL && tau!=NULL);
+
+  // r = b - Ax, stored in V_0, summing up |b| in the meantime
+  T t = blas::scpr(N, b, b);
+  A.sum_start(1, &t);
+  blas::copy(N, b, V);
+  A.amux((T) -1.0, x, V);
+  A.sum_wait();
+
+  const double normb = sqrt(Re(t));
+  if (normb==0.0) {
+    blas::setzero(N, x);
+    eps = 0.0;
+    nsteps = 0;
+    delete [] tau;
+    delete [] H;
+    delete [] V;
+    return 0;
+  }
+
+  for (;;) {
+    // |r|, overlapped with z_1 = AM r
+    t = blas::scpr(N, V, V);
+    A.sum_start(1, &t);
+    blas::copy(N, V, xh);
+    A.precond_apply(xh);
+    blas::setzero(N, Z+N);
+    A.amux((T) 1.0, xh, Z+N);
+    A.sum_wait();
+
+    const double beta = sqrt(Re(t));
+    if ((resid=beta/normb)<=eps) {
+      eps = resid;
+      nsteps = j;
+      delete [] tau;
+      delete [] H;
+      delete [] V;
+      return 0;
+    }
+    if (j>=nsteps || failed) break;
+    blas::scal(N, (T) (1.0/beta), V);
+    blas::scal(N, (T) (1.0/beta), Z+N);
+
+    // step i generates v_i and z_{i+1} = AM v_i from z_i = AM v_{i-1}; the
+    // norm of v_{i-1} is corrected by (v_{i-1}, v_{i-1}) of the same reduction
+    bool conv = false;
+    unsigned n = 0;                                // columns of H
+    for (i=1; i<=m && j<nsteps && !conv; ++i) {
+      T *zi = Z + i*N, *vi = V + i*N, *vl = vi - N;
+
+      // c_k = (v_k, z_i), k<i, |z_i|^2 and |v_{i-1}|^2
+      blas::gemhm(N, i, 1, (T) 1.0, V, N, zi, N, c, i);
+      c[i] = blas::scpr(N, zi, zi);
+      c[i+1] = blas::scpr(N, vl, vl);
+      A.sum_start(i+2, c);
+
+      // w = AM z_i in the meantime
+      const bool next = (i<m && j+1<nsteps);
+      if (next) {
+        blas::copy(N, zi, xh);
+        A.precond_apply(xh);
+        blas::setzero(N, w);
+        A.amux((T) 1.0, xh, w);
+      }
+
+      A.sum_wait();
+      ++j;
+
+      // normalize v_{i-1} and its image z_i
+      const double rho = sqrt(Re(c[i+1]));
+      if (i>1) {
+        blas::scal(N, (T) (1.0/rho), vl);
+        blas::scal(N, (T) (1.0/rho), zi);
+        if (next) blas::scal(N, (T) (1.0/rho), w);
+        H[i-1+(i-2)*ldH] *= rho;
+        for (k=0; k<i-1; ++k) c[k] /= rho;
+        c[i-1] /= rho*rho;
+        c[i] /= rho*rho;
+      }
+
+      // column i-1 of H, |v_i| = sqrt(|z_i|^2 - |c|^2)
+      const double nrmz2 = Re(c[i]);
+      double h2 = nrmz2;
+      for (k=0; k<i; ++k) h2 -= abs2(c[k]);
+      T* h = H + (i-1)*ldH;
+      blas::setzero(ldH, h);
+      blas::copy(i, c, h);
+      n = i;
+
+      if (h2<=1e4*D_PREC*nrmz2) conv = true;       // cancellation
+      else {
+        const double hi = sqrt(h2);
+        h[i] = hi;
+
+        // v_i = (z_i - V c) / h_i
+        blas::copy(N, zi, vi);
+        blas::gemma(N, i, 1, (T) -1.0, V, N, c, i, vi, N);
+        blas::scal(N, (T) (1.0/hi), vi);
+
+        // z_{i+1} = (w - Z c) / h_i
+        if (next) {
+          T* zn = zi + N;
+          blas::copy(N, w, zn);
+          blas::gemma(N, i, 1, (T) -1.0, Z+N, N, c, i, zn, N);
+          blas::scal(N, (T) (1.0/hi), zn);
+        }
+      }
+
+      // least squares problem
+      for (k=0; k<n; ++k) blas::copy(n+1, H+k*ldH, Hc+k*ldH);
+      blas::setzero(n+1, g);
+      g[0] = beta;
+      if (!lsq_(n, Hc, ldH, g, tau, nwk, wk)) {
+        failed = true;
+        break;
+      }
+      resid = abs(g[n])/normb;
+
+#ifndef NDEBUG
+      std::cout << "Step " << j << ", resid=" << resid << std::endl;
+#endif
+
+      if (resid<=eps) conv = true;
+    }
+
+    // x += M V y
+    if (!failed && n>0) {
+      utrsolve_(n, Hc, ldH, g);
+      blas::setzero(N, xh);
+      blas::gemva(N, n, (T) 1.0, V, g, xh);
+      A.precond_apply(xh);
+      blas::add(N, xh, x);
+    }
+
+    // r = b - Ax
+    blas::copy(N, b, V);
+    A.amux((T) -1.0, x, V);
+  }
+
+  eps = resid;
+  delete [] tau;
+  delete [] H;
+  delete [] V;
+  return 1;
+}
+
+
+unsigned PipeGMRes(const Matrix<double>& A, double* const b, double* const x,
+                   double& eps, const unsigned m, unsigned& nsteps)
+{
+  return PipeGMRes_(A, b, x, eps, m, nsteps);
+}
+
+unsigned PipeGMRes(const Matrix<dcomp>& A, dcomp* const b, dcomp* const x,
+                   double& eps, const unsigned m, unsigned& nsteps)
+{
+  return PipeGMRes_(A, b, x, eps, m, nsteps);
+}
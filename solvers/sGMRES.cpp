@@ -0,0 +1,294 @@
+/*
+    AHMED -- Another software library on Hierarchical Matrices for
+             Elliptic Differential equations
+
+    Copyright (c) 2012 Mario Bebendorf
+
+    You should have received a copy of the license along with
+    this software; if not, see AHMED's internet site.
+*/
+
+
+//*****************************************************************
+// Iterative template routine -- s-step GMRES
+//
+// sGMRes solves the unsymmetric linear system Ax = b using the
+// communication avoiding s-step variant of the Generalized Minimum
+// Residual method (M. Hoemmen, PhD thesis, UC Berkeley, 2010) with right
+// preconditioning and restart after m steps. Each block of s steps first
+// generates the (scaled) monomial basis v, AMv, ..., (AM)^s v of the last
+// basis vector v without any inner products, then orthogonalizes it
+// against the previous basis by block classical Gram-Schmidt (twice) and
+// within itself by Cholesky QR. Hence, only two reductions (A.sum_start)
+// are required per s steps instead of O(s) in GMRes, which pays off if the
+// vectors are distributed (see HMatrix_MPI). Since the monomial basis
+// becomes ill-conditioned for large s, s should not exceed about 5; if the
+// Cholesky factorization fails, the block is orthogonalized column-wise.
+//
+// The return value indicates convergence within nsteps (input)
+// iterations (0), or no convergence within nsteps iterations or a failure
+// of LAPACK (1).
+//
+// Upon successful return, output arguments have the following values:
+//
+//      x  --  approximate solution to Ax = b
+// nsteps  --  the number of iterations performed before the
+//             tolerance was reached
+//    eps  --  the residual after the final iteration
+//
+//*****************************************************************
+#include <cmath>
+#include "blas.h"
+#include "matrix.h"
+
+// |v| summed up over all processors
+template<class T> static
+double nrm2_(const Matrix<T>& A, unsigned N, T* v)
+{
+  T t = blas::scpr(N, v, v);
+  A.sum_start(1, &t);
+  A.sum_wait();
+  return sqrt(Re(t));
+}
+
+// Cholesky decomposition G = R^H R of the hermitian k x k matrix G,
+// R is stored in the upper triangle of G; returns false if a pivot is
+// small compared with the corresponding diagonal entry of G
+template<class T> static
+bool chol_(unsigned k, T* G)
+{
+  for (unsigned j=0; j<k; ++j) {
+    const double g = Re(G[j+j*k]);
+    for (unsigned i=0; i<j; ++i) {
+      T e = G[i+j*k];
+      for (unsigned l=0; l<i; ++l) e -= conj(G[l+i*k]) * G[l+j*k];
+      G[i+j*k] = e / G[i+i*k];
+    }
+    double d = g;
+    for (unsigned l=0; l<j; ++l) d -= abs2(G[l+j*k]);
+    if (d<=1e-8*g) return false;
+    G[j+j*k] = (T) sqrt(d);
+  }
+  return true;
+}
+
+// solve the least squares problem min |g - H y| with the (n+1) x n
+// Hessenberg matrix H; g is overwritten with Q^H g, i.e. |g_n| is the
+// residual norm; H is overwritten with R; returns false if LAPACK fails
+template<class T> static
+bool lsq_(unsigned n, T* H, unsigned ldH, T* g, T* tau, unsigned nwk, T* wk)
+{
+  return blas::geqrf(n+1, n, H, ldH, tau, nwk, wk)==0
+    && blas::ormqrh(n+1, 1, n, H, ldH, tau, g, n+1, nwk, wk)==0;
+}
+
+// back substitution R y = g for the upper n x n part of H
+template<class T> static
+void utrsolve_(unsigned n, T* H, unsigned ldH, T* g)
+{
+  for (unsigned l=n; l-->0; ) {
+    T e = g[l];
+    for (unsigned i=l+1; i<n; ++i) e -= H[l+i*ldH] * g[i];
+    g[l] = (abs2(H[l+l*ldH])>0.0) ? e / H[l+l*ldH] : (T) 0.0;
+  }
+}
+
+// orthonormalize the k columns of W, which are orthogonal to the first i+1
+// basis vectors, against each other; their coefficients are added to R
+// (ldR x k), the first i+1 rows of which refer to the basis. Returns the
+// number of columns before the first which is linearly dependent
+template<class T> static
+unsigned orth_(const Matrix<T>& A, unsigned N, unsigned i, unsigned k, T* W,
+               T* R, unsigned ldR, T* c)
+{
+  for (unsigned j=0; j<k; ++j) {
+    T* wj = W + j*N;
+    const double nrm0 = nrm2_(A, N, wj);
+    for (unsigned l=0; l<2 && j>0; ++l) {
+      blas::gemhm(N, j, 1, (T) 1.0, W, N, wj, N, c, j);
+      A.sum_start(j, c);
+      A.sum_wait();
+      blas::gemma(N, j, 1, (T) -1.0, W, N, c, j, wj, N);
+      blas::add(j, c, R+i+1+j*ldR);
+    }
+    const double nrm = nrm2_(A, N, wj);
+    if (nrm<=1e6*D_PREC*nrm0) return j;
+    R[i+1+j+j*ldR] = nrm;
+    blas::scal(N, (T) (1.0/nrm), wj);
+  }
+  return k;
+}
+
+template<class T> static
+unsigned sGMRes_(const Matrix<T>& A, T* const b, T* const x, double& eps,
+                 const unsigned m, unsigned s, unsigned& nsteps)
+{
+  const unsigned N = A.n, ldH = m+1;
+  if (s>m) s = m;
+  if (s==0) s = 1;
+  unsigned i, j = 0, k;
+  double resid, sigma = 0.0;
+  bool failed = false;                             // LAPACK failed
+
+  T *V = new T[N*(m+2)];                           // N x (m+1)
+  T *xh = V + N*(m+1);                             // N
+  T *H = new T[ldH*(2*m+2)+(m+1)*(s+1)+(m+1+s)*s+s+ldH];
+  T *Hc = H + ldH*m;                               // (m+1) x (m+1)
+  T *R = Hc + ldH*(m+1);                           // (m+1) x (s+1)
+  T *C = R + ldH*(s+1);                            // (m+1+s) x s
+  T *g = C + (m+1+s)*s;                            // m+1
+  const unsigned nwk = 64*ldH;
+  T *tau = new T[ldH+nwk], *wk = tau + ldH;
+  assert(V!=NULL && H!=NULL && tau!=NULL);
+
+  // r = b - Ax, stored in V_0, summing up |b| in the meantime
+  T t = blas::scpr(N, b, b);
+  A.sum_start(1, &t);
+  blas::copy(N, b, V);
+  A.amux((T) -1.0, x, V);
+  A.sum_wait();
+
+  const double normb = sqrt(Re(t));
+  if (normb==0.0) {
+    blas::setzero(N, x);
+    eps = 0.0;
+    nsteps = 0;
+    delete [] tau;
+    delete [] H;
+    delete [] V;
+    return 0;
+  }
+
+  for (;;) {
+    const double beta = nrm2_(A, N, V);
+    if ((resid=beta/normb)<=eps) {
+      eps = resid;
+      nsteps = j;
+      delete [] tau;
+      delete [] H;
+      delete [] V;
+      return 0;
+    }
+    if (j>=nsteps || failed) break;
+    blas::scal(N, (T) (1.0/beta), V);
+
+    bool conv = false;
+    i = 0;
+    while (i<m && j<nsteps && !conv) {
+      unsigned sb = MIN(s, MIN(m-i, nsteps-j));
+      T *Vi = V + i*N, *W = Vi + N;
+
+      // W_k = (AM)^k v_i / sigma^k
+      for (k=0; k<sb; ++k) {
+        blas::copy(N, Vi+k*N, xh);
+        A.precond_apply(xh);
+        blas::setzero(N, W+k*N);
+        A.amux((T) 1.0, xh, W+k*N);
+        if (sigma==0.0) {
+          sigma = nrm2_(A, N, W);
+          if (sigma==0.0) sigma = 1.0;
+        }
+        blas::scal(N, (T) (1.0/sigma), W+k*N);
+      }
+
+      // R = [e_i, coefficients of W], first pass of block Gram-Schmidt
+      blas::setzero(ldH*(sb+1), R);
+      R[i] = (T) 1.0;
+      blas::gemhm(N, i+1, sb, (T) 1.0, V, N, W, N, C, i+1);
+      A.sum_start((i+1)*sb, C);
+      A.sum_wait();
+      blas::gemma(N, i+1, sb, (T) -1.0, V, N, C, i+1, W, N);
+      for (k=0; k<sb; ++k) blas::add(i+1, C+k*(i+1), R+(k+1)*ldH);
+
+      // second pass together with the Gram matrix W^H W
+      T *C2 = C, *G = C + (i+1)*sb;
+      blas::gemhm(N, i+1, sb, (T) 1.0, V, N, W, N, C2, i+1);
+      blas::gemhm(N, sb, sb, (T) 1.0, W, N, W, N, G, sb);
+      A.sum_start((i+1+sb)*sb, C);
+      A.sum_wait();
+      blas::gemma(N, i+1, sb, (T) -1.0, V, N, C2, i+1, W, N);
+      for (k=0; k<sb; ++k) blas::add(i+1, C2+k*(i+1), R+(k+1)*ldH);
+      blas::gemhma(i+1, sb, sb, (T) -1.0, C2, i+1, C2, i+1, G, sb);
+
+      // Cholesky QR, W = Q R_W
+      if (chol_(sb, G)) {
+        for (k=0; k<sb; ++k) {
+          T* wq = W + k*N;
+          for (unsigned l=0; l<k; ++l) blas::axpy(N, -G[l+k*sb], W+l*N, wq);
+          blas::scal(N, (T) 1.0/G[k+k*sb], wq);
+          blas::copy(k+1, G+k*sb, R+i+1+(k+1)*ldH);
+        }
+      } else {
+        const unsigned r = orth_(A, N, i, sb, W, R+ldH, ldH, C);
+        if (r<sb) {
+          // invariant subspace, the Hessenberg column i+r is complete
+          sb = r+1;
+          conv = true;
+        }
+      }
+
+      // new columns of H from (AM) W_0..sb-1 = sigma W_1..sb, where
+      // W_0 = v_i
+      for (k=0; k<sb; ++k) {
+        T* h = H + (i+k)*ldH;
+        blas::setzero(ldH, h);
+        blas::axpy(i+k+2, (T) sigma, R+(k+1)*ldH, h);
+        for (unsigned l=0; l<i+k; ++l)
+          blas::axpy(l+2, -R[l+k*ldH], H+l*ldH, h);
+        blas::scal(i+k+2, (T) 1.0/R[i+k+k*ldH], h);
+      }
+      i += sb;
+      j += sb;
+
+      // least squares problem
+      for (k=0; k<i; ++k) blas::copy(i+1, H+k*ldH, Hc+k*ldH);
+      blas::setzero(i+1, g);
+      g[0] = beta;
+      if (!lsq_(i, Hc, ldH, g, tau, nwk, wk)) {
+        failed = true;
+        break;
+      }
+      resid = abs(g[i])/normb;
+
+#ifndef NDEBUG
+      std::cout << "Step " << j << ", resid=" << resid << std::endl;
+#endif
+
+      if (resid<=eps) conv = true;
+    }
+
+    // x += M V y
+    if (!failed) {
+      utrsolve_(i, Hc, ldH, g);
+      blas::setzero(N, xh);
+      blas::gemva(N, i, (T) 1.0, V, g, xh);
+      A.precond_apply(xh);
+      blas::add(N, xh, x);
+    }
+
+    // r = b - Ax
+    blas::copy(N, b, V);
+    A.amux((T) -1.0, x, V);
+  }
+
+  eps = resid;
+  delete [] tau;
+  delete [] H;
+  delete [] V;
+  return 1;
+}
+
+
+unsigned sGMRes(const Matrix<double>& A, double* const b, double* const x,
+                double& eps, const unsigned m, const unsigned s,
+                unsigned& nsteps)
+{
+  return sGMRes_(A, b, x, eps, m, s, nsteps);
+}
+
+unsigned sGMRes(const Matrix<dcomp>& A, dcomp* const b, dcomp* const x,
+                double& eps, const unsigned m, const unsigned s,
+                unsigned& nsteps)
+{
+  return sGMRes_(A, b, x, eps, m, s, nsteps);
+}